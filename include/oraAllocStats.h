@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAALLOCSTATS_H
+#define ORAALLOCSTATS_H
+
+//==============================================================================
+// Allocation accounting. Only compiled in when DEADLOCK_ALLOC_TRACKING is
+// defined, which replaces the global operator new and delete with ones that
+// count, and then only counts when enabled at run time, by --alloc-stats.
+// Otherwise everything here does nothing, and reports zeros.
+//
+// Each thread counts its own allocations, bytes allocated, and live bytes,
+// with the highest live bytes so far. A mark, taken at the start of a phase,
+// gives the allocations and bytes during the phase, and how far live memory
+// peaked above where it was at the start. Marks nest, as phases do, as long
+// as they are finished in reverse order, which their destructors see to.
+// Memory freed by another thread than the one that allocated it shows up as
+// a drop in the freeing thread's live bytes.
+//==============================================================================
+
+struct oraAllocUsage {
+    unsigned long long allocations = 0;
+    unsigned long long bytes = 0;
+    unsigned long long peakBytes = 0;
+};
+
+class oraAllocStats
+{
+    public:
+        static bool compiledIn();
+        static void enable();
+        static bool enabled() { return mEnabled; }
+
+        // For the whole process.
+        static unsigned long long allocations();
+        static unsigned long long bytes();
+        static unsigned long long peakBytes();
+
+    private:
+        static bool mEnabled;
+};
+
+class oraAllocMark
+{
+    public:
+        oraAllocMark() { start(); }
+        ~oraAllocMark() { if (mActive) { finish(); } }
+        oraAllocMark(const oraAllocMark &) = delete;
+        oraAllocMark &operator=(const oraAllocMark &) = delete;
+
+        void start();
+        oraAllocUsage finish();
+
+    private:
+        bool mActive = false;
+        unsigned long long mAllocations;
+        unsigned long long mBytes;
+        long long mLive;
+        long long mSavedPeak;
+};
+
+#endif // ORAALLOCSTATS_H
@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAASYNCFILE_H
+#define ORAASYNCFILE_H
+
+#include <string>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "oraBoundedQueue.h"
+
+using std::string;
+using std::ostream;
+
+// Output is handed to the writer thread in chunks of this many bytes.
+#define ASYNC_CHUNK_SIZE (1024 * 1024)
+
+//==============================================================================
+// An output file written by a thread of its own. Whatever is written to it is
+// gathered into big chunks, and each full chunk is queued for the writer, so
+// the report carries on being rendered while the last bit is still going to
+// disc. At most depth chunks wait to be written, after that the writes wait.
+// Worth it when the output is on something slow, like NFS, not otherwise.
+//
+// A write that fails sets badbit, but maybe not until a later write, or the
+// close(), so check after closing.
+//==============================================================================
+class oraAsyncFile : public ostream
+{
+    public:
+        oraAsyncFile(const string &fileName, const size_t depth);
+        virtual ~oraAsyncFile();
+        void close();
+
+        // An ordinary ofstream if depth is zero, one of these otherwise.
+        static std::unique_ptr<ostream> open(const string &fileName, const size_t depth);
+
+        // Closes either of them, and says whether it all went well.
+        static bool finish(ostream &out);
+
+    private:
+        class buffer : public std::streambuf
+        {
+            public:
+                buffer(const string &fileName, const size_t depth);
+                virtual ~buffer();
+                bool good() const { return mFile.good() && !mFailed; }
+                bool close();
+
+            protected:
+                int_type overflow(int_type c) override;
+                int sync() override;
+                pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                                 std::ios_base::openmode which) override;
+
+            private:
+                std::ofstream mFile;
+                string mChunk;
+                unsigned long long mQueued;
+                oraBoundedQueue<string> mQueue;
+                std::thread mWriter;
+                std::atomic<bool> mFailed;
+                bool mClosed;
+                bool handOver();
+                void writer();
+        };
+
+        buffer mBuffer;
+};
+
+#endif // ORAASYNCFILE_H
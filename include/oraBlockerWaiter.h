@@ -44,37 +44,40 @@ class oraBlockerWaiter
         oraBlockerWaiter(const bool isWaiter = false);
         virtual ~oraBlockerWaiter();
 
-        string resourceName() { return mResourceName; }
+        string resourceName() const { return mResourceName; }
         void setResourceName(const string val) { mResourceName = val; }
 
-        unsigned session() { return mSession; }
+        unsigned session() const { return mSession; }
         void setSession(const unsigned val) { mSession = val; }
 
-        unsigned process() { return mProcess; }
+        unsigned process() const { return mProcess; }
         void setProcess(const unsigned val) { mProcess = val; }
 
-        string holds() { return mHolds; }
+        string holds() const { return mHolds; }
         void setHolds(string val);
 
-        string waits() { return mWaits; }
+        string waits() const { return mWaits; }
         void setWaits(string val);
 
-        string rowidWait() { return mRowidWait; }
+        string rowidWait() const { return mRowidWait; }
         void setRowidWait(const string val) { mRowidWait = val; }
 
-        unsigned objectId() { return mObjectId; }
+        unsigned objectId() const { return mObjectId; }
         void setObjectId(const unsigned val) { mObjectId = val; }
 
-        unsigned file() { return mFile; }
+        unsigned dataObjectId() const { return mDataObjectId; }
+        void setDataObjectId(const unsigned val) { mDataObjectId = val; }
+
+        unsigned file() const { return mFile; }
         void setFile(const unsigned val) { mFile = val; }
 
-        unsigned block() { return mBlock; }
+        unsigned block() const { return mBlock; }
         void setBlock(const unsigned val) { mBlock = val; };
 
-        unsigned slot() { return mSlot; }
+        unsigned slot() const { return mSlot; }
         void setSlot(const unsigned val) { mSlot = val; }
 
-        unsigned otherSession() { return mOtherSession; }
+        unsigned otherSession() const { return mOtherSession; }
         void setOtherSession(const unsigned val) { mOtherSession = val; }
 
         friend ostream& operator<<(ostream &out, const oraBlockerWaiter &bw);
@@ -93,6 +96,7 @@ class oraBlockerWaiter
         unsigned mBlock;
         unsigned mSlot;
         unsigned mObjectId;
+        unsigned mDataObjectId;
         unsigned mOtherSession;
 };
 
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORABOUNDEDQUEUE_H
+#define ORABOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+//==============================================================================
+// A first in, first out queue between threads, which holds at most capacity
+// items. Pushing to a full queue waits for room, so a producer can't get too
+// far ahead of its consumer, and popping an empty one waits for an item.
+// Either side can close the queue. After that, pushes fail straight away, and
+// pops fail once the queue is empty.
+//==============================================================================
+template <typename T>
+class oraBoundedQueue
+{
+    public:
+        explicit oraBoundedQueue(const size_t capacity) :
+            mCapacity(capacity ? capacity : 1), mClosed(false) {}
+
+        //----------------------------------------------------------------------
+        // Adds an item, waiting for room if need be. False, and the item not
+        // taken, if the queue is closed.
+        //----------------------------------------------------------------------
+        bool push(T &&item) {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotFull.wait(lock, [this]() { return mClosed || mItems.size() < mCapacity; });
+            if (mClosed) {
+                return false;
+            }
+
+            mItems.push_back(std::move(item));
+            mNotEmpty.notify_one();
+            return true;
+        }
+
+        //----------------------------------------------------------------------
+        // Takes the oldest item, waiting for one if need be. False if the
+        // queue is closed and there's nothing left.
+        //----------------------------------------------------------------------
+        bool pop(T &item) {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotEmpty.wait(lock, [this]() { return mClosed || !mItems.empty(); });
+            if (mItems.empty()) {
+                return false;
+            }
+
+            item = std::move(mItems.front());
+            mItems.pop_front();
+            mNotFull.notify_one();
+            return true;
+        }
+
+        //----------------------------------------------------------------------
+        // No more items. Anyone waiting is woken up.
+        //----------------------------------------------------------------------
+        void close() {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosed = true;
+            mNotFull.notify_all();
+            mNotEmpty.notify_all();
+        }
+
+    private:
+        std::deque<T> mItems;
+        const size_t mCapacity;
+        bool mClosed;
+        std::mutex mMutex;
+        std::condition_variable mNotFull;
+        std::condition_variable mNotEmpty;
+};
+
+#endif // ORABOUNDEDQUEUE_H
@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORACLUSTERMERGE_H
+#define ORACLUSTERMERGE_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "oraTraceFile.h"
+#include "oraDeadlock.h"
+#include "oraStats.h"
+#include "oraFilter.h"
+
+using std::string;
+using std::vector;
+using std::ostream;
+
+//==============================================================================
+// Correlates deadlocks across the trace files from the nodes of a RAC cluster,
+// including the LMD traces with their global wait-for-graphs. Each trace file
+// is streamed, one deadlock at a time, and a heap picks whichever of them has
+// the earliest deadlock next, so the timeline comes out in time order without
+// loading any file into memory. Each node's clock can be adjusted by a number
+// of seconds, in case they don't quite agree.
+//==============================================================================
+class oraClusterMerge
+{
+    public:
+        oraClusterMerge();
+        virtual ~oraClusterMerge();
+        bool addTraceFile(const string traceFileName, const long long skew);
+        void setFilter(oraFilter *filter) { mFilter = filter; }
+        unsigned merge(ostream &out);
+        void mergeStats(oraStats &total);
+
+    private:
+        // One per trace file, with its next deadlock, if there is one.
+        struct node {
+            oraTraceFile *traceFile;
+            long long skew;
+            oraDeadlock next;
+            bool hasNext;
+        };
+
+        vector<node> mNodes;
+        oraFilter *mFilter;
+
+        bool advance(node &n);
+        void timelineEntry(ostream &out, node &n);
+};
+
+#endif // ORACLUSTERMERGE_H
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORACOLUMNAREXPORT_H
+#define ORACOLUMNAREXPORT_H
+
+#include <string>
+
+#include "oraParquet.h"
+#include "oraTraceFile.h"
+#include "oraDeadlock.h"
+
+using std::string;
+
+//==============================================================================
+// Exports deadlocks as two Parquet files, for analytics tools to load.
+//
+// "name.deadlocks.parquet" has a row per deadlock, "name.graph.parquet" a row
+// per row of each deadlock graph, the blocker and its waiter side by side, or
+// per lock for a global deadlock. The trace file, instance, signature, lock
+// modes and resource types are dictionary encoded, they don't vary much.
+//
+// Rows are added as each deadlock is parsed, and written out a row group at
+// a time, so only a row group per file is ever held in memory.
+//==============================================================================
+class oraColumnarExport
+{
+    public:
+        oraColumnarExport(const string &baseName, const string &createdBy);
+        virtual ~oraColumnarExport();
+        bool good() const { return mDeadlocks.good() && mGraph.good(); }
+        void add(oraTraceFile &traceFile, const oraDeadlock &dl, const unsigned number);
+        bool close();
+        unsigned long long deadlocks() const { return mDeadlocks.rows(); }
+        unsigned long long graphRows() const { return mGraph.rows(); }
+
+    private:
+        oraParquetWriter mDeadlocks;
+        oraParquetWriter mGraph;
+};
+
+#endif // ORACOLUMNAREXPORT_H
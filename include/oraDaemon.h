@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORADAEMON_H
+#define ORADAEMON_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "oraTraceFile.h"
+#include "oraWatchdog.h"
+#include "oraObjectDictionary.h"
+#include "oraFilter.h"
+
+using std::string;
+
+//==============================================================================
+// A long running analysis server, listening on a UNIX domain socket, so that
+// tools collecting trace files don't have to start a new DeadlockAnalysis for
+// each one. A pool of worker threads, the wait event name table and the CSS
+// file cache all stay warm between requests.
+//
+// Each connection can send any number of requests, one per line:
+//
+// PARSE /path/to/trace.trc         Analyse a trace file on disc.
+// REPORT /path/to/trace.trc        The same, and write the HTML report too.
+// DATA name length                 Analyse a trace file sent over the socket,
+//                                  the next length bytes. The name is only
+//                                  used in the results.
+// QUIT                             Close the connection.
+//
+// Each response is either "OK length" followed by that many bytes of JSON, or
+// "ERROR message", on a line of its own. If a request goes over the time
+// limit, the JSON has what was found so far, and "timedOut" is true.
+//
+// The workers are handed requests, not connections. The listening thread
+// polls the idle connections, and only queues one for a worker once it has a
+// whole request line, so idle clients don't tie up the pool. The worker gives
+// the connection back when it has sent the response.
+//
+// The daemon stops, once the requests in progress are done, on SIGTERM or
+// SIGINT. Idle connections are closed, clients waiting for a worker are
+// turned away.
+//==============================================================================
+class oraDaemon
+{
+    public:
+        oraDaemon(const string socketPath, const unsigned threads);
+        virtual ~oraDaemon();
+        void setFilter(oraFilter *filter) { mFilter = filter; }
+        void setExcerpts(const bool val) { mExcerpts = val; }
+        void setDeadlockBudget(const unsigned long long val) { mDeadlockBudget = val; }
+        void setTimeLimit(const double seconds) { mTimeLimit = seconds; }
+        void setObjects(const oraObjectDictionary *objects) { mObjects = objects; }
+        bool run();
+
+        // A client, and anything it has sent that we haven't dealt with yet.
+        struct connection {
+            int fd;
+            string pending;
+        };
+
+    private:
+        string mSocketPath;
+        unsigned mThreads;
+        int mListener;
+        oraFilter *mFilter;
+        bool mExcerpts;
+        unsigned long long mDeadlockBudget;
+        double mTimeLimit;
+        const oraObjectDictionary *mObjects;
+        std::unique_ptr<oraWatchdog> mWatchdog;
+
+        // Connections with a request waiting for a worker, those the workers
+        // have finished with, and those being served, so that stopping can
+        // shut them. A byte down mWake tells the listener about the finished.
+        std::mutex mMutex;
+        std::condition_variable mReady;
+        std::deque<std::unique_ptr<connection>> mRequests;
+        std::vector<std::unique_ptr<connection>> mReturned;
+        std::set<int> mOpen;
+        bool mStopping;
+        int mWake[2];
+
+        void worker();
+        bool serve(connection &client);
+        string analyse(oraTraceFile &traceFile, const bool writeReport);
+};
+
+#endif // ORADAEMON_H
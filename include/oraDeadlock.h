@@ -28,9 +28,12 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <memory>
 
 // Vector blows up below if I just use "class" here. Sigh.
 #include "oraBlockerWaiter.h"
+#include "oraWaitEvent.h"
+#include "oraTraceText.h"
 
 using std::string;
 using std::map;
@@ -38,53 +41,126 @@ using std::vector;
 
 class oraTraceFile;
 
+// A deadlock keeps this many parse error messages, any more are just counted.
+#define MAX_PARSE_ERRORS 10
+
+// One lock from an LMD global wait-for-graph, on RAC. For example:
+// BLOCKED 0x7000001cbfccba8 5 wq 2 cvtops x1 TX 0x1470008.0x72(ext 0x5,0x0)[68000-0002-0000000A] inst 2
+struct oraGlobalLock {
+    bool blocker = false;
+    string lockAddress;
+    unsigned mode = 0;
+    string resource;
+    string transaction;
+    unsigned instance = 0;
+    unsigned session = 0;       // Zero if not dumped.
+};
+
 class oraDeadlock
 {
     public:
         oraDeadlock(oraTraceFile *tf);
+        oraDeadlock(const oraDeadlock &) = default;
+        oraDeadlock(oraDeadlock &&) = default;
+        oraDeadlock &operator=(const oraDeadlock &) = default;
+        oraDeadlock &operator=(oraDeadlock &&) = default;
         virtual ~oraDeadlock();
         bool extractDeadlock();
-        unsigned lineNumber() { return mLineNumber; }
+        bool extractGlobalGraph();
+        bool global() const { return mGlobal; }
+        const vector<oraGlobalLock> *globalLocks() const { return &mGlobalLocks; }
+        long long epoch() const { return mEpoch; }
+        bool rejected() const { return mRejected; }
+        bool truncated() const { return mTruncated; }
+        unsigned lineNumber() const { return mLineNumber; }
+        unsigned long long startOffset() const { return mStartOffset; }
+        unsigned long long endOffset() const { return mEndOffset; }
         void setDateTime(const string date, const string time);
-        string date() { return mDate; }
-        string time() { return mTime; }
-        string dateTime() { return "on " + mDate + " at " + mTime; }
+        string date() const { return mDate; }
+        string time() const { return mTime; }
+        string dateTime() const { return "on " + mDate + " at " + mTime; }
         friend ostream& operator<<(ostream &out, const oraDeadlock &dl);
-        vector<string> *signatures();
-        vector<string> *waitStack();
-        unsigned abortedSession();
+        void toJSON(ostream &out, const string &indent) const;
+        void toCSV(ostream &out, const unsigned number) const;
+        static void csvHeader(ostream &out);
+        const vector<string> *signatures() const;
+        const vector<oraWaitEvent> *waitStack() const;
+        unsigned abortedSession() const;
         //map<unsigned, oraBlockerWaiter> *blockers();
         //map<unsigned, oraBlockerWaiter> *waiters();
-        oraBlockerWaiter *blockerByIndex(const unsigned index);
-        oraBlockerWaiter *waiterByIndex(const unsigned index);
-        oraBlockerWaiter *blockerBySession(const unsigned session);
-        oraBlockerWaiter *waiterBySession(const unsigned session);
-        unsigned rows() { return mBlockers.size(); }
-        bool txxx();    // Application error? Self Deadlock?
-        bool txxs();    // Bitmap Index? ITL? PK/UK inconsistency?
-        bool ul();      // User defined lock;
-        bool tm();      // Missing FK index?
+        const oraBlockerWaiter *blockerByIndex(const unsigned index) const;
+        const oraBlockerWaiter *waiterByIndex(const unsigned index) const;
+        const oraBlockerWaiter *blockerBySession(const unsigned session) const;
+        const oraBlockerWaiter *waiterBySession(const unsigned session) const;
+        unsigned rows() const { return mBlockers.size(); }
+        bool txxx() const;    // Application error? Self Deadlock?
+        bool txxs() const;    // Bitmap Index? ITL? PK/UK inconsistency?
+        bool ul() const;      // User defined lock;
+        bool tm() const;      // Missing FK index?
         void setDeadlockWait(const string reason) { mDeadlockWait = reason; }
-        string deadlockWait() { return mDeadlockWait; }
-        string SQL() { return mAbortedSQL; }
+        string deadlockWait() const { return mDeadlockWait; }
+        string SQL() const;
+        const vector<string> *parseErrors() const { return &mParseErrors; }
+
+        // The sections of a deadlock dump, as far as extraction goes.
+        enum section {
+            sectionScanning,
+            sectionGraph,
+            sectionRowsWaited,
+            sectionSQL,
+            sectionCurrentWait,
+            sectionWaitHistory,
+            sectionCount
+        };
 
     private:
+        // The trace file is only used while extracting, after that the
+        // deadlock stands alone, bar the trace text for its SQL.
+        friend class oraTraceFile;
         oraTraceFile *mTraceFile;
+        std::shared_ptr<const oraTraceText> mText;
         unsigned mLineNumber;
+        unsigned long long mStartOffset;
+        unsigned long long mEndOffset;
         string mDate;
         string mTime;
+        long long mEpoch;
+        bool mGlobal;
+        vector<oraGlobalLock> mGlobalLocks;
         map<unsigned, oraBlockerWaiter>mBlockers;
         map<unsigned, oraBlockerWaiter>mWaiters;
         vector<string> mSignatures;
-        vector<string>mWaitStack;
-        bool sigType(const string what);
-        bool extractDeadlockGraph();
-        bool extractRowsWaited();
-        bool extractCurrentSQL();
-        bool extractProcessState();
-        bool extractWaitStack();
+        vector<oraWaitEvent>mWaitStack;
+        bool sigType(const string what) const;
+        oraBlockerWaiter *waiterToUpdate(const unsigned session);
+        void extractDateTime();
+        bool mRejected;
+        bool mTruncated;            // The trace file ended first.
+
+        // Lines we couldn't make sense of. Noted, skipped, and carried on.
+        vector<string> mParseErrors;
+        void parseError(const string &what);
+        string location();
+        bool overBudget();
+
+        // Extraction state machine. See oraDeadlock.cpp.
+        struct extractContext;
+        typedef bool (oraDeadlock::*sectionHandler)(extractContext &ctx, const string &line);
+        static const sectionHandler mHandlers[sectionCount];
+        void enterSection(extractContext &ctx, const section next);
+        bool wanted(const section finished);
+        bool scanLine(extractContext &ctx, const string &line);
+        bool graphLine(extractContext &ctx, const string &line);
+        bool rowsWaitedLine(extractContext &ctx, const string &line);
+        bool sqlLine(extractContext &ctx, const string &line);
+        bool currentWaitLine(extractContext &ctx, const string &line);
+        bool waitHistoryLine(extractContext &ctx, const string &line);
         string mDeadlockWait;
-        string mAbortedSQL;
+
+        // Where the aborted SQL is in the trace file. It can be big, so it's
+        // only read, by SQL(), if someone wants it.
+        unsigned long long mSQLStart;
+        unsigned long long mSQLEnd;
 };
 
 #endif // ORADEADLOCK_H
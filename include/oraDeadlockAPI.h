@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORADEADLOCKAPI_H
+#define ORADEADLOCKAPI_H
+
+/*==============================================================================
+ * The C interface to the deadlock parser, for use from other languages without
+ * running DeadlockAnalysis and scraping its HTML. Build the "Library" target
+ * for a shared library containing this, oraTraceFile, oraDeadlock and
+ * oraBlockerWaiter, plus the bits they need.
+ *
+ *   dlaTrace *trace = dlaOpenFile("orcl_ora_1234.trc");
+ *   if (trace && dlaParse(trace) >= 0) {
+ *       dlaDeadlock dl;
+ *       while (dlaNext(trace, &dl)) {
+ *           ... dl.signature, dl.rows, dlaGraphRowAt(trace, dl.index, 0, &row) ...
+ *       }
+ *   }
+ *   dlaClose(trace);
+ *
+ * Everything returned is plain C structs of numbers and strings. The strings
+ * belong to the trace handle, and are only valid until the next call using
+ * the same handle. Copy anything you want to keep. A handle must not be used
+ * by two threads at once, different handles are fine.
+ *
+ * The layout of the structs only changes when DLA_ABI_VERSION does. Check
+ * dlaAbiVersion() against the version you were built with.
+ *==============================================================================
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DLA_ABI_VERSION 1
+
+#if defined(_WIN32) && defined(DLA_BUILD_LIBRARY)
+#define DLA_API __declspec(dllexport)
+#else
+#define DLA_API
+#endif
+
+/* An open trace file. Opaque. */
+typedef struct dlaTrace dlaTrace;
+
+/* About the trace file itself. */
+typedef struct dlaTraceInfo {
+    const char *traceName;
+    const char *originalPath;
+    const char *instanceName;
+    const char *systemName;
+    const char *serverName;
+    const char *oracleHome;
+    unsigned deadlockCount;
+    unsigned long long lines;
+    unsigned long long bytesRead;
+} dlaTraceInfo;
+
+/* One deadlock. */
+typedef struct dlaDeadlock {
+    unsigned index;                     /* For dlaGraphRowAt() etc. */
+    unsigned lineNumber;                /* Zero if not known. */
+    unsigned long long startOffset;     /* Byte offsets in the trace file. */
+    unsigned long long endOffset;
+    long long epoch;                    /* Seconds since 1970, zero if not known. */
+    const char *date;                   /* YYYY-MM-DD */
+    const char *time;                   /* HH:MM:SS */
+    const char *signature;              /* Comma separated, eg "TX-X-X". */
+    unsigned abortedSession;
+    const char *deadlockWait;           /* The wait event of the aborted session. */
+    const char *sql;                    /* The aborted SQL statement. */
+    unsigned rows;                      /* Deadlock graph rows. */
+    unsigned waits;                     /* Wait stack entries. */
+    unsigned globalLocks;               /* Global (RAC LMD) locks. */
+    int global;                         /* Non-zero for a global deadlock. */
+} dlaDeadlock;
+
+/* One row of a deadlock graph, a blocker and the session it blocks. */
+typedef struct dlaGraphRow {
+    const char *resourceName;
+    unsigned blockerProcess;
+    unsigned blockerSession;
+    const char *blockerHolds;
+    const char *blockerWaits;
+    unsigned waiterProcess;
+    unsigned waiterSession;
+    const char *waiterHolds;
+    const char *waiterWaits;
+    unsigned objectId;                  /* What the waiter was waiting for. */
+    unsigned file;
+    unsigned block;
+    unsigned slot;
+    const char *rowid;
+} dlaGraphRow;
+
+/* One entry from a deadlock's wait stack. */
+typedef struct dlaWait {
+    const char *event;
+    unsigned long long micros;
+    unsigned long long p1;
+    unsigned long long p2;
+    unsigned long long p3;
+} dlaWait;
+
+/* One lock from a global (RAC LMD) deadlock. */
+typedef struct dlaGlobalLock {
+    int blocker;                        /* Non-zero for BLOCKER, zero for BLOCKED. */
+    const char *lockAddress;
+    unsigned mode;
+    const char *resource;
+    const char *transaction;
+    unsigned instance;
+    unsigned session;                   /* Zero if not known. */
+} dlaGlobalLock;
+
+DLA_API int dlaAbiVersion(void);
+
+/* Opening. All return NULL on failure. A buffer is copied, a file descriptor
+ * is read to EOF, but not closed. The name is only used in the results. */
+DLA_API dlaTrace *dlaOpenFile(const char *path);
+DLA_API dlaTrace *dlaOpenBuffer(const char *name, const char *data, size_t length);
+DLA_API dlaTrace *dlaOpenFd(const char *name, int fd);
+
+/* Look for LMD global wait-for-graphs too. Call before dlaParse(). */
+DLA_API void dlaSetGlobalGraphs(dlaTrace *trace, int enable);
+
+/* Finds all the deadlocks. Returns how many, or -1 if parsing failed. */
+DLA_API int dlaParse(dlaTrace *trace);
+
+/* All return zero if there is nothing there, non-zero otherwise. */
+DLA_API int dlaInfo(dlaTrace *trace, dlaTraceInfo *info);
+DLA_API int dlaNext(dlaTrace *trace, dlaDeadlock *deadlock);
+DLA_API int dlaDeadlockAt(dlaTrace *trace, unsigned index, dlaDeadlock *deadlock);
+DLA_API int dlaGraphRowAt(dlaTrace *trace, unsigned index, unsigned row, dlaGraphRow *graphRow);
+DLA_API int dlaWaitAt(dlaTrace *trace, unsigned index, unsigned wait, dlaWait *waitEntry);
+DLA_API int dlaGlobalLockAt(dlaTrace *trace, unsigned index, unsigned lock, dlaGlobalLock *globalLock);
+
+/* Starts dlaNext() from the first deadlock again. */
+DLA_API void dlaRewind(dlaTrace *trace);
+
+/* The last error on this handle, or "" if none. This includes the last
+ * thing that couldn't be parsed in a deadlock fetched. */
+DLA_API const char *dlaError(dlaTrace *trace);
+
+DLA_API void dlaClose(dlaTrace *trace);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ORADEADLOCKAPI_H */
@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORADEADLOCKINDEX_H
+#define ORADEADLOCKINDEX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <cstdint>
+
+#include "oraParseResult.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::ostream;
+
+// The first 8 bytes of an index segment file.
+#define DEADLOCK_INDEX_MAGIC "DLAIDX01"
+
+// Once a month has more segments than this, they are merged into one.
+#define DEADLOCK_INDEX_MAX_SEGMENTS 8
+
+//==============================================================================
+// A history of every deadlock analysed, queried by object id, session, lock
+// signature, instance or aborted SQL, within a time window, without going back
+// to the trace files. The index is a directory of segment files. Each run adds
+// one new segment for each month its deadlocks happened in, named YYYYMM-N.dlx,
+// and nothing is ever changed once written, apart from merging a month's
+// segments when there are too many of them. A query only opens the segments
+// for the months it asks about.
+//
+// A segment file is:
+//
+// header   magic, number of records, number of postings, string pool size.
+// records  one per deadlock, when, where, the signatures and the SQL hash.
+// postings (key type, key, record number), sorted, so each key's records are
+//          found by binary search, already in order, ready to intersect.
+// strings  NUL terminated, each stored once.
+//
+// Keys are object ids and session ids as they are. Signatures are indexed
+// whole, and by their first one and two parts, "TX" and "TX-X" as well as
+// "TX-X-X", and, like instance names, by a 64 bit FNV-1a hash, checked against
+// the record when found. The SQL is hashed once its white space is squashed.
+//
+// Segments are memory mapped for queries, and are in the byte order of the
+// machine that wrote them. There should only be one run adding to an index at
+// any time.
+//==============================================================================
+class oraDeadlockIndex
+{
+    public:
+        // What to look for. Within each list, any value will do, and all
+        // the lists, that aren't empty, must match.
+        struct query {
+            bool hasSince = false;
+            long long since = 0;
+            bool hasUntil = false;
+            long long until = 0;
+            vector<unsigned> objectIds;
+            vector<unsigned> sessions;
+            vector<string> signatures;
+            vector<string> instances;
+            vector<uint64_t> sqlHashes;
+        };
+
+        oraDeadlockIndex(const string &directory);
+        virtual ~oraDeadlockIndex();
+        void add(const oraParseResult &result);
+        bool save();
+        unsigned find(const query &q, ostream &out);
+
+        static uint64_t sqlHash(const string &sql);
+
+    private:
+        enum keyType {
+            keyObject = 1,
+            keySession,
+            keySignature,
+            keyInstance,
+            keySQL
+        };
+
+        struct header {
+            char magic[8];
+            uint32_t recordCount;
+            uint32_t postingCount;
+            uint64_t stringsLength;
+        };
+
+        struct record {
+            int64_t epoch;
+            uint64_t sqlHash;
+            uint64_t startOffset;
+            uint32_t lineNumber;
+            uint32_t abortedSession;
+            uint32_t traceName;
+            uint32_t instance;
+            uint32_t signatures;
+            uint32_t global;
+        };
+
+        struct posting {
+            uint32_t type;
+            uint32_t record;
+            uint64_t key;
+        };
+
+        // A deadlock waiting to be saved, or read back from a segment.
+        struct entry {
+            long long epoch;
+            uint64_t sqlHash;
+            unsigned long long startOffset;
+            unsigned lineNumber;
+            unsigned abortedSession;
+            string traceName;
+            string instance;
+            string signatures;
+            bool global;
+            vector<std::pair<uint32_t, uint64_t>> keys;
+        };
+
+        class segment;
+
+        string mDirectory;
+        map<string, vector<entry>> mPending;   // By month, YYYYMM.
+
+        static uint64_t hash(const string &text);
+        static string monthOf(const long long epoch);
+        vector<std::pair<string, unsigned>> segments(const string &month);
+        bool writeSegment(const string &fileName, const vector<entry> &entries);
+        bool compact(const string &month);
+        static bool matches(const query &q, const segment &s, const uint32_t r);
+};
+
+#endif // ORADEADLOCKINDEX_H
@@ -30,7 +30,15 @@
 #include <fstream>
 #include <string>
 
-#include "oraTraceFile.h"
+#include "oraParseResult.h"
+#include "oraStats.h"
+#include "oraObjectDictionary.h"
+#include "oraAsyncFile.h"
+
+// A block is hot if the rows waited on in this many deadlocks are in it. The
+// report lists, at most, the hottest few.
+#define HOT_BLOCK_DEADLOCKS 2
+#define HOT_BLOCK_ROWS 20
 
 using std::ifstream;
 using std::ofstream;
@@ -41,32 +49,46 @@ using std::to_string;
 class oraDeadlockReport
 {
     public:
-        oraDeadlockReport(oraTraceFile *traceFile);
+        oraDeadlockReport(const oraParseResult *result, oraStats *stats,
+                          const size_t writeBehind = 0);
         bool good() { return mOFS->good(); }
         string reportName() { return mReportName; }
         virtual ~oraDeadlockReport();
         void report();
+        void setExcerpts(const bool val) { mExcerpts = val; }
+        void setObjects(const oraObjectDictionary *objects) { mObjects = objects; }
 
     protected:
 
     private:
-        oraTraceFile *mTraceFile;
+        const oraParseResult *mResult;
+        oraStats *mStats;
         string mReportName;
         string mCssName;
-        ofstream *mOFS;
+        std::unique_ptr<ostream> mOFS;
         void createCSSFile();
         void reportHeader();
         void reportFooter();
         void reportBody();
         void reportSidebar();
         void traceFileDetails();
+        void waitStatistics();
+        void hotBlocks();
         void quickIndex();
         void deadlocks();
-        void deadlockSummary(oraDeadlock *dl);
-        void deadlockGraph(oraDeadlock *dl);
-        void deadlockWaiters(oraDeadlock *dl);
+        void deadlockSummary(const oraDeadlock *dl);
+        void deadlockGraph(const oraDeadlock *dl);
+        void deadlockWaiters(const oraDeadlock *dl);
+        void deadlockExcerpt(const oraDeadlock *dl);
         void heading(const unsigned level, const string heading);
+
+        // Writes a block of static text, in one go, to the report.
+        template <size_t N>
+        void writeText(const char (&text)[N]) { mOFS->write(text, N - 1); }
+
         bool mCssExists;
+        bool mExcerpts;
+        const oraObjectDictionary *mObjects;
 
 };
 
@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAFILTER_H
+#define ORAFILTER_H
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+//==============================================================================
+// Decides which deadlocks are wanted. Applied while the trace file is being
+// read, so that unwanted deadlocks are skipped rather than extracted. The time
+// window is checked before a deadlock is extracted, signatures and SIDs as
+// soon as the deadlock graph has been extracted, and object ids as soon as
+// the rows waited on have been.
+//
+// Times are seconds since 1970-01-01 00:00:00 in whatever timezone the trace
+// was written in - we only ever compare them with each other.
+//==============================================================================
+class oraFilter
+{
+    public:
+        oraFilter();
+        virtual ~oraFilter();
+
+        bool hasSince() { return mHasSince; }
+        long long since() { return mSince; }
+        void setSince(const long long val) { mSince = val; mHasSince = true; }
+        bool hasUntil() { return mHasUntil; }
+        long long until() { return mUntil; }
+        void setUntil(const long long val) { mUntil = val; mHasUntil = true; }
+        bool hasTimeWindow() { return mHasSince || mHasUntil; }
+
+        // Each of these can have a list of values, any of which will match.
+        void addSignature(const string &val) { mSignatures.push_back(val); }
+        void addSession(const unsigned val) { mSessions.push_back(val); }
+        void addObjectId(const unsigned val) { mObjectIds.push_back(val); }
+        bool hasSignatureFilter() { return !mSignatures.empty(); }
+        bool hasSessionFilter() { return !mSessions.empty(); }
+        bool hasObjectFilter() { return !mObjectIds.empty(); }
+        const vector<string> &signatures() const { return mSignatures; }
+        const vector<unsigned> &sessions() const { return mSessions; }
+        const vector<unsigned> &objectIds() const { return mObjectIds; }
+        bool wantedSignatures(const vector<string> &signatures);
+        bool wantedSession(const unsigned session);
+        bool wantedObjectId(const unsigned objectId);
+
+        // Compared to the time window.
+        bool tooEarly(const long long when) { return mHasSince && when < mSince; }
+        bool tooLate(const long long when) { return mHasUntil && when > mUntil; }
+
+        static bool parseTimestamp(const string &text, long long &when);
+        static bool parseTimestamp(const char *text, const size_t length, long long &when);
+        static string formatTimestamp(const long long when);
+
+    private:
+        bool mHasSince;
+        long long mSince;
+        bool mHasUntil;
+        long long mUntil;
+        vector<string> mSignatures;
+        vector<unsigned> mSessions;
+        vector<unsigned> mObjectIds;
+};
+
+#endif // ORAFILTER_H
@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAHTMLESCAPE_H
+#define ORAHTMLESCAPE_H
+
+#include <string>
+#include <iostream>
+
+using std::string;
+using std::ostream;
+
+//==============================================================================
+// Escapes text from the trace file, or anywhere else outside, as it's written
+// to the report. Only '<', '>', '&' and '"' are changed, everything else is
+// copied straight to the stream, a clean run at a time.
+//
+// With SSE2, which every x86-64 has, sixteen bytes are checked at a time, so
+// big PL/SQL blocks, which have few special characters, cost little more than
+// copying them. Build with -DDEADLOCK_NO_SIMD to check a byte at a time.
+//
+//     *mOFS << oraHtmlEscape(dl->SQL());
+//     *mOFS << oraHtmlEscape(b->holds(), "&nbsp;");
+//
+// The second writes "&nbsp;", unescaped, if the text is empty.
+//==============================================================================
+class oraHtmlEscape
+{
+    public:
+        explicit oraHtmlEscape(const string &text, const char *ifEmpty = "") :
+            mText(text), mIfEmpty(ifEmpty) {}
+        static void write(ostream &out, const char *text, const size_t length);
+        friend ostream &operator<<(ostream &out, const oraHtmlEscape &escape);
+
+    private:
+        const string &mText;
+        const char *mIfEmpty;
+};
+
+#endif // ORAHTMLESCAPE_H
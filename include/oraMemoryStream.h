@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAMEMORYSTREAM_H
+#define ORAMEMORYSTREAM_H
+
+#include <istream>
+#include <streambuf>
+#include <cstddef>
+
+//==============================================================================
+// An input stream reading straight from a block of memory, without copying
+// it, so a trace file that is already in memory can be parsed just like one
+// on disc. Seeking works, which the time window binary search needs. The
+// memory must outlive the stream.
+//==============================================================================
+class oraMemoryBuffer : public std::streambuf
+{
+    public:
+        oraMemoryBuffer(const char *data, const size_t length) {
+            char *start = const_cast<char *>(data);
+            setg(start, start, start + length);
+        }
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                         std::ios_base::openmode which = std::ios_base::in) override {
+            if (!(which & std::ios_base::in)) {
+                return pos_type(off_type(-1));
+            }
+
+            char *target = (dir == std::ios_base::beg) ? eback() + off :
+                           (dir == std::ios_base::cur) ? gptr() + off : egptr() + off;
+            if (target < eback() || target > egptr()) {
+                return pos_type(off_type(-1));
+            }
+
+            setg(eback(), target, egptr());
+            return pos_type(target - eback());
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+};
+
+class oraMemoryStream : public std::istream
+{
+    public:
+        oraMemoryStream(const char *data, const size_t length) :
+            std::istream(nullptr), mBuffer(data, length) {
+            rdbuf(&mBuffer);
+        }
+
+    private:
+        oraMemoryBuffer mBuffer;
+};
+
+#endif // ORAMEMORYSTREAM_H
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAOBJECTDICTIONARY_H
+#define ORAOBJECTDICTIONARY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+// The first 8 bytes of a compiled dictionary file.
+#define OBJECT_DICTIONARY_MAGIC "DLAOBJ01"
+
+//==============================================================================
+// Resolves object ids, from the rows waited on, to owner, name and type. The
+// names come from a DBA_OBJECTS export, as CSV with a heading line, which is
+// compiled, once, into a dictionary file:
+//
+// header   magic, number of objects, size of the string pool.
+// records  one per object, sorted by object id. Each is the object id and
+//          the offsets of its owner, name and type in the string pool.
+// strings  NUL terminated. Owners and types are only stored once.
+//
+// The dictionary file is memory mapped, so opening it costs next to nothing,
+// however big it is, and a lookup is a binary search touching a few pages.
+// The file is in the byte order of the machine that compiled it.
+//==============================================================================
+class oraObjectDictionary
+{
+    public:
+        oraObjectDictionary();
+        virtual ~oraObjectDictionary();
+        static bool compile(const string &csvName, const string &dictionaryName);
+        bool open(const string &dictionaryName);
+        bool lookup(const unsigned objectId, const char *&owner,
+                    const char *&name, const char *&type) const;
+        unsigned long long size() const { return mCount; }
+
+    private:
+        struct header {
+            char magic[8];
+            uint64_t count;
+            uint64_t stringsLength;
+        };
+
+        struct record {
+            uint32_t objectId;
+            uint32_t owner;
+            uint32_t name;
+            uint32_t type;
+        };
+
+        // The whole file, mapped, or read into mCopy where we can't map it.
+        const char *mData;
+        size_t mLength;
+        bool mMapped;
+        vector<char> mCopy;
+
+        const record *mRecords;
+        uint64_t mCount;
+        const char *mStrings;
+        uint64_t mStringsLength;
+
+        void close();
+};
+
+#endif // ORAOBJECTDICTIONARY_H
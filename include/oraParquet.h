@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAPARQUET_H
+#define ORAPARQUET_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+// A row group is written once it has this many rows, or this many bytes of
+// values, whichever comes first. That's all that's ever held in memory.
+#define PARQUET_ROW_GROUP_ROWS 65536
+#define PARQUET_ROW_GROUP_BYTES (64 * 1024 * 1024)
+
+//==============================================================================
+// Writes an Apache Parquet file, with no help from any library. Only what we
+// need is here. Flat schemas of required columns, which are 32 or 64 bit
+// integers, millisecond timestamps, booleans or UTF-8 strings, and strings can
+// be dictionary encoded. There's one uncompressed page per column per row
+// group, and the file metadata is Thrift compact protocol, encoded by hand.
+//
+// Add the columns, then, for each row, add a value to every column, in the
+// order they were added, and end the row. Close when done, or the file has
+// no footer, and isn't a Parquet file.
+//==============================================================================
+class oraParquetWriter
+{
+    public:
+        enum columnType {
+            int32Column,
+            int64Column,
+            timestampColumn,        // Milliseconds since 1970.
+            boolColumn,
+            stringColumn,
+            dictionaryColumn        // A string with few distinct values.
+        };
+
+        oraParquetWriter(const string &fileName, const string &createdBy);
+        virtual ~oraParquetWriter();
+        void addColumn(const string &name, const columnType type);
+        void add(const long long value);
+        void add(const string &value);
+        void endRow();
+        bool close();
+        bool good() const { return mFile.good(); }
+        unsigned long long rows() const { return mRows; }
+
+    private:
+        // Where each column's pages went, for the footer.
+        struct chunkInfo {
+            uint64_t start;
+            uint64_t dictionaryPageOffset;
+            uint64_t dataPageOffset;
+            uint64_t size;
+            uint64_t values;
+        };
+
+        struct column {
+            string name;
+            columnType type;
+            string values;                          // PLAIN encoded.
+            vector<uint32_t> indices;               // Dictionary columns.
+            std::unordered_map<string, uint32_t> dictionary;
+            string dictionaryValues;                // PLAIN encoded.
+            vector<chunkInfo> chunks;               // One per row group.
+        };
+
+        struct rowGroupInfo {
+            uint64_t rows;
+            uint64_t bytes;
+        };
+
+        std::ofstream mFile;
+        string mCreatedBy;
+        uint64_t mOffset;
+        vector<column> mColumns;
+        vector<rowGroupInfo> mRowGroups;
+        unsigned mNextColumn;
+        uint64_t mRows;
+        uint64_t mGroupRows;
+        uint64_t mGroupBytes;
+        bool mClosed;
+
+        void write(const string &bytes);
+        void writeRowGroup();
+        void writePage(const int pageType, const uint32_t values, const int encoding,
+                       const string &data);
+        string footer();
+};
+
+#endif // ORAPARQUET_H
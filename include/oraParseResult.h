@@ -0,0 +1,79 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAPARSERESULT_H
+#define ORAPARSERESULT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "oraTraceFile.h"
+#include "oraDeadlock.h"
+#include "oraTraceText.h"
+
+using std::string;
+using std::vector;
+
+//==============================================================================
+// The results of parsing a trace file, standing on their own. Nothing in here
+// changes once made, and nothing refers back to the oraTraceFile, so a single
+// parse can be shared between threads. The HTML report, JSON and CSV can all
+// be written at the same time, for example.
+//
+// Making one takes the deadlocks from the trace file, so do it once the trace
+// file has been parsed, and use this, rather than the trace file, after that.
+//==============================================================================
+class oraParseResult
+{
+    public:
+        oraParseResult(oraTraceFile &traceFile);
+        virtual ~oraParseResult();
+        const string &traceName() const { return mTraceName; }
+        const string &originalPath() const { return mOriginalPath; }
+        const string &instanceName() const { return mInstanceName; }
+        const string &oracleHome() const { return mOracleHome; }
+        const string &systemName() const { return mSystemName; }
+        const string &serverName() const { return mServerName; }
+        bool timedOut() const { return mTimedOut; }
+        unsigned deadlockCount() const { return mDeadlocks.size(); }
+        const oraDeadlock *deadLock(const unsigned index) const;
+        string excerpt(const oraDeadlock *dl) const;
+        string outputName(const string &extension) const;
+        void toJSON(ostream &out) const;
+        void toCSV(ostream &out) const;
+
+    private:
+        const string mTraceName;
+        const string mOriginalPath;
+        const string mInstanceName;
+        const string mOracleHome;
+        const string mSystemName;
+        const string mServerName;
+        const bool mTimedOut;
+        const vector<oraDeadlock> mDeadlocks;
+        const std::shared_ptr<const oraTraceText> mText;
+};
+
+#endif // ORAPARSERESULT_H
@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAPARSERCOMPARE_H
+#define ORAPARSERCOMPARE_H
+
+#include <string>
+#include <iostream>
+
+#include "oraReferenceParser.h"
+#include "oraDeadlock.h"
+
+using std::string;
+using std::ostream;
+
+// Only this many mismatches are listed per trace file, the rest are counted.
+#define COMPARE_MAX_LISTED 20
+
+//==============================================================================
+// Parses trace files twice, once with oraReferenceParser, the original line
+// based extractor, and once with oraTraceFile, as a normal run does, compares
+// every field of every deadlock, and times both.
+//
+// Deadlocks are matched up by line number. Those the reference couldn't
+// extract completely, and RAC global deadlocks, which it knows nothing about,
+// are skipped, the real parser is meant to do better than the reference there.
+// So are deadlocks only the real parser found. Anything else that differs is
+// a mismatch, and is listed.
+//==============================================================================
+class oraParserCompare
+{
+    public:
+        oraParserCompare(ostream &out, const unsigned long long deadlockBudget);
+        virtual ~oraParserCompare();
+        bool compare(const string &traceName);
+        void summary();
+        unsigned long long mismatches() const { return mMismatches; }
+
+    private:
+        ostream &mOut;
+        unsigned long long mDeadlockBudget;
+        string mTraceName;
+        unsigned mFileMismatches;
+        unsigned long long mMismatches;
+        unsigned mFiles;
+        double mReferenceSeconds;
+        double mOptimisedSeconds;
+
+        void mismatch(const unsigned line, const string &what,
+                      const string &reference, const string &optimised);
+        void check(const unsigned line, const string &what,
+                   const string &reference, const string &optimised);
+        void check(const unsigned line, const string &what,
+                   const unsigned long long reference, const unsigned long long optimised);
+        void compareDeadlock(const oraReferenceDeadlock &ref, const oraDeadlock &dl);
+        void compareSession(const unsigned line, const string &what,
+                            const oraBlockerWaiter &ref, const oraBlockerWaiter *bw);
+};
+
+#endif // ORAPARSERCOMPARE_H
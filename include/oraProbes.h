@@ -0,0 +1,93 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAPROBES_H
+#define ORAPROBES_H
+
+//==============================================================================
+// Static (USDT) tracepoints for perf, bpftrace, SystemTap etc. These are only
+// compiled in when DEADLOCK_USDT is defined, which needs <sys/sdt.h> from the
+// systemtap-sdt-dev (Debian) or systemtap-sdt-devel (Red Hat) package. When
+// enabled, each probe is a single NOP in the code plus a note in the ELF file,
+// and they survive inlining, unlike function entry/return uprobes. When not
+// enabled, they compile to nothing at all.
+//
+// All probes are in the "DeadlockAnalysis" provider:
+//
+// file__open       (traceName)
+// file__close      (traceName, lines, bytesRead)
+// deadlock__start  (lineNumber, byteOffset)
+// deadlock__end    (lineNumber, byteOffset, ok)
+// phase__start     (phaseName, lines, bytesRead)
+// phase__end       (phaseName, lines, bytesRead, nanoseconds)
+// report__open     (reportName)
+// report__close    (reportName, bytesWritten)
+//
+// Phases are the extract*() steps in oraDeadlock and the report sections
+// in oraDeadlockReport. Those timed by an oraPhaseTimer report the lines and
+// bytes read so far, counts rather than positions, as most aren't reading.
+// The sections of each deadlock, "scanDeadlock", "extractDeadlockGraph" and
+// so on, report the reader's line number and byte offset instead, as the
+// deadlock probes do. After a --since seek only the byte offsets are exact.
+//
+// For example, a histogram of the time taken to extract the deadlock graphs:
+//
+//  bpftrace -e 'usdt:./DeadlockAnalysis:DeadlockAnalysis:phase__end
+//               /str(arg0) == "extractDeadlockGraph"/ { @ns = hist(arg3); }'
+//==============================================================================
+
+#ifdef DEADLOCK_USDT
+
+#include <sys/sdt.h>
+
+// The phase__end probe needs the phases timing, even without --stats.
+#define ORA_PROBES_COMPILED true
+
+#define ORA_PROBE1(name, a) \
+    DTRACE_PROBE1(DeadlockAnalysis, name, a)
+#define ORA_PROBE2(name, a, b) \
+    DTRACE_PROBE2(DeadlockAnalysis, name, a, b)
+#define ORA_PROBE3(name, a, b, c) \
+    DTRACE_PROBE3(DeadlockAnalysis, name, a, b, c)
+#define ORA_PROBE4(name, a, b, c, d) \
+    DTRACE_PROBE4(DeadlockAnalysis, name, a, b, c, d)
+
+#else
+
+#define ORA_PROBES_COMPILED false
+
+// The sizeof() keeps the compiler quiet about arguments only used by the
+// probes, without evaluating them.
+#define ORA_PROBE1(name, a) \
+    do { (void) sizeof(a); } while (0)
+#define ORA_PROBE2(name, a, b) \
+    do { (void) sizeof(a); (void) sizeof(b); } while (0)
+#define ORA_PROBE3(name, a, b, c) \
+    do { (void) sizeof(a); (void) sizeof(b); (void) sizeof(c); } while (0)
+#define ORA_PROBE4(name, a, b, c, d) \
+    do { (void) sizeof(a); (void) sizeof(b); (void) sizeof(c); (void) sizeof(d); } while (0)
+
+#endif // DEADLOCK_USDT
+
+#endif // ORAPROBES_H
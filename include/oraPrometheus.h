@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAPROMETHEUS_H
+#define ORAPROMETHEUS_H
+
+#include <string>
+#include <map>
+
+#include "oraTraceFile.h"
+#include "oraDeadlock.h"
+#include "oraStats.h"
+#include "oraFilter.h"
+
+using std::string;
+using std::map;
+
+// Wait duration histogram bucket upper bounds, in microseconds, and as the
+// "le" labels. Anything longer goes in the +Inf bucket.
+#define PROMETHEUS_BUCKETS 7
+
+//==============================================================================
+// Writes deadlock metrics as a Prometheus textfile, for the node_exporter
+// textfile collector. There is a counter of deadlocks by instance, signature
+// and object id, and a histogram of the aborted sessions' wait durations by
+// instance and wait event. The instance label is "oracle_instance", as
+// Prometheus uses "instance" for the target it scraped.
+//
+// The counters are kept, per trace file, in a state file next to the .prom
+// file, along with how far each trace file has been read. A rerun only reads
+// what has been added to each trace file since. Trace files that have gone
+// away keep their counts, so the counters never go down. A trace file that
+// has shrunk, has a different inode, or is the same size but has been written
+// to since, has been replaced, and the new one is read from the start.
+//
+// Both files are written to a temporary file first, then renamed, so that the
+// collector never sees half a file.
+//==============================================================================
+class oraPrometheus
+{
+    public:
+        oraPrometheus(const string promName);
+        virtual ~oraPrometheus();
+        bool load();
+        void update(const string &traceName, oraFilter *filter, oraStats &totalStats);
+        bool save();
+
+    private:
+        struct histogram {
+            unsigned long long count = 0;
+            unsigned long long sumMicros = 0;
+            unsigned long long buckets[PROMETHEUS_BUCKETS + 1] = {};
+        };
+
+        // Everything we know about one trace file. The map keys are the
+        // label values, separated by tabs.
+        struct traceState {
+            unsigned long long size = 0;
+            unsigned long long offset = 0;
+            unsigned long long inode = 0;
+            long long mtime = 0;
+            map<string, unsigned long long> counters;
+            map<string, histogram> histograms;
+        };
+
+        string mPromName;
+        string mStateName;
+        map<string, traceState> mTraces;
+
+        void add(traceState &state, oraTraceFile &traceFile, oraDeadlock &dl);
+        bool writeAtomically(const string &fileName, const string &contents);
+};
+
+#endif // ORAPROMETHEUS_H
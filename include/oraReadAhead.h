@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAREADAHEAD_H
+#define ORAREADAHEAD_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using std::string;
+using std::vector;
+
+// Read files in chunks of this size.
+#define READ_AHEAD_CHUNK (1024 * 1024)
+
+// Stop reading ahead when this much is waiting to be parsed. The next file is
+// always read, however big it is.
+#define READ_AHEAD_BYTES (256ULL * 1024 * 1024)
+
+//==============================================================================
+// Reads a list of trace files into memory, in the background, so that the
+// I/O for the next files overlaps with parsing the current one. On Linux, the
+// opens and reads are submitted through io_uring, with up to queueDepth of
+// them in flight at once. Where io_uring isn't available, a background thread
+// reads each file with plain pread() instead.
+//
+// The files are handed out, in order, by next().
+//==============================================================================
+class oraReadAhead
+{
+    public:
+        oraReadAhead(const vector<string> &fileNames, const unsigned queueDepth);
+        virtual ~oraReadAhead();
+        bool next(string &buffer);
+        bool usingUring() { return mUsingUring; }
+
+    private:
+        struct file {
+            string name;
+            int fd = -1;
+            unsigned long long size = 0;
+            unsigned long long submitted = 0;   // Bytes asked for.
+            unsigned long long completed = 0;   // Bytes read.
+            unsigned inFlight = 0;
+            bool opening = false;
+            bool open = false;
+            bool done = false;
+            bool failed = false;
+            string buffer;
+        };
+
+        vector<file> mFiles;
+        unsigned mQueueDepth;
+        bool mUsingUring;
+
+        // Shared with the reader thread.
+        std::mutex mMutex;
+        std::condition_variable mChanged;
+        size_t mConsumed;
+        unsigned long long mBufferedBytes;
+        bool mStopping;
+        std::thread mReader;
+
+        bool wanted(const size_t index);
+        void finished(file &f, const bool ok);
+        bool opened(file &f);
+        void readAll();
+        void readAllUring();
+};
+
+#endif // ORAREADAHEAD_H
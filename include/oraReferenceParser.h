@@ -0,0 +1,102 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAREFERENCEPARSER_H
+#define ORAREFERENCEPARSER_H
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <map>
+
+#include "oraBlockerWaiter.h"
+
+using std::string;
+using std::ifstream;
+using std::vector;
+using std::map;
+
+//==============================================================================
+// One deadlock, as the reference parser saw it. The wait stack is kept as the
+// event name and the "total=" text, the SQL as the lines joined together.
+//==============================================================================
+struct oraReferenceDeadlock {
+    unsigned lineNumber = 0;
+    string date;
+    string time;
+    map<unsigned, oraBlockerWaiter> blockers;
+    map<unsigned, oraBlockerWaiter> waiters;
+    vector<string> signatures;
+    vector<std::pair<string, string>> waitStack;
+    string deadlockWait;
+    string SQL;
+    bool complete = false;      // False if a section was missing, or broken.
+};
+
+//==============================================================================
+// The original line based deadlock extractor, kept as a reference to check the
+// real one against. It reads a line at a time, with getline(), and searches for
+// each section of a deadlock dump in turn, the way DeadlockAnalysis did up to
+// version 0.1.5. It's slow, and gets lost in broken trace files, but it's
+// simple enough to be sure of what it does.
+//
+// It isn't quite the 0.1.5 code. A few things that version got wrong are put
+// right, so they don't show up as differences every time: block numbers are
+// read as unsigned long, they can be over 2^31, a rowid is only taken from a
+// line long enough to have one, the date and time are only taken from a line
+// with two spaces in it, and "\r\n" line ends are allowed for.
+//
+// Nothing else uses it. Don't make it faster, or cleverer, that's the point.
+//==============================================================================
+class oraReferenceParser
+{
+    public:
+        oraReferenceParser(const string &traceName);
+        virtual ~oraReferenceParser();
+        bool good() const { return mIFS.good(); }
+        unsigned parse();
+        const vector<oraReferenceDeadlock> &deadlocks() const { return mDeadlocks; }
+
+    private:
+        ifstream mIFS;
+        unsigned mLineNumber;
+        string mPreviousLine;
+        string mCurrentLine;
+        vector<oraReferenceDeadlock> mDeadlocks;
+        bool mExtracting;           // Inside a deadlock.
+        bool mOverrun;              // And read into the next one.
+
+        string readLine();
+        string trimmedLine() const;
+        bool findAtStart(const string &lookFor, const bool stopAtEndOfDeadlock = true);
+        bool findNearStart(const string &lookFor, const bool stopAtEndOfDeadlock = true);
+        bool extractDeadlock(oraReferenceDeadlock &dl);
+        bool extractDeadlockGraph(oraReferenceDeadlock &dl);
+        bool extractRowsWaited(oraReferenceDeadlock &dl);
+        bool extractCurrentSQL(oraReferenceDeadlock &dl);
+        bool extractProcessState(oraReferenceDeadlock &dl);
+        bool extractWaitStack(oraReferenceDeadlock &dl);
+};
+
+#endif // ORAREFERENCEPARSER_H
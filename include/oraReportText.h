@@ -0,0 +1,420 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAREPORTTEXT_H
+#define ORAREPORTTEXT_H
+
+//==============================================================================
+// All the static text written to the HTML report and its stylesheet lives
+// here, as compile time constants. Each block goes out in a single write with
+// only the dynamic fields, if any, being written in between. See the
+// writeText() helper in oraDeadlockReport.
+//==============================================================================
+
+
+//------------------------------------------------------------------------------
+// The default stylesheet, DeadlockAnalysis.css. Only written if there isn't one
+// already in the trace file's directory. (Some lines have trailing spaces, keep
+// them, they have always been there!)
+//------------------------------------------------------------------------------
+static const char cssText[] = R"css(body {
+    margin: 0;
+    padding: 0;
+    background: rgb(95%, 95%, 80%);
+    color: black;
+}
+
+table, th, td {
+    border: 1px solid rgb(85%,85%,70%);
+    padding-left: 4px;
+    padding-right: 4px;
+    padding-top: 2px;
+    padding-bottom: 2px;
+    vertical-align: top;
+}
+
+table {
+    border-collapse: collapse;
+    background: beige;
+    font-size: smaller;
+    table-layout: fixed;
+    /* margin-left: 2.5%; */
+}
+
+pre {
+    white-space: pre-wrap;
+    word-break: keep-all;
+    font: 100% mono;
+}
+
+th {
+    background: rgb(90%,90%,75%);
+}
+
+.number {
+    text-align: right;
+}
+
+.left {
+    text-align: left;
+}
+
+.middle {
+    text-align: center;
+}
+
+.right {
+    text-align: right;
+}
+
+.th_tiny {
+    width: 10%;
+}
+
+/* 
+ * Used to hide the top left cell in the Deadlock Graph table. 
+ */ 
+.th_background { 
+    background: rgb(95%, 95%, 80%); 
+    border-top: 1px solid rgb(95%, 95%, 80%); 
+    border-left: 1px solid rgb(95%, 95%, 80%); 
+}
+
+.th_small {
+    width: 12%;
+}
+
+.th_medium {
+    width: 20%;
+}
+
+.th_large {
+    width: 40%;
+}
+
+.th_small {
+    width: 12%;
+}
+
+ul {
+    font-size: 0.7em;
+}
+
+li {
+}
+
+/*
+ * Analysis Header details. 
+ * Feel free to modify these to suit your style requirements.
+ */
+#TraceFile {
+    font-weight: bold;
+}
+
+#SystemName {
+}
+
+#ServerName {
+}
+
+#OracleHome {
+}
+
+#InstanceName {
+    font-weight: bold;
+}
+
+#AnalysisResult {
+}
+
+#DeadlockWait {
+    font-weight: bold;
+}
+
+#DeadlockSignature {
+}
+
+#DeadlockCause {
+    color: red;
+    font-weight: bold;
+}
+
+#WaitStack {
+}
+
+/*
+ * If the analysis found deadlocks, change the highlighting.
+ */
+.nonZero {
+    color: red;
+    font-weight: bold;
+}
+
+/*
+ * Footer Stuff
+ */
+.footer {
+    text-align: center;
+    font-size: x-small;
+}
+
+.url {
+    color: blue;
+    font: mono;
+}
+
+/* Sidebar stuff - stays still when scrolling */
+div {
+    display: block;
+}
+
+div#entry {
+    padding-left: 15%;
+}
+
+div#sidebar {
+    position: fixed;
+    top: 8;
+    left: 4;
+    width: 10%;
+    margin: 0 0 0 2;
+    text-align: center;
+    border-bottom: 1px solid rgb(95%,95%,80%);
+}
+
+#sidebar h4 {
+    border: 1px solid rgb(73%,73%,58%);
+    border-bottom: none;
+    background: rgb(90%,90%,75%);
+}
+
+#sidebar ul {
+    list-style: none;
+    margin: 0;
+    padding: 0 0 2em;
+    border: 1px solid rgb(73%,73%,58%);
+    background: beige;
+}
+
+#sidebar h4, #sidebar ul {
+    margin: 0 6px 0 0;
+}
+
+#sidebar li {
+    padding: 0.5em 0;
+    line-height: 1em;
+    border-bottom: 1px solid rgb(84%,84%,69%);
+}
+
+#sidebar a {
+    text-decoration: none;
+    padding: 0 0.25em;
+    border: 1px solid rgb(84%,84%,69%);
+    background: rgb(95%,95%,80%);
+    position: relative; top: 1em;
+}
+
+#sidebar a:link {
+   color: rgb(20%,40%,0%);
+}
+
+#sidebar a:visited {
+   color: rgb(58%,68%,40%);
+}
+
+#sidebar a:hover {
+   color: rgb(10%,20%,0%);
+   background: #FFF;
+}
+
+
+)css";
+
+
+//------------------------------------------------------------------------------
+// HTML header, sidebar and footer.
+//------------------------------------------------------------------------------
+static const char htmlHeader[] =
+    "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0 Transitional//EN\"\n\t"
+    "\thttp://www.w3.org/TR/REC-html40/loose.dtd\">"
+    "<html>\n"
+    "<head>\n"
+    "<title>Deadlock Analysis</title>\n"
+    "<link rel=\"stylesheet\" href=\"DeadlockAnalysis.css\">\n"
+    "</head>\n"
+    "<body>\n\n";
+
+static const char sidebarStart[] =
+    "<div id=\"sidebar\">\n"
+    "<h4>Contents</h4>\n"
+    "<ul>\n";
+
+static const char sidebarEnd[] =
+    "</ul>\n"
+    "</div>\n\n";
+
+static const char footerStart[] =
+    "<p></p>\n<hr>\n"
+    "<p class=\"footer\">\n\t"
+    "Created with <strong>";
+
+// Program name and version go in between these two.
+
+static const char footerMiddle[] =
+    "</strong><br>Copyright &copy; ";
+
+// Program author goes in between these two.
+
+static const char footerEnd[] =
+    " 2017-2019<br>\n\t"
+    "Released under the <a href=\"https://opensource.org/licenses/MIT\"><span class=\"url\">MIT Licence</span></a><br><br>\n\t"
+    "Binary releases available from: "
+    "<a href=\"https://github.com/NormanDunbar/DeadlockAnalysys/releases\">"
+    "<span class=\"url\">https://github.com/NormanDunbar/DeadlockAnalysys/releases</span></a><br>\n\t"
+    "Source code available from: "
+    "<a href=\"https://github.com/NormanDunbar/DeadlockAnalysys\">"
+    "<span class=\"url\">https://github.com/NormanDunbar/DeadlockAnalysys</span></a>\n</p>\n\n"
+    "</div>\n\n"
+    "</body>\n"
+    "</html>\n";
+
+
+//------------------------------------------------------------------------------
+// Table headings for the deadlock graph, waiters and wait statistics sections.
+//------------------------------------------------------------------------------
+static const char graphHeadings[] =
+    "<table  style=\"width:95%\">\n"
+    "<tr>\n\t<th class=\"th_medium th_background\">&nbsp;</th>\n\t"
+    "<th colspan=4 class=\"th_large\">Blockers</th>\n\t"
+    "<th colspan=4 class=\"th_large\">Waiters</th>\n</tr>\n"
+    "<tr>\n\t<th>Resource Name</th>\n\t"
+    "<th>Process</th>\n\t"
+    "<th>SID</th>\n\t"
+    "<th>Holding</th>\n\t"
+    "<th>Waiting</th>\n\t"
+    "<th>Process</th>\n\t"
+    "<th>SID</th>\n\t"
+    "<th>Holding</th>\n\t"
+    "<th>Waiting</th>\n\t"
+    "\n</tr>\n";
+
+static const char waiterHeadings[] =
+    "<table  style=\"width:95%\">\n"
+    "<tr>\n\t<th class=\"th_medium\">Resource Name</th>\n\t"
+    "<th class=\"th_tiny\">SID</th>\n\t"
+    "<th class=\"th_tiny\">Blocker</th>\n\t"
+    "<th class=\"th_medium\">Rowid Waited</th>\n\t"
+    "<th class=\"th_tiny\">File No.</th>\n\t"
+    "<th class=\"th_tiny\">Block No.</th>\n\t"
+    "<th class=\"th_tiny\">Slot No.</th>\n\t"
+    "<th class=\"th_tiny\">Object Id</th>\n"
+    "</tr>\n";
+
+// As above, with the object's name, when there's an object dictionary.
+static const char waiterHeadingsNamed[] =
+    "<table  style=\"width:95%\">\n"
+    "<tr>\n\t<th class=\"th_medium\">Resource Name</th>\n\t"
+    "<th class=\"th_tiny\">SID</th>\n\t"
+    "<th class=\"th_tiny\">Blocker</th>\n\t"
+    "<th class=\"th_medium\">Rowid Waited</th>\n\t"
+    "<th class=\"th_tiny\">File No.</th>\n\t"
+    "<th class=\"th_tiny\">Block No.</th>\n\t"
+    "<th class=\"th_tiny\">Slot No.</th>\n\t"
+    "<th class=\"th_tiny\">Object Id</th>\n\t"
+    "<th class=\"th_medium\">Object</th>\n"
+    "</tr>\n";
+
+
+static const char waitStatsHeadings[] =
+    "<table  style=\"width:95%\">\n"
+    "<tr>\n\t<th class=\"th_large\">Wait Event</th>\n\t"
+    "<th class=\"th_tiny\">Waits</th>\n\t"
+    "<th class=\"th_small\">Total</th>\n\t"
+    "<th class=\"th_small\">Median</th>\n\t"
+    "<th class=\"th_small\">95th Percentile</th>\n\t"
+    "<th class=\"th_small\">Maximum</th>\n"
+    "</tr>\n";
+
+static const char hotBlocksHeadings[] =
+    "<table  style=\"width:95%\">\n"
+    "<tr>\n\t<th class=\"th_tiny\">File</th>\n\t"
+    "<th class=\"th_small\">Block</th>\n\t"
+    "<th class=\"th_small\">Object ID</th>\n\t"
+    "<th class=\"th_small\">Data Object ID</th>\n\t"
+    "<th class=\"th_tiny\">Deadlocks</th>\n\t"
+    "<th class=\"th_tiny\">Waiters</th>\n\t"
+    "<th class=\"th_tiny\">Modes</th>\n"
+    "</tr>\n";
+
+
+//------------------------------------------------------------------------------
+// Probable cause explanations for the deadlock summary.
+//------------------------------------------------------------------------------
+static const char causeUL[] =
+    "\t\t User defined locking - you are, unfortunately, on your own!<br><br>\n"
+    "\t\t Check for inappropriate use of DBMS_LOCK, LOCK TABLE or SELECT FOR UPDATE.<br>\n";
+
+static const char causeITL[] =
+    "\t\t Insufficient ITL entries (See docId 1552191.1);<br><br>\n"
+    "\t\t Increase the INITRANS settings on the affected object (see below) and<br>\n"
+    "\t\t then <strong>ALTER <object_type> xxx MOVE;</strong> to make the change stick.<br>\n";
+
+static const char causeBitmapOrKey[] =
+    "\t\t Bitmap indexes (See docId 1552175.1);<br><br>\n"
+    "\t\t If the objects (see below) are bitmap indexes, then that's your problem.<br>\n"
+    "\t\t Those should not be used in an OLTP or in <em>frequently</em> updated system. Change them<br>\n"
+    "\t\t to normal type indexes and watch  the deadlocks vanish!<br><hr>\n"
+    //
+    "\t\t Manipulation of primary/unique key in an inconsistent order (See docId 1552191.1).<br><br>\n"
+    "\t\t The sessions are, apparently, attempting to maintain numerous rows with the same Primary<br>\n"
+    "\t\t or Unique Key. Are you using sequence numbers based on a table, rather than on sequences?<br><br>\n"
+    "\t\t If one or more of the waiters is showing 'no rows' in the waited on rowid, <em>and</em> at least <br>\n"
+    "\t\t one other is an index object, then this is the most likely cause of this type of deadlock.<br>\n";
+
+static const char causeTM[] =
+    "\t\t Unindexed FK constraint columns (See docId 1552169.1).<br><br>\n"
+    "\t\t If a parent table's referenced column(s) can be deleted or updated<br>\n"
+    "\t\t or, if the data are ever retrieved using a join between the parent and child<br>\n"
+    "\t\t on the FK column(s), then the child table's FK column(s) must be indexed.<br>\n";
+
+static const char causeSelfDeadlock[] =
+    "\t\t Self deadlock - with an autonomous transaction (See docId 1552173); or,<br>\n"
+    "\t\t Self deadlock - without an autonomous transaction (See docId 1552123).<br><br>\n"
+    "\t\t The main code has fired off an autonomous transaction, perhaps, and that is waiting to<br>\n"
+    "\t\t update rows held by the main transaction. Fix the code to avoid this situation.<br>\n";
+
+static const char causeApplication[] =
+    "\t\t Deadlock caused by application code (See docId 1552120.1).<br><br>\n"
+    "\t\t The code is updating rows in different orders, most likely, and this is best<br>\n"
+    "\t\t avoided. Make sure that the code gets object data in the same order (alphabetic?)<br>\n"
+    "\t\t to avoid this type of deadlock.<br>\n";
+
+static const char causeUnknown[] =
+    "\t\t Deadlock cause unknown. Please zip and send this trace file - after obfuscating any personal\n"
+    "\t\t data or server names, IP addresses, just in case - to Norm via Github as an issue\n"
+    "\t\t and he'll attempt to find the cause and fix the code to avoid this in future.<br><br>\n"
+    "\t\t The Issues URL is <a href=\"https://github.com/NormanDunbar/DeadlockAnalysys/issues\">"
+    "<span class=\"url\">https://github.com/NormanDunbar/DeadlockAnalysys/issues</span></a>.<br>";
+
+#endif // ORAREPORTTEXT_H
@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAROWID_H
+#define ORAROWID_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <iostream>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::set;
+using std::ostream;
+
+class oraDeadlock;
+
+//==============================================================================
+// An extended rowid, such as AATFxWAQAAOgakFAAA, taken apart. The 18 base64
+// characters are OOOOOO FFF BBBBBB RRR, the data object id, relative file
+// number, block and row. The data object id is not always the dictionary
+// object id, a truncate gives the segment a new one.
+//==============================================================================
+class oraRowid
+{
+    public:
+        oraRowid();
+
+        unsigned dataObjectId() const { return mDataObjectId; }
+        unsigned file() const { return mFile; }
+        unsigned block() const { return mBlock; }
+        unsigned row() const { return mRow; }
+
+        static bool decode(const string &rowid, oraRowid &result);
+
+    private:
+        unsigned mDataObjectId;
+        unsigned mFile;
+        unsigned mBlock;
+        unsigned mRow;
+};
+
+
+//==============================================================================
+// Counts the rows waited on, in any number of deadlocks, by the block they are
+// in. A block which keeps turning up is usually short of ITL slots, or is a
+// bitmap index block, rather than an application getting its locking order
+// wrong. Deadlocks are counted once per block, however many of their waiters
+// wanted rows in it.
+//==============================================================================
+class oraHotBlocks
+{
+    public:
+        struct blockSummary {
+            unsigned file;
+            unsigned block;
+            unsigned objectId;
+            unsigned dataObjectId;
+            unsigned long long deadlocks;
+            unsigned long long waiters;
+            string modes;
+        };
+
+        void add(const oraDeadlock &dl);
+        void merge(const oraHotBlocks &other);
+        bool empty() const { return mBlocks.empty(); }
+        vector<blockSummary> summary(const unsigned long long minDeadlocks = 1) const;
+        static void csvHeader(ostream &out);
+        void toCSV(ostream &out, const unsigned long long minDeadlocks = 1) const;
+
+    private:
+        struct blockCounts {
+            unsigned objectId = 0;
+            unsigned dataObjectId = 0;
+            unsigned long long deadlocks = 0;
+            unsigned long long waiters = 0;
+            set<string> modes;
+        };
+
+        // Keyed on file then block.
+        map<std::pair<unsigned, unsigned>, blockCounts> mBlocks;
+};
+
+#endif // ORAROWID_H
@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORASTATS_H
+#define ORASTATS_H
+
+#include <string>
+#include <map>
+#include <iostream>
+#include <chrono>
+#include <atomic>
+
+#include "oraProbes.h"
+#include "oraAllocStats.h"
+
+using std::string;
+using std::map;
+using std::ostream;
+
+// Set by the SIGUSR1 handler, checked by the trace file readers. The one
+// that clears it prints its progress, so several threads reading trace
+// files at once, as in daemon and pipeline modes, print it only once.
+// Signal handlers can't do much more than this safely.
+extern std::atomic<bool> progressRequested;
+void installProgressHandler();
+
+// Escapes a string for use as a JSON string value, quotes included.
+string jsonString(const string &s);
+
+class oraStats
+{
+    public:
+        oraStats();
+        virtual ~oraStats();
+
+        // Phases are only timed if someone wants to know, it isn't free.
+        static void enableTiming() { mTiming = true; }
+        static bool timing() { return mTiming || ORA_PROBES_COMPILED; }
+
+        void addPhase(const char *phase, const double seconds,
+                      const oraAllocUsage &alloc = oraAllocUsage());
+        void addLine(const unsigned long long bytes) { mLines++; mBytesRead += bytes; }
+        void addDeadlock() { mDeadlocks++; }
+        void addParseError() { mParseErrors++; }
+        void addBytesWritten(const unsigned long long bytes) { mBytesWritten += bytes; }
+        unsigned long long lines() { return mLines; }
+        unsigned long long bytesRead() { return mBytesRead; }
+        unsigned long long deadlocks() { return mDeadlocks; }
+        unsigned long long parseErrors() { return mParseErrors; }
+        unsigned long long bytesWritten() { return mBytesWritten; }
+        double elapsed();
+        double mbPerSecond();
+        void stop();
+        void merge(oraStats &other);
+        void progress(ostream &out, const string &name);
+        void toJSON(ostream &out, const string &name, const string &indent);
+
+    private:
+        struct phaseStats {
+            double seconds = 0.0;
+            unsigned long long calls = 0;
+            unsigned long long allocations = 0;
+            unsigned long long bytesAllocated = 0;
+            unsigned long long peakBytes = 0;
+        };
+
+        static bool mTiming;
+        map<string, phaseStats, std::less<>> mPhases;
+        unsigned long long mLines;
+        unsigned long long mBytesRead;
+        unsigned long long mDeadlocks;
+        unsigned long long mParseErrors;
+        unsigned long long mBytesWritten;
+        std::chrono::steady_clock::time_point mStarted;
+        double mElapsed;
+        bool mStopped;
+};
+
+
+//==============================================================================
+// Times a phase from construction to destruction, and adds the elapsed wall
+// time, and any memory allocated, to the supplied stats when it goes out of
+// scope. Also fires the phase__start and phase__end tracepoints, if compiled
+// in. Does nothing at all unless phases are being timed.
+//==============================================================================
+class oraPhaseTimer
+{
+    public:
+        oraPhaseTimer(oraStats *stats, const char *phase) :
+            mStats(stats), mPhase(phase), mTimed(oraStats::timing()) {
+            if (!mTimed) {
+                return;
+            }
+            mStarted = std::chrono::steady_clock::now();
+            ORA_PROBE3(phase__start, mPhase, mStats->lines(), mStats->bytesRead());
+        }
+
+        ~oraPhaseTimer() {
+            if (!mTimed) {
+                return;
+            }
+            std::chrono::duration<double> d = std::chrono::steady_clock::now() - mStarted;
+            ORA_PROBE4(phase__end, mPhase, mStats->lines(), mStats->bytesRead(),
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+            mStats->addPhase(mPhase, d.count(), mAlloc.finish());
+        }
+
+    private:
+        oraStats *mStats;
+        const char *mPhase;
+        bool mTimed;
+        std::chrono::steady_clock::time_point mStarted;
+        oraAllocMark mAlloc;
+};
+
+#endif // ORASTATS_H
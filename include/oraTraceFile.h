@@ -29,8 +29,14 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <memory>
+#include <atomic>
 
 #include "oraDeadlock.h"
+#include "oraStats.h"
+#include "oraFilter.h"
+#include "oraMemoryStream.h"
+#include "oraTraceText.h"
 
 using std::string;
 using std::ifstream;
@@ -41,12 +47,24 @@ using std::ostream;
 using std::endl;
 using std::cerr;
 
+// The default limit on the size of a single deadlock dump. Anything bigger is
+// cut short, and the rest of it skipped, as it's most likely a corrupt file.
+#define DEADLOCK_BYTE_BUDGET (64ULL * 1024 * 1024)
+
 class oraTraceFile
 {
     public:
         oraTraceFile(const string traceFileName);
+        oraTraceFile(const string traceName, const char *buffer, const size_t length);
         virtual ~oraTraceFile();
         unsigned parse() { return findAllDeadlocks(); }
+        bool nextDeadlock(oraDeadlock &deadlock);
+        void setGlobalGraphs(const bool val) { mGlobalGraphs = val; }
+        void setVerbose(const bool val) { mVerbose = val; }
+        void setStartOffset(const unsigned long long val) { mStartOffset = val; }
+        void setDeadlockBudget(const unsigned long long val) { mDeadlockBudget = val; }
+        void cancel() { mCancelled = true; }
+        bool cancelled() { return mCancelled; }
         bool good() { return mIFS->good(); }
         string traceName() { return mTraceName; }
         string originalPath() { return mOriginalPath; }
@@ -57,20 +75,74 @@ class oraTraceFile
         friend ostream& operator<<(ostream &out, const oraTraceFile &tf);
         unsigned deadlockCount() { return mDeadlocks.size(); }
         oraDeadlock *deadLock(const unsigned index);
+        oraStats *stats() { return &mStats; }
+        void setFilter(oraFilter *filter) { mFilter = filter; }
+        bool lineNumbersKnown() { return mLineNumbersKnown; }
+        string excerpt(const unsigned long long startOffset, const unsigned long long endOffset);
+        string excerpt(const oraDeadlock *dl);
+        std::shared_ptr<const oraTraceText> text() { return mText; }
 
         // OraDeadlock classes can access our privates! But other
         // applications, classes etc cannot.
         friend oraDeadlock;
+        friend class oraParseResult;
 
     protected:
 
     private:
         string mTraceName;
-        ifstream *mIFS;
+        std::istream *mIFS;
+
+        // For reading bits of the trace file again. The text is shared with
+        // the deadlocks, and anything else that outlives us.
+        std::shared_ptr<const oraTraceText> mText;
         unsigned mLineNumber;
         vector<oraDeadlock> mDeadlocks;
         string mPreviousLine;
         string mCurrentLine;
+        oraStats mStats;
+
+        // The last "*** YYYY-MM-DD HH:MM:SS" line read. It isn't always right
+        // before what it timestamps, LMD traces have other lines in between.
+        string mLastTimestamp;
+
+        // Byte offsets, in the trace file, of the start of the previous,
+        // current and next lines.
+        unsigned long long mPreviousOffset;
+        unsigned long long mCurrentOffset;
+        unsigned long long mNextOffset;
+
+        // Set when extracting a deadlock runs into the start of the next one.
+        // The current line is then "DEADLOCK DETECTED".
+        bool mResync;
+
+        // Which deadlocks do we want? Null means all of them.
+        oraFilter *mFilter;
+
+        // Line numbers are unknown after skipping ahead in the file.
+        bool mLineNumbersKnown;
+
+        // Streaming state for nextDeadlock(). Have we skipped to the start
+        // of the time window yet, and are we past the end of it?
+        bool mStarted;
+        bool mKeepLooking;
+
+        // Where to start looking for deadlocks, if not after the header.
+        unsigned long long mStartOffset;
+
+        // Do we look for LMD global wait-for-graphs as well as deadlocks,
+        // and is the one we are sitting on a global one?
+        bool mGlobalGraphs;
+        bool mGlobalGraph;
+
+        // Do we tell stderr about each deadlock found?
+        bool mVerbose;
+
+        // The most bytes one deadlock may take up, zero for no limit.
+        unsigned long long mDeadlockBudget;
+
+        // Set, from any thread, to give up reading. See oraWatchdog.
+        std::atomic<bool> mCancelled;
 
         // These are extracted from the trace file.
         string mInstanceName;
@@ -80,16 +152,23 @@ class oraTraceFile
         string mServerName;
 
         void initialise();
-        string readLine();
+        void construct();
+        const string &readLine();
         string trimmedLine();
         bool eof() { return mIFS->eof(); }
         string currentLine() { return mCurrentLine; }
         string previousLine() { return mPreviousLine; }
+        const string &lastTimestamp() const { return mLastTimestamp; }
         unsigned lineNumber() { return mLineNumber; }
+        unsigned long long previousOffset() { return mPreviousOffset; }
+        unsigned long long currentOffset() { return mCurrentOffset; }
+        unsigned long long nextOffset() { return mNextOffset; }
         bool findAtStart(const string lookFor, const bool stopAtEndOfDeadlock = true);
-        bool findNearStart(const string lookFor, const bool stopAtEndOfDeadlock = true);
         bool findDeadlock();
-        bool findDeadlockGraph();
+        bool wantedDeadlock(bool &keepLooking);
+        bool findTimestamp(const unsigned long long from, unsigned long long &where, long long &when);
+        void skipToTime(const long long since);
+        void seekTo(const unsigned long long offset);
         unsigned findAllDeadlocks();
 };
 
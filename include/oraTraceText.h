@@ -0,0 +1,62 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORATRACETEXT_H
+#define ORATRACETEXT_H
+
+#include <string>
+#include <fstream>
+#include <mutex>
+
+using std::string;
+
+//==============================================================================
+// Reads bits of a trace file, by byte offset, from disc or memory. Deadlocks,
+// and parse results, share one of these with the oraTraceFile they came from,
+// so they can fetch their SQL, and excerpts, long after the trace file has
+// gone, and from any thread.
+//
+// A trace file in memory must outlive this, as it isn't copied.
+//==============================================================================
+class oraTraceText
+{
+    public:
+        oraTraceText(const string traceName);
+        oraTraceText(const char *buffer, const size_t length);
+        virtual ~oraTraceText();
+        string excerpt(const unsigned long long startOffset,
+                       const unsigned long long endOffset) const;
+
+    private:
+        string mTraceName;
+        const char *mBuffer;
+        size_t mBufferLength;
+
+        // Opened the first time it's needed, then kept open. Only one thread
+        // can be seeking around in it at a time.
+        mutable std::ifstream mIFS;
+        mutable std::mutex mMutex;
+};
+
+#endif // ORATRACETEXT_H
@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAWAITEVENT_H
+#define ORAWAITEVENT_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::ostream;
+
+//==============================================================================
+// One entry from a session's wait history. The event name is interned, so
+// each event is just a small number, and the time waited is normalised to
+// microseconds, whatever units the trace used. Which units those were, and
+// the decimal places, are kept in what would be padding, so that text() can
+// show the time as the trace did. P1, P2 and P3 are the three wait
+// parameters, their names depend on the event, so we don't keep them.
+//==============================================================================
+class oraWaitEvent
+{
+    public:
+        oraWaitEvent(const unsigned eventId = 0);
+        virtual ~oraWaitEvent();
+
+        unsigned eventId() const { return mEventId; }
+        string eventName() const { return eventName(mEventId); }
+        unsigned long long micros() const { return mMicros; }
+        void setMicros(const unsigned long long val) { mMicros = val; mUnits = 0; }
+        bool setDuration(const string &text);
+        string durationText() const;
+        unsigned long long p1() const { return mP1; }
+        unsigned long long p2() const { return mP2; }
+        unsigned long long p3() const { return mP3; }
+        void setParameters(const unsigned long long p1,
+                           const unsigned long long p2,
+                           const unsigned long long p3) { mP1 = p1; mP2 = p2; mP3 = p3; }
+        string text() const;
+
+        // The event name table, shared by everyone.
+        static unsigned internEvent(const string &name);
+        static string eventName(const unsigned eventId);
+
+        // Parsers for the bits of a wait history entry.
+        static bool parseDuration(const string &text, unsigned long long &micros,
+                                  unsigned char *units = nullptr, unsigned char *decimals = nullptr);
+        static unsigned parseParameters(const string &text, unsigned long long params[3]);
+        static string formatDuration(const unsigned long long micros);
+
+        friend ostream& operator<<(ostream &out, const oraWaitEvent &we);
+
+    private:
+        unsigned mEventId;
+        unsigned char mUnits;       // One bit per unit, see durationUnits.
+        unsigned char mDecimals;    // In the last, smallest, unit.
+        unsigned long long mMicros;
+        unsigned long long mP1;
+        unsigned long long mP2;
+        unsigned long long mP3;
+};
+
+
+//==============================================================================
+// Aggregates the wait events of any number of deadlocks. Just numbers, so it
+// is quick to sort out the percentiles.
+//==============================================================================
+class oraWaitStats
+{
+    public:
+        struct eventSummary {
+            unsigned eventId;
+            unsigned long long count;
+            unsigned long long totalMicros;
+            unsigned long long p50Micros;
+            unsigned long long p95Micros;
+            unsigned long long maxMicros;
+        };
+
+        void add(const oraWaitEvent &we) { mDurations[we.eventId()].push_back(we.micros()); }
+        void add(const vector<oraWaitEvent> &waits);
+        bool empty() const { return mDurations.empty(); }
+        vector<eventSummary> summary();
+
+    private:
+        map<unsigned, vector<unsigned long long>> mDurations;
+};
+
+#endif // ORAWAITEVENT_H
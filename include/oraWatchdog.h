@@ -0,0 +1,87 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ORAWATCHDOG_H
+#define ORAWATCHDOG_H
+
+#include <map>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "oraTraceFile.h"
+
+using std::map;
+
+//==============================================================================
+// Cancels trace files that take too long. A trace file being watched that
+// is still there when its time is up is cancelled, it then behaves as if it
+// had hit EOF, and whoever was parsing it gets the deadlocks found so far.
+// This stops one bad file hanging a batch run, or a daemon worker, forever.
+//
+// One background thread does the watching, for any number of trace files in
+// any number of threads. Each watch() needs a matching unwatch() before the
+// trace file goes away - oraWatchdog::guard does that.
+//==============================================================================
+class oraWatchdog
+{
+    public:
+        oraWatchdog();
+        virtual ~oraWatchdog();
+        unsigned long watch(oraTraceFile *traceFile, const double seconds);
+        void unwatch(const unsigned long id);
+
+        // Watches a trace file for as long as it's in scope.
+        class guard
+        {
+            public:
+                guard(oraWatchdog *dog, oraTraceFile *traceFile, const double seconds):
+                    mDog(dog), mId(dog ? dog->watch(traceFile, seconds) : 0) {}
+                ~guard() { if (mDog) mDog->unwatch(mId); }
+
+            private:
+                oraWatchdog *mDog;
+                unsigned long mId;
+        };
+
+    private:
+        typedef std::chrono::steady_clock::time_point timePoint;
+
+        struct watched {
+            oraTraceFile *traceFile;
+            timePoint deadline;
+        };
+
+        std::mutex mMutex;
+        std::condition_variable mChanged;
+        map<unsigned long, watched> mWatched;
+        unsigned long mNextId;
+        bool mStopping;
+        std::thread mThread;
+
+        void run();
+};
+
+#endif // ORAWATCHDOG_H
@@ -18,7 +18,115 @@
  *------------------------------------------------------------------------------
  * USAGE:
  *
- * DeadlockAnalysis <tracefile_name>
+ * DeadlockAnalysis [options] <tracefile_name> [tracefile_name ...]
+ *
+ * Options:
+ *
+ * --stats      Write phase timings and throughput, per file and in total, to
+ *              stdout as JSON. A SIGUSR1 prints progress at any time, with or
+ *              without this option.
+ *
+ * --alloc-stats
+ *              Count memory allocations, bytes allocated and the peak memory
+ *              in use, for each phase, and for the whole run, in the --stats
+ *              output, which it turns on. Only if built with
+ *              DEADLOCK_ALLOC_TRACKING defined.
+ *
+ * --excerpts   Embed the raw trace file text for each deadlock in the report.
+ *
+ * --formats=html[,json][,csv]
+ *              What to write, next to each trace file. The default is just the
+ *              HTML report. Each format is written by its own thread, from the
+ *              one parse of the trace file.
+ *
+ * --since=YYYY-MM-DD[ HH:MM[:SS]]
+ * --until=YYYY-MM-DD[ HH:MM[:SS]]
+ *              Only extract deadlocks in this time window. The trace file is
+ *              binary searched for the start, and reading stops at the end.
+ *
+ * --signature=TM[,TX-X-S...]
+ * --sid=N[,N...]
+ * --object=N[,N...]
+ *              Only extract deadlocks with a signature starting with any of
+ *              these, involving any of these sessions, or waiting on any of
+ *              these object ids. Checked as soon as the relevant part of the
+ *              deadlock has been read, the rest is skipped if not wanted.
+ *
+ * --cluster    The trace files are from the nodes of a RAC cluster, LMD traces
+ *              included. Instead of a report per file, they are merged into
+ *              one timeline, in time order, on stdout. Append "@+N" or "@-N"
+ *              to a trace file name to adjust that node's clock by N seconds.
+ *
+ * --compare    Check the parser against the original line based extractor,
+ *              kept as a reference. Each trace file is parsed both ways, every
+ *              field of every deadlock is compared, and any mismatches, and
+ *              the speedup over the reference, are written to stdout. Exits
+ *              with 3 if anything didn't match.
+ *
+ * --daemon=/path/to/socket
+ * --threads=N  Don't analyse any trace files, listen on a UNIX domain socket
+ *              for requests instead, using N worker threads, until killed.
+ *              See oraDaemon.h for the requests.
+ *
+ * --queue-depth=N
+ *              Read the trace files into memory in the background, with up
+ *              to N reads in flight, while earlier ones are being parsed.
+ *              Uses io_uring where available, pread() otherwise.
+ *
+ * --index=/path/to/directory
+ *              Add every deadlock analysed to a history index in this
+ *              directory, so that it can be found again, by --query, without
+ *              the trace file. See oraDeadlockIndex.h.
+ *
+ * --query      Don't analyse any trace files, list the deadlocks in the
+ *              --index which match the --since, --until, --signature, --sid
+ *              and --object options, and these:
+ *
+ * --instance=NAME[,NAME...]
+ * --sql=TEXT   Only deadlocks on these instances, or which aborted this SQL
+ *              statement, white space aside. Or its hash, as listed by
+ *              --query, with 0x in front.
+ *
+ * --pipeline=N
+ *              Write each trace file's report, and other outputs, on a thread
+ *              of its own, while the main thread parses the next trace files.
+ *              Up to N parsed files wait to be written, after that parsing
+ *              waits for the writer. Hides slow output discs behind parsing.
+ *
+ * --objects=/path/to/objects.dict
+ *              Show the owner, name and type of each object waited on, from a
+ *              dictionary compiled by --compile-objects.
+ *
+ * --compile-objects=/path/to/dba_objects.csv
+ *              Compile a DBA_OBJECTS export, as CSV with a heading line, into
+ *              the --objects file, or one with the same name as the CSV, but
+ *              ".dict" on the end. Trace files are optional.
+ *
+ * --hot-blocks=/path/to/blocks.csv
+ *              Count the rows waited on, in all the trace files, by the block
+ *              they are in, and write the blocks, hottest first, as CSV.
+ *
+ * --max-deadlock-bytes=N
+ *              A single deadlock dump bigger than this, 64MB by default, is
+ *              cut short, and noted as a parse error. Zero for no limit.
+ *
+ * --time-limit=N
+ *              Give up on a trace file after N seconds, reporting only the
+ *              deadlocks found so far. Applies per file, and per daemon
+ *              request. No limit by default.
+ *
+ * --prometheus=/path/to/file.prom
+ *              Don't write reports, write deadlock metrics for the Prometheus
+ *              node_exporter textfile collector instead. Only what has been
+ *              added to each trace file since the last run is read, how far
+ *              each got is kept in "file.prom.state". Replaced trace files
+ *              are read again from the start.
+ *
+ * --parquet=/path/to/name
+ *              Don't write reports, export the deadlocks as Apache Parquet
+ *              files instead, for analytics. "name.deadlocks.parquet" has a
+ *              row per deadlock, "name.graph.parquet" a row per row of each
+ *              deadlock graph.
  *------------------------------------------------------------------------------
  * Output is HTML format, and is written to stdout.
  * Errors etc are written to stderr.
@@ -60,22 +168,45 @@
 #include <string>
 #include <cstdlib>
 #include <vector>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
 
 using std::string;
 using std::cerr;
+using std::cout;
 using std::endl;
 using std::vector;
+using std::ostringstream;
+using std::ostream;
 
 
 #include "oraTraceFile.h"
 #include "oraDeadlock.h"
 #include "oraDeadlockReport.h"
+#include "oraParseResult.h"
+#include "oraStats.h"
+#include "oraFilter.h"
+#include "oraClusterMerge.h"
+#include "oraDaemon.h"
+#include "oraReadAhead.h"
+#include "oraPrometheus.h"
+#include "oraWatchdog.h"
+#include "oraObjectDictionary.h"
+#include "oraRowid.h"
+#include "oraBoundedQueue.h"
+#include "oraDeadlockIndex.h"
+#include "oraColumnarExport.h"
+#include "oraParserCompare.h"
 
 
 
 // Globals. (Yes, I know they are frowned upon - I don't actually care, ok?)
 string programName = "DeadlockAnalysis";
-string programVersion = "0.1.5";
+string programVersion = "0.1.6";
 string programAuthor = "Norman Dunbar";
 string authorEmail = "norman@dunbar-it.co.uk";
 
@@ -84,6 +215,32 @@ string authorEmail = "norman@dunbar-it.co.uk";
 #define ERR_TRACEFILE_ERROR    3
 #define ERR_INVALID_REPORTFILE 4
 
+// Command line options.
+bool optStats = false;
+bool optExcerpts = false;
+bool optHTML = true;
+bool optJSON = false;
+bool optCSV = false;
+bool optCluster = false;
+bool optCompare = false;
+string optDaemon;
+unsigned optThreads = 4;
+unsigned optQueueDepth = 0;
+unsigned optPipeline = 0;
+string optPrometheus;
+string optParquet;
+unsigned long long optDeadlockBudget = DEADLOCK_BYTE_BUDGET;
+double optTimeLimit = 0.0;
+string optObjects;
+string optCompileObjects;
+string optHotBlocks;
+string optIndex;
+bool optQuery = false;
+vector<string> optInstances;
+vector<uint64_t> optSqlHashes;
+oraObjectDictionary objectDictionary;
+oraFilter optFilter;
+
 //==============================================================================
 //                                                                       USAGE()
 //==============================================================================
@@ -91,13 +248,595 @@ void usage(int errorCode, string errorText) {
     cerr << '\n'
          << programName << ": ERROR: " << errorText << "\n'\n"
          << "USAGE:\n"
-         << "\t" << programName << " tracefile_name [tracefile_name ...] \n"
+         << "\t" << programName << " [options] tracefile_name [tracefile_name ...] \n\n"
+         << "OPTIONS:\n"
+         << "\t--stats\tWrite timings and throughput statistics to stdout as JSON.\n"
+         << "\t--alloc-stats\tAdd memory allocation figures to --stats, if built with them.\n"
+         << "\t--excerpts\tEmbed the raw trace text of each deadlock in the report.\n"
+         << "\t--formats=html[,json][,csv]\tWhich output files to write, default html.\n"
+         << "\t--since=\"YYYY-MM-DD HH:MM:SS\"\tIgnore deadlocks before this time.\n"
+         << "\t--until=\"YYYY-MM-DD HH:MM:SS\"\tIgnore deadlocks after this time.\n"
+         << "\t--signature=TM[,...]\tOnly deadlocks with signatures starting with these.\n"
+         << "\t--sid=N[,...]\tOnly deadlocks involving these sessions.\n"
+         << "\t--object=N[,...]\tOnly deadlocks waiting on these object ids.\n"
+         << "\t--cluster\tMerge RAC node trace files into one timeline on stdout.\n"
+         << "\t\t\tA trace file name can end with @+N or @-N seconds of clock skew.\n"
+         << "\t--compare\tCheck the parser against the reference extractor, and time both.\n"
+         << "\t--daemon=/path/to/socket\tServe requests on a UNIX domain socket instead.\n"
+         << "\t--threads=N\tNumber of daemon worker threads, default 4.\n"
+         << "\t--queue-depth=N\tRead ahead trace files, with N reads in flight.\n"
+         << "\t--index=/path/to/directory\tAdd the deadlocks found to this history index.\n"
+         << "\t--query\tList the deadlocks in the --index matching the filter options.\n"
+         << "\t--instance=NAME[,...]\tOnly --query deadlocks on these instances.\n"
+         << "\t--sql=TEXT\tOnly --query deadlocks which aborted this SQL, or 0x and its hash.\n"
+         << "\t--pipeline=N\tWrite reports on another thread, up to N files behind parsing.\n"
+         << "\t--objects=/path/to/objects.dict\tName the objects waited on from this dictionary.\n"
+         << "\t--compile-objects=/path/to/dba_objects.csv\tCompile a DBA_OBJECTS export for --objects.\n"
+         << "\t--hot-blocks=/path/to/blocks.csv\tWrite the blocks waited on, in all trace files, as CSV.\n"
+         << "\t--max-deadlock-bytes=N\tCut short any deadlock bigger than this, 0 for no limit.\n"
+         << "\t--time-limit=N\tGive up on a trace file after N seconds.\n"
+         << "\t--prometheus=/path/to/file.prom\tWrite Prometheus metrics instead of reports.\n"
+         << "\t--parquet=/path/to/name\tExport the deadlocks as Parquet files instead of reports.\n"
          << endl;
 
     std::exit(errorCode);
 }
 
 
+//==============================================================================
+//                                                                  memoryJSON()
+//------------------------------------------------------------------------------
+// Adds the allocation figures for the whole run to the --stats JSON, if they
+// are being counted.
+//==============================================================================
+void memoryJSON(ostream &out)
+{
+    if (!oraAllocStats::enabled()) {
+        return;
+    }
+
+    out << ",\n  \"memory\": {\n"
+        << "    \"allocations\": " << oraAllocStats::allocations() << ",\n"
+        << "    \"bytesAllocated\": " << oraAllocStats::bytes() << ",\n"
+        << "    \"peakBytes\": " << oraAllocStats::peakBytes() << "\n"
+        << "  }";
+}
+
+//==============================================================================
+//                                                                 parseOption()
+//------------------------------------------------------------------------------
+// Processes a single "--option" from the command line. Returns false if the
+// option is not one we know about.
+//==============================================================================
+bool parseOption(const string option)
+{
+    if (option == "--stats") {
+        optStats = true;
+        oraStats::enableTiming();
+        return true;
+    }
+
+    // Start counting straight away, so that everything is counted.
+    if (option == "--alloc-stats") {
+        if (!oraAllocStats::compiledIn()) {
+            cerr << "Allocation tracking is not compiled in, "
+                    "rebuild with DEADLOCK_ALLOC_TRACKING defined." << endl;
+        }
+
+        oraAllocStats::enable();
+        oraStats::enableTiming();
+        optStats = true;
+        return true;
+    }
+
+    if (option == "--excerpts") {
+        optExcerpts = true;
+        return true;
+    }
+
+    if (option == "--query") {
+        optQuery = true;
+        return true;
+    }
+
+    if (option == "--compare") {
+        optCompare = true;
+        return true;
+    }
+
+    if (option == "--cluster") {
+        optCluster = true;
+        return true;
+    }
+
+    // The rest have values.
+    auto pos = option.find('=');
+    if (pos == string::npos) {
+        return false;
+    }
+
+    string name = option.substr(0, pos);
+    string value = option.substr(pos + 1);
+    long long when;
+
+    if (name == "--since" || name == "--until") {
+        if (!oraFilter::parseTimestamp(value, when)) {
+            usage(ERR_INVALID_PARAMS, "Invalid timestamp " + value + " for " + name);
+        }
+
+        // Until a date, or a minute, means until the end of it.
+        if (name == "--since") {
+            optFilter.setSince(when);
+        } else {
+            optFilter.setUntil(when + (value.size() <= 10 ? 86399 : (value.size() <= 16 ? 59 : 0)));
+        }
+        return true;
+    }
+
+    if (name == "--daemon") {
+        optDaemon = value;
+        return true;
+    }
+
+    if (name == "--threads") {
+        optThreads = std::strtoul(value.c_str(), nullptr, 10);
+        if (optThreads == 0) {
+            usage(ERR_INVALID_PARAMS, "Invalid number " + value + " for " + name);
+        }
+        return true;
+    }
+
+    if (name == "--formats") {
+        optHTML = optJSON = optCSV = false;
+        std::istringstream values(value);
+        string item;
+        while (getline(values, item, ',')) {
+            if (item == "html") {
+                optHTML = true;
+            } else if (item == "json") {
+                optJSON = true;
+            } else if (item == "csv") {
+                optCSV = true;
+            } else {
+                usage(ERR_INVALID_PARAMS, "Unknown format " + item + " for " + name);
+            }
+        }
+
+        if (!optHTML && !optJSON && !optCSV) {
+            usage(ERR_INVALID_PARAMS, "No formats for " + name);
+        }
+        return true;
+    }
+
+    if (name == "--objects" || name == "--compile-objects" || name == "--hot-blocks" ||
+        name == "--index") {
+        if (value.empty()) {
+            usage(ERR_INVALID_PARAMS, "No file name for " + name);
+        }
+
+        (name == "--objects" ? optObjects :
+         name == "--compile-objects" ? optCompileObjects :
+         name == "--hot-blocks" ? optHotBlocks : optIndex) = value;
+        return true;
+    }
+
+    if (name == "--instance") {
+        std::istringstream values(value);
+        string item;
+        while (getline(values, item, ',')) {
+            if (!item.empty()) {
+                optInstances.push_back(item);
+            }
+        }
+        return true;
+    }
+
+    if (name == "--sql") {
+        if (value.substr(0, 2) == "0x") {
+            char *end;
+            optSqlHashes.push_back(std::strtoull(value.c_str() + 2, &end, 16));
+            if (value.size() == 2 || *end != '\0') {
+                usage(ERR_INVALID_PARAMS, "Invalid hash " + value + " for " + name);
+            }
+        } else {
+            uint64_t hash = oraDeadlockIndex::sqlHash(value);
+            if (!hash) {
+                usage(ERR_INVALID_PARAMS, "No SQL for " + name);
+            }
+            optSqlHashes.push_back(hash);
+        }
+        return true;
+    }
+
+    if (name == "--max-deadlock-bytes") {
+        char *end;
+        optDeadlockBudget = std::strtoull(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') {
+            usage(ERR_INVALID_PARAMS, "Invalid number " + value + " for " + name);
+        }
+        return true;
+    }
+
+    if (name == "--time-limit") {
+        char *end;
+        optTimeLimit = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || optTimeLimit <= 0.0) {
+            usage(ERR_INVALID_PARAMS, "Invalid number " + value + " for " + name);
+        }
+        return true;
+    }
+
+    if (name == "--prometheus" || name == "--parquet") {
+        if (value.empty()) {
+            usage(ERR_INVALID_PARAMS, "No file name for " + name);
+        }
+        (name == "--prometheus" ? optPrometheus : optParquet) = value;
+        return true;
+    }
+
+    if (name == "--queue-depth" || name == "--pipeline") {
+        unsigned &depth = (name == "--queue-depth" ? optQueueDepth : optPipeline);
+        depth = std::strtoul(value.c_str(), nullptr, 10);
+        if (depth == 0) {
+            usage(ERR_INVALID_PARAMS, "Invalid number " + value + " for " + name);
+        }
+        return true;
+    }
+
+    if (name == "--signature" || name == "--sid" || name == "--object") {
+        // Comma separated lists.
+        std::istringstream values(value);
+        string item;
+        while (getline(values, item, ',')) {
+            if (item.empty()) {
+                continue;
+            }
+
+            if (name == "--signature") {
+                optFilter.addSignature(item);
+                continue;
+            }
+
+            char *end;
+            unsigned long number = std::strtoul(item.c_str(), &end, 10);
+            if (*end != '\0') {
+                usage(ERR_INVALID_PARAMS, "Invalid number " + item + " for " + name);
+            }
+
+            if (name == "--sid") {
+                optFilter.addSession(number);
+            } else {
+                optFilter.addObjectId(number);
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+
+//==============================================================================
+//                                                                     cluster()
+//------------------------------------------------------------------------------
+// Merges the deadlocks from all the trace files, from different RAC nodes,
+// into a single timeline on stdout. Each trace file name can have a clock
+// skew, in seconds, on the end - "orcl2_lmd0_1234.trc@-3".
+//==============================================================================
+void cluster(const vector<string> &traceFiles)
+{
+    oraClusterMerge merger;
+    merger.setFilter(&optFilter);
+
+    for (auto t = traceFiles.begin(); t != traceFiles.end(); t++) {
+        string traceName = *t;
+        long long skew = 0;
+
+        auto pos = traceName.rfind('@');
+        if (pos != string::npos && pos + 1 < traceName.size() &&
+            (traceName[pos + 1] == '+' || traceName[pos + 1] == '-')) {
+            char *end;
+            skew = std::strtoll(traceName.c_str() + pos + 1, &end, 10);
+            if (*end != '\0') {
+                usage(ERR_INVALID_PARAMS, "Invalid clock skew for " + traceName);
+            }
+            traceName.erase(pos);
+        }
+
+        if (!merger.addTraceFile(traceName, skew)) {
+            usage(ERR_INVALID_TRACEFILE, "\tCannot open tracefile " + traceName);
+        }
+    }
+
+    unsigned deadlockCount = merger.merge(cout);
+    cerr << "\tThere was/were " << deadlockCount << " deadlock(s) found.\n";
+
+    if (optStats) {
+        oraStats totalStats;
+        merger.mergeStats(totalStats);
+        totalStats.stop();
+        cout << "{\n  \"total\":\n";
+        totalStats.toJSON(cout, "total", "  ");
+        memoryJSON(cout);
+        cout << "\n}" << endl;
+    }
+
+    cerr << "Done.\n" << endl;
+}
+
+
+//==============================================================================
+//                                                                 writeOutput()
+//------------------------------------------------------------------------------
+// Writes one output format from a parse result. Returns the file name if it
+// couldn't be written, "" if all went well.
+//==============================================================================
+string writeOutput(const oraParseResult *result, const string format, oraStats *stats)
+{
+    if (format == "html") {
+        oraDeadlockReport reportFile(result, stats, optPipeline);
+        if (!reportFile.good()) {
+            return reportFile.reportName();
+        }
+
+        reportFile.setExcerpts(optExcerpts);
+        reportFile.setObjects(optObjects.empty() ? nullptr : &objectDictionary);
+        reportFile.report();
+        return "";
+    }
+
+    oraPhaseTimer timer(stats, format == "json" ? "writeJSON" : "writeCSV");
+    string fileName = result->outputName('.' + format);
+    cerr << ("\t" + format + " file: " + fileName + '\n');
+
+    std::unique_ptr<ostream> out = oraAsyncFile::open(fileName, optPipeline);
+    if (!out->good()) {
+        return fileName;
+    }
+
+    if (format == "json") {
+        result->toJSON(*out);
+    } else {
+        result->toCSV(*out);
+    }
+
+    stats->addBytesWritten(out->tellp());
+    return oraAsyncFile::finish(*out) ? "" : fileName;
+}
+
+//==============================================================================
+//                                                                writeOutputs()
+//------------------------------------------------------------------------------
+// Writes every format asked for, from the one parse result. All but the first
+// format get a thread of their own. Each has its own stats, added to the trace
+// file's afterwards. Returns the name of a file that couldn't be written, or
+// "" if they all were.
+//==============================================================================
+string writeOutputs(const oraParseResult &result, oraStats &traceStats)
+{
+    vector<string> formats;
+    if (optHTML) {
+        formats.push_back("html");
+    }
+    if (optJSON) {
+        formats.push_back("json");
+    }
+    if (optCSV) {
+        formats.push_back("csv");
+    }
+
+    vector<oraStats> stats(formats.size());
+    vector<string> failed(formats.size());
+    vector<std::thread> writers;
+    for (size_t x = 1; x < formats.size(); x++) {
+        writers.push_back(std::thread([&result, &formats, &stats, &failed, x]() {
+            failed[x] = writeOutput(&result, formats[x], &stats[x]);
+        }));
+    }
+
+    failed[0] = writeOutput(&result, formats[0], &stats[0]);
+
+    string failure;
+    for (size_t x = 0; x < formats.size(); x++) {
+        if (x > 0) {
+            writers[x - 1].join();
+        }
+
+        traceStats.merge(stats[x]);
+        if (failure.empty()) {
+            failure = failed[x];
+        }
+    }
+
+    return failure;
+}
+
+//==============================================================================
+// A parsed trace file, on its way to being written. The trace file has the
+// stats, and the buffer, if read ahead, has the text for the excerpts, so
+// they both have to last until then.
+//==============================================================================
+struct parsedTraceFile {
+    string name;
+    string buffer;
+    std::unique_ptr<oraTraceFile> traceFile;
+    std::unique_ptr<oraParseResult> result;
+};
+
+//==============================================================================
+// What we keep, for the whole run, from each trace file.
+//==============================================================================
+struct runTotals {
+    oraStats stats;
+    ostringstream fileStats;
+    oraHotBlocks hotBlocks;
+    std::unique_ptr<oraDeadlockIndex> index;
+};
+
+//==============================================================================
+//                                                             finishTraceFile()
+//------------------------------------------------------------------------------
+// Writes the outputs for a parsed trace file, and adds it to the totals. Only
+// ever called by one thread at a time, and in trace file order. Returns the
+// name of a file that couldn't be written, or "" if they all were.
+//==============================================================================
+string finishTraceFile(parsedTraceFile &parsed, runTotals &totals)
+{
+    const oraParseResult &result = *parsed.result;
+    oraStats *stats = parsed.traceFile->stats();
+
+    string failed = writeOutputs(result, *stats);
+    if (!failed.empty()) {
+        return failed;
+    }
+
+    if (!optHotBlocks.empty()) {
+        for (unsigned x = 0; x < result.deadlockCount(); x++) {
+            totals.hotBlocks.add(*result.deadLock(x));
+        }
+    }
+
+    if (totals.index) {
+        totals.index->add(result);
+    }
+
+    // Accumulate the statistics.
+    stats->stop();
+    totals.stats.merge(*stats);
+    if (optStats) {
+        totals.fileStats << (totals.fileStats.tellp() > 0 ? ",\n" : "");
+        stats->toJSON(totals.fileStats, parsed.name, "    ");
+    }
+
+    cerr << ("Done " + parsed.name + ".\n\n");
+    return "";
+}
+
+
+//==============================================================================
+//                                                                       query()
+//------------------------------------------------------------------------------
+// Lists the deadlocks in the history index which match the filter options.
+//==============================================================================
+int query()
+{
+    if (optIndex.empty()) {
+        usage(ERR_INVALID_PARAMS, "No --index to --query");
+    }
+
+    oraDeadlockIndex::query q;
+    q.hasSince = optFilter.hasSince();
+    q.since = optFilter.since();
+    q.hasUntil = optFilter.hasUntil();
+    q.until = optFilter.until();
+    q.objectIds = optFilter.objectIds();
+    q.sessions = optFilter.sessions();
+    q.signatures = optFilter.signatures();
+    q.instances = optInstances;
+    q.sqlHashes = optSqlHashes;
+
+    auto started = std::chrono::steady_clock::now();
+    oraDeadlockIndex index(optIndex);
+    unsigned found = index.find(q, cout);
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - started;
+
+    cout.flush();
+    cerr << "\tThere was/were " << found << " deadlock(s) found in "
+         << std::fixed << std::setprecision(1) << took.count() << "ms.\n"
+         << "Done.\n" << endl;
+    return 0;
+}
+
+
+//==============================================================================
+//                                                                  prometheus()
+//------------------------------------------------------------------------------
+// Counts the new deadlocks in each trace file into a Prometheus textfile.
+//==============================================================================
+int prometheus(const vector<string> &traceFiles)
+{
+    oraPrometheus exporter(optPrometheus);
+    if (!exporter.load()) {
+        return ERR_INVALID_PARAMS;
+    }
+
+    oraStats totalStats;
+    for (auto t = traceFiles.begin(); t != traceFiles.end(); t++) {
+        cerr << *t << '\n';
+        exporter.update(*t, &optFilter, totalStats);
+    }
+
+    if (!exporter.save()) {
+        return ERR_INVALID_REPORTFILE;
+    }
+
+    if (optStats) {
+        totalStats.stop();
+        cout << "{\n  \"total\":\n";
+        totalStats.toJSON(cout, "total", "  ");
+        memoryJSON(cout);
+        cout << "\n}" << endl;
+    }
+
+    cerr << "Done.\n" << endl;
+    return 0;
+}
+
+
+//==============================================================================
+//                                                                     parquet()
+//------------------------------------------------------------------------------
+// Exports the deadlocks in each trace file, as they are parsed, to Parquet.
+//==============================================================================
+int parquet(const vector<string> &traceFiles)
+{
+    oraColumnarExport exporter(optParquet, programName + " version " + programVersion);
+    if (!exporter.good()) {
+        usage(ERR_INVALID_REPORTFILE, "Cannot create Parquet files " + optParquet);
+    }
+
+    oraStats totalStats;
+    for (auto t = traceFiles.begin(); t != traceFiles.end(); t++) {
+        cerr << *t << '\n';
+
+        oraTraceFile traceFile(*t);
+        if (!traceFile.good()) {
+            usage(ERR_INVALID_TRACEFILE, "\tCannot open tracefile " + *t);
+        }
+
+        traceFile.setFilter(&optFilter);
+        traceFile.setDeadlockBudget(optDeadlockBudget);
+
+        oraDeadlock dl(&traceFile);
+        unsigned deadlockCount = 0;
+        while (traceFile.nextDeadlock(dl)) {
+            exporter.add(traceFile, dl, ++deadlockCount);
+        }
+
+        cerr << "\tThere was/were " << deadlockCount << " deadlock(s) found.\n";
+        traceFile.stats()->stop();
+        totalStats.merge(*traceFile.stats());
+    }
+
+    if (!exporter.close()) {
+        usage(ERR_INVALID_REPORTFILE, "Cannot write Parquet files " + optParquet);
+    }
+
+    cerr << "\tExported " << exporter.deadlocks() << " deadlock(s) and "
+         << exporter.graphRows() << " graph row(s).\n";
+
+    if (optStats) {
+        totalStats.stop();
+        cout << "{\n  \"total\":\n";
+        totalStats.toJSON(cout, "total", "  ");
+        memoryJSON(cout);
+        cout << "\n}" << endl;
+    }
+
+    cerr << "Done.\n" << endl;
+    return 0;
+}
+
 
 //==============================================================================
 //                                                                        MAIN()
@@ -116,34 +855,235 @@ int main(int argc, char *argv[])
          << "****************************\n"
          << endl;
 
-    // There must be a single parameter.
-    if (argc < 2) {
+    // Separate the options from the trace file names.
+    vector<string> traceFiles;
+    for (auto t = 1; t < argc; t++) {
+        string arg = argv[t];
+        if (arg.substr(0, 2) == "--") {
+            if (!parseOption(arg)) {
+                usage(ERR_INVALID_PARAMS, "Unknown option " + arg);
+            }
+            continue;
+        }
+
+        traceFiles.push_back(arg);
+    }
+
+    // Kill -USR1 gets us a progress report.
+    installProgressHandler();
+
+    // Compile the object dictionary first, if asked. Then load it.
+    if (!optCompileObjects.empty()) {
+        if (optObjects.empty()) {
+            optObjects = optCompileObjects.substr(0, optCompileObjects.find_last_of('.')) + ".dict";
+        }
+
+        if (!oraObjectDictionary::compile(optCompileObjects, optObjects)) {
+            return ERR_INVALID_PARAMS;
+        }
+
+        if (traceFiles.empty() && optDaemon.empty()) {
+            return 0;
+        }
+    }
+
+    if (!optObjects.empty() && !objectDictionary.open(optObjects)) {
+        return ERR_INVALID_PARAMS;
+    }
+
+    // Questions about deadlocks past don't need any trace files.
+    if (optQuery) {
+        return query();
+    }
+
+    // The daemon gets its trace files from its clients.
+    if (!optDaemon.empty()) {
+        oraDaemon daemon(optDaemon, optThreads);
+        daemon.setFilter(&optFilter);
+        daemon.setExcerpts(optExcerpts);
+        daemon.setDeadlockBudget(optDeadlockBudget);
+        daemon.setTimeLimit(optTimeLimit);
+        daemon.setObjects(optObjects.empty() ? nullptr : &objectDictionary);
+        return daemon.run() ? 0 : ERR_INVALID_PARAMS;
+    }
+
+    // There must be at least one trace file.
+    if (traceFiles.empty()) {
         usage(ERR_INVALID_PARAMS, "No tracefile name(s) supplied");
     }
 
+    // RAC trace files get merged, not reported.
+    if (optCluster) {
+        cluster(traceFiles);
+        return 0;
+    }
+
+    // Check the parser, don't report.
+    if (optCompare) {
+        oraParserCompare comparer(cout, optDeadlockBudget);
+        bool same = true;
+        for (auto t = traceFiles.begin(); t != traceFiles.end(); t++) {
+            same = comparer.compare(*t) && same;
+        }
+        comparer.summary();
+        return same ? 0 : ERR_TRACEFILE_ERROR;
+    }
+
+    // Metrics, not reports.
+    if (!optPrometheus.empty()) {
+        return prometheus(traceFiles);
+    }
+
+    // Or columnar files for analytics.
+    if (!optParquet.empty()) {
+        return parquet(traceFiles);
+    }
+
+    // Statistics, per file, the blocks waited on, and so on, for the whole run.
+    runTotals totals;
+    if (!optIndex.empty()) {
+        totals.index.reset(new oraDeadlockIndex(optIndex));
+    }
+
+    // Parsed trace files can be written by another thread, while we get on
+    // with parsing the next ones.
+    std::unique_ptr<oraBoundedQueue<std::unique_ptr<parsedTraceFile>>> pipeline;
+    // While it runs, the writer's only sign of failure is the flag. What
+    // failed is kept in writerError, which is only copied to failed once the
+    // writer has been joined.
+    std::thread writer;
+    string failed;
+    string writerError;
+    std::atomic<bool> writerFailed(false);
+    if (optPipeline) {
+        pipeline.reset(new oraBoundedQueue<std::unique_ptr<parsedTraceFile>>(optPipeline));
+        writer = std::thread([&pipeline, &totals, &writerError, &writerFailed]() {
+            std::unique_ptr<parsedTraceFile> parsed;
+            while (pipeline->pop(parsed)) {
+                string failed = finishTraceFile(*parsed, totals);
+                parsed.reset();
+                if (!failed.empty()) {
+                    writerError = failed;
+                    writerFailed = true;
+                    pipeline->close();
+                    break;
+                }
+            }
+        });
+    }
+
     // Parameter(s) received, analyse each as a trace file.
-    for (auto t = 1; t < argc; t++) {
-        cerr << argv[t] << '\n';
-        oraTraceFile traceFile(argv[t]);
+    // Batch runs can read the next files while parsing this one.
+    std::unique_ptr<oraReadAhead> readAhead;
+    if (optQueueDepth) {
+        readAhead.reset(new oraReadAhead(traceFiles, optQueueDepth));
+    }
+
+    // And something to stop any one file taking forever.
+    std::unique_ptr<oraWatchdog> watchdog;
+    if (optTimeLimit > 0.0) {
+        watchdog.reset(new oraWatchdog());
+    }
+
+    // A trace file we can't open stops the run, but not until the writer has
+    // finished with the ones before it.
+    string badTrace;
+    for (auto t = traceFiles.begin();
+         t != traceFiles.end() && (pipeline ? !writerFailed : failed.empty());
+         t++) {
+        cerr << *t << '\n';
+
+        // The trace file comes from disc, or memory if read ahead. If read
+        // ahead, the buffer must last until the report is written.
+        std::unique_ptr<parsedTraceFile> parsed(new parsedTraceFile);
+        parsed->name = *t;
+        if (readAhead) {
+            if (!readAhead->next(parsed->buffer)) {
+                badTrace = *t;
+                break;
+            }
+            parsed->traceFile.reset(new oraTraceFile(*t, parsed->buffer.data(), parsed->buffer.size()));
+        } else {
+            parsed->traceFile.reset(new oraTraceFile(*t));
+        }
+
+        oraTraceFile &traceFile = *parsed->traceFile;
 
         if (!traceFile.good()) {
-            usage(ERR_INVALID_TRACEFILE, "\tCannot open tracefile " + string(argv[1]));
+            badTrace = *t;
+            break;
         }
 
         // Do we have any deadlocks? Parse the file to find out.
+        traceFile.setFilter(&optFilter);
+        traceFile.setDeadlockBudget(optDeadlockBudget);
+
+        unsigned deadlockCount;
+        {
+            oraWatchdog::guard watch(watchdog.get(), &traceFile, optTimeLimit);
+            deadlockCount = traceFile.parse();
+        }
+
+        if (traceFile.cancelled()) {
+            cerr << "\tTime limit exceeded, the report is incomplete.\n";
+        }
 
-        cerr << "\tThere was/were " << traceFile.parse()
+        cerr << "\tThere was/were " << deadlockCount
              << " deadlock(s) found.\n";
 
-        // Build the report.
-        oraDeadlockReport reportFile(&traceFile);
-        if (reportFile.good()) {
-            reportFile.report();
+        // Build the report, and anything else, from the one parse. Now, or
+        // on the writer thread, when it gets round to it.
+        parsed->result.reset(new oraParseResult(traceFile));
+        if (pipeline) {
+            // Only fails if the writer has given up.
+            if (!pipeline->push(std::move(parsed))) {
+                break;
+            }
         } else {
-            usage(ERR_INVALID_REPORTFILE, "Cannot create report file " + reportFile.reportName());
+            failed = finishTraceFile(*parsed, totals);
         }
+    }
+
+    // Wait for the writer to catch up, or finish up, before going any further,
+    // even to exit.
+    if (pipeline) {
+        pipeline->close();
+        writer.join();
+        failed = writerError;
+    }
+
+    if (!badTrace.empty()) {
+        usage(ERR_INVALID_TRACEFILE, "\tCannot open tracefile " + badTrace);
+    }
+
+    if (!failed.empty()) {
+        usage(ERR_INVALID_REPORTFILE, "Cannot create report file " + failed);
+    }
+
+    // The history index, if requested.
+    if (totals.index && !totals.index->save()) {
+        usage(ERR_INVALID_REPORTFILE, "Cannot update deadlock index " + optIndex);
+    }
+
+    // The hot blocks, if requested.
+    if (!optHotBlocks.empty()) {
+        ofstream blocksFile(optHotBlocks);
+        oraHotBlocks::csvHeader(blocksFile);
+        totals.hotBlocks.toCSV(blocksFile);
+        if (!blocksFile.good()) {
+            usage(ERR_INVALID_REPORTFILE, "Cannot create hot blocks file " + optHotBlocks);
+        }
+    }
 
-        cerr << "Done.\n" << endl;
+    // Dump the statistics, if requested.
+    if (optStats) {
+        totals.stats.stop();
+        cout << "{\n  \"files\": [\n"
+             << totals.fileStats.str()
+             << "\n  ],\n  \"total\":\n";
+        totals.stats.toJSON(cout, "total", "  ");
+        memoryJSON(cout);
+        cout << "\n}" << endl;
     }
 
     return 0;
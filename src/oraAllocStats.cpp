@@ -0,0 +1,263 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraAllocStats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+// A shared library has no business replacing its host's operator new, so
+// the library build never tracks allocations.
+#if defined(DEADLOCK_ALLOC_TRACKING) && !defined(DLA_BUILD_LIBRARY)
+#define ALLOC_TRACKING
+#endif
+
+// Every tracked allocation has its size in a header in front of it. The
+// header keeps the memory returned as aligned as malloc() would have it.
+#define ALLOC_HEADER alignof(std::max_align_t)
+
+// This thread's counts. Plain numbers, so nothing has to be constructed,
+// allocating memory, before the first allocation can be counted.
+struct allocCounters {
+    unsigned long long allocations;
+    unsigned long long bytes;
+    long long live;
+    long long peak;
+};
+
+static thread_local allocCounters threadCounters;
+
+// And everyone's.
+static std::atomic<unsigned long long> totalAllocations(0);
+static std::atomic<unsigned long long> totalBytes(0);
+static std::atomic<long long> totalLive(0);
+static std::atomic<long long> totalPeak(0);
+
+bool oraAllocStats::mEnabled = false;
+
+#ifdef ALLOC_TRACKING
+
+//==============================================================================
+//                                                                     counted()
+//------------------------------------------------------------------------------
+// Counts an allocation, or a free if size is negative.
+//==============================================================================
+static void counted(const long long size)
+{
+    if (!oraAllocStats::enabled()) {
+        return;
+    }
+
+    allocCounters &t = threadCounters;
+    t.live += size;
+    if (size > 0) {
+        t.allocations++;
+        t.bytes += size;
+        if (t.live > t.peak) {
+            t.peak = t.live;
+        }
+
+        totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        totalBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    long long live = totalLive.fetch_add(size, std::memory_order_relaxed) + size;
+    long long peak = totalPeak.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !totalPeak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+//==============================================================================
+//                                                               allocateBlock()
+//------------------------------------------------------------------------------
+// Allocates size bytes, plus the header, aligned to at least align. Returns
+// nullptr if there's no memory, after trying the new handler, if any, unless
+// we can't throw.
+//==============================================================================
+static void *allocateBlock(std::size_t size, const std::size_t align, const bool canThrow)
+{
+    std::size_t header = align > ALLOC_HEADER ? align : ALLOC_HEADER;
+    std::size_t total = (size + header + align - 1) / align * align;
+
+    while (true) {
+        void *raw = align > ALLOC_HEADER ? std::aligned_alloc(align, total) : std::malloc(total);
+        if (raw) {
+            char *block = static_cast<char *>(raw) + header;
+            reinterpret_cast<std::size_t *>(block)[-1] = size;
+            counted(size);
+            return block;
+        }
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            if (canThrow) {
+                throw std::bad_alloc();
+            }
+            return nullptr;
+        }
+
+        handler();
+    }
+}
+
+//==============================================================================
+//                                                                   freeBlock()
+//------------------------------------------------------------------------------
+// Frees a block from allocateBlock(), which must have had the same alignment.
+//==============================================================================
+static void freeBlock(void *block, const std::size_t align)
+{
+    if (!block) {
+        return;
+    }
+
+    std::size_t header = align > ALLOC_HEADER ? align : ALLOC_HEADER;
+    counted(-static_cast<long long>(reinterpret_cast<std::size_t *>(block)[-1]));
+    std::free(static_cast<char *>(block) - header);
+}
+
+// The replaceable allocation functions, all of them, as they all have to
+// agree about the header.
+void *operator new(std::size_t size) { return allocateBlock(size, ALLOC_HEADER, true); }
+void *operator new[](std::size_t size) { return allocateBlock(size, ALLOC_HEADER, true); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return allocateBlock(size, ALLOC_HEADER, false); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return allocateBlock(size, ALLOC_HEADER, false); }
+void *operator new(std::size_t size, std::align_val_t align) { return allocateBlock(size, static_cast<std::size_t>(align), true); }
+void *operator new[](std::size_t size, std::align_val_t align) { return allocateBlock(size, static_cast<std::size_t>(align), true); }
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept { return allocateBlock(size, static_cast<std::size_t>(align), false); }
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept { return allocateBlock(size, static_cast<std::size_t>(align), false); }
+
+void operator delete(void *block) noexcept { freeBlock(block, ALLOC_HEADER); }
+void operator delete[](void *block) noexcept { freeBlock(block, ALLOC_HEADER); }
+void operator delete(void *block, std::size_t) noexcept { freeBlock(block, ALLOC_HEADER); }
+void operator delete[](void *block, std::size_t) noexcept { freeBlock(block, ALLOC_HEADER); }
+void operator delete(void *block, const std::nothrow_t &) noexcept { freeBlock(block, ALLOC_HEADER); }
+void operator delete[](void *block, const std::nothrow_t &) noexcept { freeBlock(block, ALLOC_HEADER); }
+void operator delete(void *block, std::align_val_t align) noexcept { freeBlock(block, static_cast<std::size_t>(align)); }
+void operator delete[](void *block, std::align_val_t align) noexcept { freeBlock(block, static_cast<std::size_t>(align)); }
+void operator delete(void *block, std::size_t, std::align_val_t align) noexcept { freeBlock(block, static_cast<std::size_t>(align)); }
+void operator delete[](void *block, std::size_t, std::align_val_t align) noexcept { freeBlock(block, static_cast<std::size_t>(align)); }
+void operator delete(void *block, std::align_val_t align, const std::nothrow_t &) noexcept { freeBlock(block, static_cast<std::size_t>(align)); }
+void operator delete[](void *block, std::align_val_t align, const std::nothrow_t &) noexcept { freeBlock(block, static_cast<std::size_t>(align)); }
+
+#endif // ALLOC_TRACKING
+
+
+//==============================================================================
+//                                                                  compiledIn()
+//------------------------------------------------------------------------------
+// Can we count allocations at all?
+//==============================================================================
+bool oraAllocStats::compiledIn()
+{
+#ifdef ALLOC_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+//==============================================================================
+//                                                                      enable()
+//------------------------------------------------------------------------------
+// Starts counting, if we can. Best done first thing, as anything allocated
+// before, but freed after, makes the live bytes look smaller than they are.
+//==============================================================================
+void oraAllocStats::enable()
+{
+    mEnabled = compiledIn();
+}
+
+//==============================================================================
+//                                                               allocations()
+//                                                                     bytes()
+//                                                                 peakBytes()
+//------------------------------------------------------------------------------
+// Totals for the whole process, all threads, since counting started.
+//==============================================================================
+unsigned long long oraAllocStats::allocations()
+{
+    return totalAllocations.load(std::memory_order_relaxed);
+}
+
+unsigned long long oraAllocStats::bytes()
+{
+    return totalBytes.load(std::memory_order_relaxed);
+}
+
+unsigned long long oraAllocStats::peakBytes()
+{
+    return totalPeak.load(std::memory_order_relaxed);
+}
+
+
+//==============================================================================
+//                                                        oraAllocMark::start()
+//------------------------------------------------------------------------------
+// Notes this thread's counts at the start of a phase, and starts looking for
+// a new peak from here.
+//==============================================================================
+void oraAllocMark::start()
+{
+    mActive = oraAllocStats::enabled();
+    if (!mActive) {
+        return;
+    }
+
+    allocCounters &t = threadCounters;
+    mAllocations = t.allocations;
+    mBytes = t.bytes;
+    mLive = t.live;
+    mSavedPeak = t.peak;
+    t.peak = t.live;
+}
+
+//==============================================================================
+//                                                       oraAllocMark::finish()
+//------------------------------------------------------------------------------
+// Returns what was allocated since start(), and the peak live memory above
+// where it was then. Puts back the enclosing phase's peak, if it was higher.
+//==============================================================================
+oraAllocUsage oraAllocMark::finish()
+{
+    oraAllocUsage usage;
+    if (!mActive) {
+        return usage;
+    }
+
+    allocCounters &t = threadCounters;
+    usage.allocations = t.allocations - mAllocations;
+    usage.bytes = t.bytes - mBytes;
+    usage.peakBytes = t.peak > mLive ? t.peak - mLive : 0;
+
+    if (mSavedPeak > t.peak) {
+        t.peak = mSavedPeak;
+    }
+
+    mActive = false;
+    return usage;
+}
@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraAsyncFile.h"
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraAsyncFile::oraAsyncFile(const string &fileName, const size_t depth) :
+    ostream(nullptr),
+    mBuffer(fileName, depth)
+{
+    rdbuf(&mBuffer);
+    if (!mBuffer.good()) {
+        setstate(std::ios_base::failbit);
+    }
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraAsyncFile::~oraAsyncFile()
+{
+    close();
+}
+
+//==============================================================================
+//                                                                       close()
+//------------------------------------------------------------------------------
+// Writes what's left, and waits for the writer to finish.
+//==============================================================================
+void oraAsyncFile::close()
+{
+    if (!mBuffer.close()) {
+        setstate(std::ios_base::badbit);
+    }
+}
+
+//==============================================================================
+//                                                                        open()
+//------------------------------------------------------------------------------
+// Opens an output file, written in the background if depth isn't zero.
+//==============================================================================
+std::unique_ptr<ostream> oraAsyncFile::open(const string &fileName, const size_t depth)
+{
+    if (depth == 0) {
+        return std::unique_ptr<ostream>(new std::ofstream(fileName));
+    }
+
+    return std::unique_ptr<ostream>(new oraAsyncFile(fileName, depth));
+}
+
+//==============================================================================
+//                                                                      finish()
+//------------------------------------------------------------------------------
+// Closes a file from open(), waiting for it to be written if need be. Returns
+// false if any of it couldn't be.
+//==============================================================================
+bool oraAsyncFile::finish(ostream &out)
+{
+    if (oraAsyncFile *async = dynamic_cast<oraAsyncFile *>(&out)) {
+        async->close();
+    } else if (std::ofstream *file = dynamic_cast<std::ofstream *>(&out)) {
+        file->close();
+    }
+
+    return out.good();
+}
+
+
+//==============================================================================
+//                                                           buffer Constructor
+//------------------------------------------------------------------------------
+// The file is unbuffered, as each chunk is written in one go anyway.
+//==============================================================================
+oraAsyncFile::buffer::buffer(const string &fileName, const size_t depth) :
+    mQueued(0),
+    mQueue(depth),
+    mFailed(false),
+    mClosed(false)
+{
+    mFile.rdbuf()->pubsetbuf(nullptr, 0);
+    mFile.open(fileName);
+
+    mChunk.resize(ASYNC_CHUNK_SIZE);
+    setp(&mChunk[0], &mChunk[0] + mChunk.size());
+
+    if (mFile.good()) {
+        mWriter = std::thread(&oraAsyncFile::buffer::writer, this);
+    } else {
+        mClosed = true;
+    }
+}
+
+//==============================================================================
+//                                                            buffer Destructor
+//==============================================================================
+oraAsyncFile::buffer::~buffer()
+{
+    close();
+}
+
+//==============================================================================
+//                                                            buffer::handOver()
+//------------------------------------------------------------------------------
+// Queues whatever has been written so far for the writer, and starts a new
+// chunk. Waits if the writer is too far behind. False if it has given up.
+//==============================================================================
+bool oraAsyncFile::buffer::handOver()
+{
+    size_t length = pptr() - pbase();
+    if (length) {
+        string full;
+        full.swap(mChunk);
+        full.resize(length);
+        mQueued += length;
+
+        mChunk.resize(ASYNC_CHUNK_SIZE);
+        setp(&mChunk[0], &mChunk[0] + mChunk.size());
+
+        if (mClosed || !mQueue.push(std::move(full))) {
+            return false;
+        }
+    }
+
+    return !mFailed;
+}
+
+//==============================================================================
+//                                                            buffer::overflow()
+//------------------------------------------------------------------------------
+// The chunk is full, hand it over and carry on with c in a new one.
+//==============================================================================
+oraAsyncFile::buffer::int_type oraAsyncFile::buffer::overflow(int_type c)
+{
+    if (!handOver()) {
+        return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+//==============================================================================
+//                                                                buffer::sync()
+//------------------------------------------------------------------------------
+// A flush() hands over what we have, it doesn't wait for it to be written.
+//==============================================================================
+int oraAsyncFile::buffer::sync()
+{
+    return handOver() ? 0 : -1;
+}
+
+//==============================================================================
+//                                                             buffer::seekoff()
+//------------------------------------------------------------------------------
+// Only tellp() is allowed, which is how many bytes have been written to us.
+//==============================================================================
+oraAsyncFile::buffer::pos_type oraAsyncFile::buffer::seekoff(off_type off,
+                                                            std::ios_base::seekdir dir,
+                                                            std::ios_base::openmode which)
+{
+    if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out)) {
+        return pos_type(off_type(-1));
+    }
+
+    return pos_type(off_type(mQueued + (pptr() - pbase())));
+}
+
+//==============================================================================
+//                                                               buffer::close()
+//------------------------------------------------------------------------------
+// Hands over the last chunk, and waits for the writer to get it all to disc.
+// Returns false if anything went wrong, then or before.
+//==============================================================================
+bool oraAsyncFile::buffer::close()
+{
+    if (mClosed) {
+        return good();
+    }
+
+    handOver();
+    mQueue.close();
+    mWriter.join();
+    mFile.close();
+    if (mFile.fail()) {
+        mFailed = true;
+    }
+
+    mClosed = true;
+    return good();
+}
+
+//==============================================================================
+//                                                              buffer::writer()
+//------------------------------------------------------------------------------
+// The writer thread. Writes each chunk as it comes. After a failure, it still
+// takes the chunks, and throws them away, so that nobody waits for it.
+//==============================================================================
+void oraAsyncFile::buffer::writer()
+{
+    string chunk;
+    while (mQueue.pop(chunk)) {
+        if (!mFailed) {
+            mFile.write(chunk.data(), chunk.size());
+            if (!mFile.good()) {
+                mFailed = true;
+            }
+        }
+    }
+}
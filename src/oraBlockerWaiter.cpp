@@ -55,6 +55,7 @@ oraBlockerWaiter::oraBlockerWaiter(const bool isWaiter) :
     mBlock = 0;
     mSlot = 0;
     mObjectId = 0;
+    mDataObjectId = 0;
 
     // Preallocate string space.
     mResourceName.reserve(20);
@@ -109,6 +110,7 @@ ostream& operator<<(ostream &out, const oraBlockerWaiter &bw) {
         // But only waiters have these...
         out << "\tBlocking Session: " << bw.mOtherSession << '\n'
             << "\tRowid Waiting:    " << bw.mRowidWait << '\n'
+            << "\tData Object Id:   " << bw.mDataObjectId << '\n'
             << "\tFile Waiting:     " << bw.mFile << '\n'
             << "\tBlock Waiting:    " << bw.mBlock << '\n'
             << "\tSlot Waiting:     " << bw.mSlot << '\n'
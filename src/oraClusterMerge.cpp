@@ -0,0 +1,206 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraClusterMerge.h"
+
+#include <queue>
+#include <functional>
+#include <utility>
+
+using std::cerr;
+using std::endl;
+using std::pair;
+
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraClusterMerge::oraClusterMerge()
+{
+    mFilter = nullptr;
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraClusterMerge::~oraClusterMerge()
+{
+    for (auto n = mNodes.begin(); n != mNodes.end(); n++) {
+        delete n->traceFile;
+        n->traceFile = nullptr;
+    }
+}
+
+//==============================================================================
+//                                                                addTraceFile()
+//------------------------------------------------------------------------------
+// Adds a trace file, from one node, to be merged. The skew, in seconds, is
+// added to all of its timestamps. Returns false if it can't be opened.
+//==============================================================================
+bool oraClusterMerge::addTraceFile(const string traceFileName, const long long skew)
+{
+    oraTraceFile *traceFile = new oraTraceFile(traceFileName);
+    if (!traceFile->good()) {
+        delete traceFile;
+        return false;
+    }
+
+    traceFile->setGlobalGraphs(true);
+    mNodes.push_back(node{traceFile, skew, oraDeadlock(traceFile), false});
+    return true;
+}
+
+//==============================================================================
+//                                                                     advance()
+//------------------------------------------------------------------------------
+// Reads the next deadlock from one node's trace file. Returns false when that
+// trace file has no more.
+//==============================================================================
+bool oraClusterMerge::advance(node &n)
+{
+    n.hasNext = n.traceFile->nextDeadlock(n.next);
+    return n.hasNext;
+}
+
+//==============================================================================
+//                                                                       merge()
+//------------------------------------------------------------------------------
+// Streams all the trace files through a k-way merge on deadlock time, and
+// writes the timeline to out. Only one deadlock per trace file is held at any
+// time. Deadlocks without a timestamp come first. Where the times are equal,
+// the trace files are taken in the order given. Returns the number of
+// deadlocks in the timeline.
+//==============================================================================
+unsigned oraClusterMerge::merge(ostream &out)
+{
+    // Earliest time, then lowest node, on top.
+    typedef pair<long long, size_t> heapEntry;
+    std::priority_queue<heapEntry, vector<heapEntry>, std::greater<heapEntry> > heap;
+
+    for (size_t x = 0; x < mNodes.size(); x++) {
+        cerr << mNodes[x].traceFile->traceName() << '\n';
+        mNodes[x].traceFile->setFilter(mFilter);
+        if (advance(mNodes[x])) {
+            heap.push(heapEntry(mNodes[x].next.epoch() + mNodes[x].skew, x));
+        }
+    }
+
+    unsigned deadlockCount = 0;
+    while (!heap.empty()) {
+        size_t x = heap.top().second;
+        heap.pop();
+
+        timelineEntry(out, mNodes[x]);
+        deadlockCount++;
+
+        if (advance(mNodes[x])) {
+            heap.push(heapEntry(mNodes[x].next.epoch() + mNodes[x].skew, x));
+        }
+    }
+
+    return deadlockCount;
+}
+
+//==============================================================================
+//                                                               timelineEntry()
+//------------------------------------------------------------------------------
+// Writes one line of the timeline, for a node's current deadlock:
+//
+// 2018-12-19 15:42:20  ORCL1  orcl1_ora_1234.trc:11  DEADLOCK  TX-X-S  SIDs 272 1019
+// 2018-12-19 15:42:21  ORCL2  orcl2_lmd0_987.trc:40  GLOBAL  TX 0x1470008.0x72 inst 2 blocked by inst 1 sid 1402
+//==============================================================================
+void oraClusterMerge::timelineEntry(ostream &out, node &n)
+{
+    oraDeadlock &dl = n.next;
+    oraTraceFile *tf = n.traceFile;
+
+    if (dl.epoch()) {
+        out << oraFilter::formatTimestamp(dl.epoch() + n.skew);
+    } else {
+        out << "Unknown time       ";
+    }
+
+    out << "  " << (tf->instanceName().empty() ? "?" : tf->instanceName())
+        << "  " << tf->traceName() << ':';
+    if (dl.lineNumber()) {
+        out << dl.lineNumber();
+    } else {
+        out << '@' << dl.startOffset();
+    }
+
+    if (!dl.global()) {
+        out << "  DEADLOCK ";
+        const vector<string> *signatures = dl.signatures();
+        for (auto s = signatures->begin(); s != signatures->end(); s++) {
+            out << ' ' << *s;
+        }
+
+        out << "  SIDs";
+        for (unsigned x = 0; x < dl.rows(); x++) {
+            out << ' ' << dl.blockerByIndex(x)->session();
+        }
+
+        out << '\n';
+        return;
+    }
+
+    // Pair up each blocked lock with the blocker of the same resource.
+    out << "  GLOBAL";
+    const vector<oraGlobalLock> *locks = dl.globalLocks();
+    for (auto l = locks->begin(); l != locks->end(); l++) {
+        if (l->blocker) {
+            continue;
+        }
+
+        out << "  " << l->resource << " inst " << l->instance;
+        if (l->session) {
+            out << " sid " << l->session;
+        }
+
+        for (auto b = locks->begin(); b != locks->end(); b++) {
+            if (b->blocker && b->resource == l->resource) {
+                out << " blocked by inst " << b->instance;
+                if (b->session) {
+                    out << " sid " << b->session;
+                }
+                break;
+            }
+        }
+    }
+
+    out << '\n';
+}
+
+//==============================================================================
+//                                                                  mergeStats()
+//------------------------------------------------------------------------------
+// Adds every trace file's statistics to a running total.
+//==============================================================================
+void oraClusterMerge::mergeStats(oraStats &total)
+{
+    for (auto n = mNodes.begin(); n != mNodes.end(); n++) {
+        n->traceFile->stats()->stop();
+        total.merge(*n->traceFile->stats());
+    }
+}
@@ -0,0 +1,196 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraColumnarExport.h"
+#include "oraDeadlockIndex.h"
+
+//==============================================================================
+//                                                                resourceType()
+//------------------------------------------------------------------------------
+// The lock type of a resource name, "TX" from "TX-00090016-00001234", say.
+//==============================================================================
+static string resourceType(const string &resource)
+{
+    return resource.substr(0, resource.find('-'));
+}
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// Creates both files, and their schemas. Check good() before adding.
+//==============================================================================
+oraColumnarExport::oraColumnarExport(const string &baseName, const string &createdBy) :
+    mDeadlocks(baseName + ".deadlocks.parquet", createdBy),
+    mGraph(baseName + ".graph.parquet", createdBy)
+{
+    mDeadlocks.addColumn("trace_file", oraParquetWriter::dictionaryColumn);
+    mDeadlocks.addColumn("instance", oraParquetWriter::dictionaryColumn);
+    mDeadlocks.addColumn("deadlock", oraParquetWriter::int32Column);
+    mDeadlocks.addColumn("line", oraParquetWriter::int32Column);
+    mDeadlocks.addColumn("start_offset", oraParquetWriter::int64Column);
+    mDeadlocks.addColumn("time", oraParquetWriter::timestampColumn);
+    mDeadlocks.addColumn("global", oraParquetWriter::boolColumn);
+    mDeadlocks.addColumn("signature", oraParquetWriter::dictionaryColumn);
+    mDeadlocks.addColumn("wait", oraParquetWriter::dictionaryColumn);
+    mDeadlocks.addColumn("aborted_session", oraParquetWriter::int32Column);
+    mDeadlocks.addColumn("sql_hash", oraParquetWriter::int64Column);
+    mDeadlocks.addColumn("sql", oraParquetWriter::stringColumn);
+    mDeadlocks.addColumn("rows", oraParquetWriter::int32Column);
+    mDeadlocks.addColumn("parse_errors", oraParquetWriter::int32Column);
+
+    mGraph.addColumn("trace_file", oraParquetWriter::dictionaryColumn);
+    mGraph.addColumn("deadlock", oraParquetWriter::int32Column);
+    mGraph.addColumn("line", oraParquetWriter::int32Column);
+    mGraph.addColumn("time", oraParquetWriter::timestampColumn);
+    mGraph.addColumn("resource", oraParquetWriter::stringColumn);
+    mGraph.addColumn("resource_type", oraParquetWriter::dictionaryColumn);
+    mGraph.addColumn("blocker_session", oraParquetWriter::int32Column);
+    mGraph.addColumn("blocker_process", oraParquetWriter::int32Column);
+    mGraph.addColumn("blocker_holds", oraParquetWriter::dictionaryColumn);
+    mGraph.addColumn("blocker_waits", oraParquetWriter::dictionaryColumn);
+    mGraph.addColumn("waiter_session", oraParquetWriter::int32Column);
+    mGraph.addColumn("waiter_process", oraParquetWriter::int32Column);
+    mGraph.addColumn("waiter_holds", oraParquetWriter::dictionaryColumn);
+    mGraph.addColumn("waiter_waits", oraParquetWriter::dictionaryColumn);
+    mGraph.addColumn("object_id", oraParquetWriter::int32Column);
+    mGraph.addColumn("data_object_id", oraParquetWriter::int32Column);
+    mGraph.addColumn("file", oraParquetWriter::int32Column);
+    mGraph.addColumn("block", oraParquetWriter::int64Column);
+    mGraph.addColumn("slot", oraParquetWriter::int32Column);
+    mGraph.addColumn("rowid", oraParquetWriter::dictionaryColumn);
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraColumnarExport::~oraColumnarExport()
+{
+}
+
+//==============================================================================
+//                                                                         add()
+//------------------------------------------------------------------------------
+// Adds a deadlock, and its graph. The number is the deadlock's number within
+// its trace file, from 1, as in the reports. Sessions, and so on, which aren't
+// known are zero, and the strings are empty.
+//==============================================================================
+void oraColumnarExport::add(oraTraceFile &traceFile, const oraDeadlock &dl, const unsigned number)
+{
+    string traceName = traceFile.traceName();
+    long long millis = dl.epoch() * 1000;
+
+    string signature;
+    const vector<string> *signatures = dl.signatures();
+    for (auto s = signatures->begin(); s != signatures->end(); s++) {
+        signature += (s == signatures->begin() ? "" : " ") + *s;
+    }
+
+    mDeadlocks.add(traceName);
+    mDeadlocks.add(traceFile.instanceName());
+    mDeadlocks.add(number);
+    mDeadlocks.add(dl.lineNumber());
+    mDeadlocks.add(dl.startOffset());
+    mDeadlocks.add(millis);
+    mDeadlocks.add(dl.global());
+    mDeadlocks.add(dl.global() ? string("GLOBAL") : signature);
+    mDeadlocks.add(dl.deadlockWait());
+    mDeadlocks.add(dl.global() ? 0 : dl.abortedSession());
+    string sql = dl.global() ? string() : dl.SQL();
+    mDeadlocks.add(sql.empty() ? 0 : oraDeadlockIndex::sqlHash(sql));
+    mDeadlocks.add(sql);
+    mDeadlocks.add(dl.global() ? dl.globalLocks()->size() : dl.rows());
+    mDeadlocks.add(dl.parseErrors()->size());
+    mDeadlocks.endRow();
+
+    if (dl.global()) {
+        // Each lock is either held, or waited for, by a session.
+        const vector<oraGlobalLock> *locks = dl.globalLocks();
+        for (auto l = locks->begin(); l != locks->end(); l++) {
+            mGraph.add(traceName);
+            mGraph.add(number);
+            mGraph.add(dl.lineNumber());
+            mGraph.add(millis);
+            mGraph.add(l->resource);
+            mGraph.add(resourceType(l->resource));
+            mGraph.add(l->blocker ? l->session : 0);
+            mGraph.add(0);
+            mGraph.add(string());
+            mGraph.add(string());
+            mGraph.add(l->blocker ? 0 : l->session);
+            mGraph.add(0);
+            mGraph.add(string());
+            mGraph.add(string());
+            for (int x = 0; x < 5; x++) {
+                mGraph.add(0);
+            }
+            mGraph.add(string());
+            mGraph.add(0);
+            mGraph.endRow();
+        }
+        return;
+    }
+
+    const oraBlockerWaiter none(true);
+    for (unsigned x = 0; x < dl.rows(); x++) {
+        const oraBlockerWaiter *blocker = dl.blockerByIndex(x);
+        const oraBlockerWaiter *waiter = dl.waiterBySession(blocker->otherSession());
+        if (!waiter) {
+            waiter = &none;
+        }
+
+        mGraph.add(traceName);
+        mGraph.add(number);
+        mGraph.add(dl.lineNumber());
+        mGraph.add(millis);
+        mGraph.add(blocker->resourceName());
+        mGraph.add(resourceType(blocker->resourceName()));
+        mGraph.add(blocker->session());
+        mGraph.add(blocker->process());
+        mGraph.add(blocker->holds());
+        mGraph.add(blocker->waits());
+        mGraph.add(waiter->session());
+        mGraph.add(waiter->process());
+        mGraph.add(waiter->holds());
+        mGraph.add(waiter->waits());
+        mGraph.add(waiter->objectId());
+        mGraph.add(waiter->dataObjectId());
+        mGraph.add(waiter->file());
+        mGraph.add(waiter->block());
+        mGraph.add(waiter->slot());
+        mGraph.add(waiter->rowidWait());
+        mGraph.endRow();
+    }
+}
+
+//==============================================================================
+//                                                                       close()
+//------------------------------------------------------------------------------
+// Writes what's left, and the footers. False if either file failed.
+//==============================================================================
+bool oraColumnarExport::close()
+{
+    bool deadlocksOk = mDeadlocks.close();
+    bool graphOk = mGraph.close();
+    return deadlocksOk && graphOk;
+}
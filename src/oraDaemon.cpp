@@ -0,0 +1,562 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraDaemon.h"
+#include "oraDeadlockReport.h"
+#include "oraParseResult.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DAEMON_SUPPORTED
+#include <csignal>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+using std::cerr;
+using std::endl;
+using std::ostringstream;
+
+// The largest trace file we will accept over the socket.
+#define DAEMON_MAX_DATA (1024ULL * 1024 * 1024)
+
+// The longest request line. Anyone going on for longer isn't talking to us.
+#define DAEMON_MAX_REQUEST (64 * 1024)
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraDaemon::oraDaemon(const string socketPath, const unsigned threads):
+    mSocketPath(socketPath)
+{
+    mThreads = threads ? threads : 1;
+    mListener = -1;
+    mFilter = nullptr;
+    mExcerpts = false;
+    mDeadlockBudget = DEADLOCK_BYTE_BUDGET;
+    mTimeLimit = 0.0;
+    mObjects = nullptr;
+    mStopping = false;
+    mWake[0] = -1;
+    mWake[1] = -1;
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraDaemon::~oraDaemon()
+{
+#ifdef DAEMON_SUPPORTED
+    if (mListener >= 0) {
+        close(mListener);
+        unlink(mSocketPath.c_str());
+        mListener = -1;
+    }
+#endif
+}
+
+//==============================================================================
+//                                                                     analyse()
+//------------------------------------------------------------------------------
+// Parses a trace file and returns the results, as JSON. Writes the HTML
+// report as well, if asked.
+//==============================================================================
+string oraDaemon::analyse(oraTraceFile &traceFile, const bool writeReport)
+{
+    traceFile.setFilter(mFilter);
+    traceFile.setDeadlockBudget(mDeadlockBudget);
+
+    unsigned deadlockCount;
+    {
+        oraWatchdog::guard watch(mWatchdog.get(), &traceFile, mTimeLimit);
+        deadlockCount = traceFile.parse();
+    }
+
+    oraParseResult result(traceFile);
+
+    string reportName;
+    if (writeReport) {
+        oraDeadlockReport reportFile(&result, traceFile.stats());
+        if (reportFile.good()) {
+            reportFile.setExcerpts(mExcerpts);
+            reportFile.setObjects(mObjects);
+            reportFile.report();
+            reportName = reportFile.reportName();
+        }
+    }
+
+    traceFile.stats()->stop();
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"trace\": " << jsonString(result.traceName()) << ",\n"
+         << "  \"originalPath\": " << jsonString(result.originalPath()) << ",\n"
+         << "  \"instance\": " << jsonString(result.instanceName()) << ",\n"
+         << "  \"server\": " << jsonString(result.serverName()) << ",\n"
+         << "  \"report\": " << (reportName.empty() ? "null" : jsonString(reportName)) << ",\n"
+         << "  \"deadlockCount\": " << deadlockCount << ",\n"
+         << "  \"timedOut\": " << (result.timedOut() ? "true" : "false") << ",\n"
+         << "  \"deadlocks\": [";
+
+    for (unsigned x = 0; x < deadlockCount; x++) {
+        json << (x ? ",\n" : "\n");
+        result.deadLock(x)->toJSON(json, "    ");
+    }
+
+    json << "\n  ],\n  \"stats\":\n";
+    traceFile.stats()->toJSON(json, traceFile.traceName(), "  ");
+    json << "\n}\n";
+
+    return json.str();
+}
+
+#ifdef DAEMON_SUPPORTED
+
+// Set by the SIGTERM and SIGINT handlers.
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void stopHandler(int)
+{
+    stopRequested = 1;
+}
+
+//==============================================================================
+//                                                                    writeAll()
+//------------------------------------------------------------------------------
+// Writes all of some data to a socket. Returns false if the client has gone.
+//==============================================================================
+static bool writeAll(const int fd, const string &data)
+{
+    const char *next = data.data();
+    size_t left = data.size();
+
+    while (left) {
+        ssize_t written = write(fd, next, left);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (written <= 0) {
+            return false;
+        }
+
+        next += written;
+        left -= written;
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                    fillFrom()
+//------------------------------------------------------------------------------
+// Reads whatever is available from a socket onto the end of pending. Returns
+// false at EOF or on error.
+//==============================================================================
+static bool fillFrom(const int fd, string &pending)
+{
+    char buffer[64 * 1024];
+
+    while (true) {
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (got <= 0) {
+            return false;
+        }
+
+        pending.append(buffer, got);
+        return true;
+    }
+}
+
+//==============================================================================
+//                                                                 readRequest()
+//------------------------------------------------------------------------------
+// Reads one request line from a socket. Anything read after it is left in
+// pending for next time.
+//==============================================================================
+static bool readRequest(const int fd, string &pending, string &line)
+{
+    size_t pos;
+    while ((pos = pending.find('\n')) == string::npos) {
+        if (!fillFrom(fd, pending)) {
+            return false;
+        }
+    }
+
+    line = pending.substr(0, pos);
+    pending.erase(0, pos + 1);
+
+    // Be kind to telnet.
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                   readBytes()
+//------------------------------------------------------------------------------
+// Reads exactly length bytes, after a DATA request, from a socket. Whatever
+// came with the request is used first, the rest is read straight into data.
+//==============================================================================
+static bool readBytes(const int fd, string &pending, const size_t length, string &data)
+{
+    size_t have = std::min(pending.size(), length);
+    data.assign(pending, 0, have);
+    pending.erase(0, have);
+    data.resize(length);
+
+    while (have < length) {
+        ssize_t got = read(fd, &data[have], length - have);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (got <= 0) {
+            return false;
+        }
+
+        have += got;
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                 wantsWorker()
+//------------------------------------------------------------------------------
+// Does a connection have a whole request line waiting?
+//==============================================================================
+static bool wantsWorker(const oraDaemon::connection &client)
+{
+    return client.pending.find('\n') != string::npos;
+}
+
+//==============================================================================
+//                                                                       serve()
+//------------------------------------------------------------------------------
+// Handles the next request on a connection, which has been read already, all
+// but any DATA. Returns false if the connection is finished with, the client
+// has quit, gone away, or sent something we can't make sense of.
+//==============================================================================
+bool oraDaemon::serve(connection &client)
+{
+    const int fd = client.fd;
+    string line;
+
+    if (!readRequest(fd, client.pending, line)) {
+        return false;
+    }
+
+    auto pos = line.find(' ');
+    string command = line.substr(0, pos);
+    string argument = (pos == string::npos) ? "" : line.substr(pos + 1);
+    string result;
+
+    if (command == "QUIT") {
+        return false;
+    }
+
+    if (command == "PARSE" || command == "REPORT") {
+        oraTraceFile traceFile(argument);
+        if (!traceFile.good()) {
+            return writeAll(fd, "ERROR Cannot open tracefile " + argument + "\n");
+        }
+
+        result = analyse(traceFile, command == "REPORT");
+    } else if (command == "DATA") {
+        // DATA name length
+        pos = argument.rfind(' ');
+        char *end = nullptr;
+        unsigned long long length = 0;
+        if (pos != string::npos) {
+            length = std::strtoull(argument.c_str() + pos + 1, &end, 10);
+        }
+
+        if (pos == string::npos || *end != '\0' || length > DAEMON_MAX_DATA) {
+            // We can't tell where the data ends, so give up on them.
+            writeAll(fd, "ERROR Invalid DATA request\n");
+            return false;
+        }
+
+        string data;
+        if (!readBytes(fd, client.pending, length, data)) {
+            return false;
+        }
+
+        oraTraceFile traceFile(argument.substr(0, pos), data.data(), data.size());
+        result = analyse(traceFile, false);
+    } else {
+        return writeAll(fd, "ERROR Unknown request " + command + "\n");
+    }
+
+    return writeAll(fd, "OK " + std::to_string(result.size()) + "\n" + result);
+}
+
+//==============================================================================
+//                                                                      worker()
+//------------------------------------------------------------------------------
+// One of the pool of threads. Serves requests until told to stop, handing
+// each connection back to the listener afterwards.
+//==============================================================================
+void oraDaemon::worker()
+{
+    while (true) {
+        std::unique_ptr<connection> client;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mReady.wait(lock, [this] { return mStopping || !mRequests.empty(); });
+            if (mStopping) {
+                return;
+            }
+
+            client = std::move(mRequests.front());
+            mRequests.pop_front();
+            mOpen.insert(client->fd);
+        }
+
+        bool keep = serve(*client);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOpen.erase(client->fd);
+        if (!keep || mStopping) {
+            close(client->fd);
+            continue;
+        }
+
+        mReturned.push_back(std::move(client));
+        if (write(mWake[1], "", 1) < 0) {
+            // Full, so the listener has been told already.
+        }
+    }
+}
+
+//==============================================================================
+//                                                                         run()
+//------------------------------------------------------------------------------
+// Listens on the socket, and on the idle connections, handing each request
+// to a worker thread, until told to stop. Returns false if the socket can't
+// be set up.
+//==============================================================================
+bool oraDaemon::run()
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (mSocketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path is too long: " << mSocketPath << endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, mSocketPath.c_str());
+
+    mListener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mListener < 0) {
+        cerr << "Cannot create socket: " << std::strerror(errno) << endl;
+        return false;
+    }
+
+    // A previous daemon might have left its socket behind.
+    unlink(mSocketPath.c_str());
+    if (bind(mListener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+        listen(mListener, 16) < 0) {
+        cerr << "Cannot listen on " << mSocketPath << ": " << std::strerror(errno) << endl;
+        close(mListener);
+        mListener = -1;
+        return false;
+    }
+
+    // The workers wake us up with this when they have finished a request.
+    if (pipe(mWake) < 0) {
+        cerr << "Cannot create pipe: " << std::strerror(errno) << endl;
+        return false;
+    }
+    fcntl(mWake[0], F_SETFL, O_NONBLOCK);
+    fcntl(mWake[1], F_SETFL, O_NONBLOCK);
+
+    // Clients going away mustn't kill us, and we need to know when to stop.
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, stopHandler);
+    signal(SIGINT, stopHandler);
+
+    // One watchdog for all the workers, if requests are time limited.
+    if (mTimeLimit > 0.0) {
+        mWatchdog.reset(new oraWatchdog());
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned x = 0; x < mThreads; x++) {
+        workers.push_back(std::thread(&oraDaemon::worker, this));
+    }
+
+    cerr << "Listening on " << mSocketPath << " with " << mThreads << " thread(s)." << endl;
+
+    // The connections that are ours, waiting for their next request, and
+    // what we wait on. The listener and the wake pipe come first.
+    std::vector<std::unique_ptr<connection>> idle;
+    std::vector<pollfd> waitFor;
+
+    // Checks for a stop request every now and then.
+    while (!stopRequested) {
+        waitFor.resize(2 + idle.size());
+        waitFor[0] = { mListener, POLLIN, 0 };
+        waitFor[1] = { mWake[0], POLLIN, 0 };
+        for (size_t x = 0; x < idle.size(); x++) {
+            waitFor[2 + x] = { idle[x]->fd, POLLIN, 0 };
+        }
+
+        if (poll(waitFor.data(), waitFor.size(), 500) <= 0) {
+            continue;
+        }
+
+        std::vector<std::unique_ptr<connection>> ready;
+
+        // Anything a client has sent. A whole request line gets a worker.
+        for (size_t x = 0; x < idle.size(); x++) {
+            if (!waitFor[2 + x].revents) {
+                continue;
+            }
+
+            connection &client = *idle[x];
+            if (!fillFrom(client.fd, client.pending)) {
+                close(client.fd);
+                idle[x].reset();
+            } else if (wantsWorker(client)) {
+                ready.push_back(std::move(idle[x]));
+            } else if (client.pending.size() > DAEMON_MAX_REQUEST) {
+                writeAll(client.fd, "ERROR Request too long\n");
+                close(client.fd);
+                idle[x].reset();
+            }
+        }
+
+        idle.erase(std::remove(idle.begin(), idle.end(), nullptr), idle.end());
+
+        // Connections the workers have finished with. They might have sent
+        // the next request already.
+        if (waitFor[1].revents & POLLIN) {
+            char drain[256];
+            while (read(mWake[0], drain, sizeof(drain)) > 0) {
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto c = mReturned.begin(); c != mReturned.end(); c++) {
+                if (wantsWorker(**c)) {
+                    ready.push_back(std::move(*c));
+                } else {
+                    idle.push_back(std::move(*c));
+                }
+            }
+            mReturned.clear();
+        }
+
+        // New clients.
+        if (waitFor[0].revents & POLLIN) {
+            int fd = accept(mListener, nullptr, nullptr);
+            if (fd >= 0) {
+                idle.push_back(std::unique_ptr<connection>(new connection { fd, string() }));
+            }
+        }
+
+        if (!ready.empty()) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto c = ready.begin(); c != ready.end(); c++) {
+                mRequests.push_back(std::move(*c));
+                mReady.notify_one();
+            }
+        }
+    }
+
+    // A worker reading the rest of a DATA request could wait forever, so
+    // those connections get shut too.
+    cerr << "Stopping." << endl;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        for (auto fd = mOpen.begin(); fd != mOpen.end(); fd++) {
+            shutdown(*fd, SHUT_RD);
+        }
+    }
+    mReady.notify_all();
+
+    for (auto w = workers.begin(); w != workers.end(); w++) {
+        w->join();
+    }
+
+    // Everyone else is turned away.
+    for (auto c = idle.begin(); c != idle.end(); c++) {
+        close((*c)->fd);
+    }
+    for (auto c = mRequests.begin(); c != mRequests.end(); c++) {
+        close((*c)->fd);
+    }
+    for (auto c = mReturned.begin(); c != mReturned.end(); c++) {
+        close((*c)->fd);
+    }
+    mRequests.clear();
+    mReturned.clear();
+
+    close(mWake[0]);
+    close(mWake[1]);
+    return true;
+}
+
+#else
+
+//==============================================================================
+//                                                                         run()
+//------------------------------------------------------------------------------
+// No UNIX domain sockets here.
+//==============================================================================
+bool oraDaemon::run()
+{
+    cerr << "Daemon mode is not supported on this platform." << endl;
+    return false;
+}
+
+void oraDaemon::worker()
+{
+}
+
+bool oraDaemon::serve(connection &)
+{
+    return false;
+}
+
+#endif
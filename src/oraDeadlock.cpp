@@ -24,8 +24,14 @@
 
 #include "oraDeadlock.h"
 #include "oraTraceFile.h"
+#include "oraRowid.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <iterator>
+#include <sstream>
 
-using std::stoi;
 using std::cerr;
 using std::endl;
 using std::pair;
@@ -36,15 +42,28 @@ using std::find;
 //                                                                   Constructor
 //==============================================================================
 oraDeadlock::oraDeadlock(oraTraceFile *tf):
-    mTraceFile(tf)
+    mTraceFile(tf),
+    mText(tf->mText)
 {
-    // Get the line number.
-    mLineNumber = tf->lineNumber();
+    // Get the line number, and where in the file this deadlock starts. That's
+    // the "*** 2018-12-19 15:42:20.941" line before "DEADLOCK DETECTED".
+    mLineNumber = tf->lineNumbersKnown() ? tf->lineNumber() : 0;
+    mStartOffset = tf->currentOffset();
+    if (tf->previousLine().substr(0, 4) == "*** ") {
+        mStartOffset = tf->previousOffset();
+    }
+    mEndOffset = mStartOffset;
+    mRejected = false;
+    mTruncated = false;
+    mEpoch = 0;
+    mGlobal = false;
+
+    mSQLStart = 0;
+    mSQLEnd = 0;
 
     // Preallocate strings.
     mDate.reserve(10);
     mTime.reserve(10);
-    mAbortedSQL.reserve(2048);
 
     // Allocate space for 5 strings.
     mSignatures.reserve(5);
@@ -73,162 +92,601 @@ void oraDeadlock::setDateTime(const string date, const string time)
 }
 
 //==============================================================================
-//                                                             extractDeadlock()
+//                                                             extractDateTime()
 //------------------------------------------------------------------------------
-// Extracts relevant information from the tracefile for one deadlock.
+// Extracts the date and time of this deadlock from the last timestamp line
+// read. That's usually the line before a "DEADLOCK DETECTED", but can be a few
+// lines before a global wait-for-graph. No timestamp, no date and time.
+// *** 2018-12-19 15:42:20.941....
 //==============================================================================
-bool oraDeadlock::extractDeadlock()
+void oraDeadlock::extractDateTime()
 {
-    if (!extractDeadlockGraph()) {
-        cerr << "Cannot extract deadlock graph.";
-        return false;
+    const string &deadlockTime = mTraceFile->lastTimestamp();
+    if (deadlockTime.empty() ||
+        !oraFilter::parseTimestamp(deadlockTime.data() + 4, deadlockTime.size() - 4, mEpoch)) {
+        mEpoch = 0;
+        mDate.clear();
+        mTime.clear();
+        return;
     }
 
-    if (!extractRowsWaited()) {
-        cerr << "Cannot extract details of rows waited on.";
-        return false;
+    mDate = deadlockTime.substr(4, 10);
+    mTime = deadlockTime.substr(15, 8);
+}
+
+//==============================================================================
+// Extraction is a single pass state machine. Each line of the deadlock dump is
+// read once, and passed to the handler for the section we are currently in.
+// When not in a section, the line is checked against the section markers
+// below to see if a new section starts. Sections can be missing, or in a
+// different order, and a "DEADLOCK DETECTED" line ends this deadlock and is
+// left for the trace file to find again.
+//==============================================================================
+
+// Phase names for the stats and tracepoints, indexed by section.
+static const char *sectionNames[oraDeadlock::sectionCount] = {
+    "scanDeadlock",
+    "extractDeadlockGraph",
+    "extractRowsWaited",
+    "extractCurrentSQL",
+    "extractProcessState",
+    "extractWaitStack"
+};
+
+// The line handler for each section, indexed by section.
+const oraDeadlock::sectionHandler oraDeadlock::mHandlers[oraDeadlock::sectionCount] = {
+    &oraDeadlock::scanLine,
+    &oraDeadlock::graphLine,
+    &oraDeadlock::rowsWaitedLine,
+    &oraDeadlock::sqlLine,
+    &oraDeadlock::currentWaitLine,
+    &oraDeadlock::waitHistoryLine
+};
+
+// Lines that start a section. Those found "near start" may be indented. The
+// process state ones only count after "PROCESS STATE" has been seen, as the
+// other sessions' details can have similar looking lines.
+struct sectionMarker {
+    const char *text;
+    size_t length;
+    bool nearStart;
+    bool needsProcessState;
+    oraDeadlock::section next;
+};
+
+#define MARKER(text, nearStart, needsPS, next) \
+    { text, sizeof(text) - 1, nearStart, needsPS, oraDeadlock::next }
+
+static const sectionMarker sectionMarkers[] = {
+    MARKER("Resource Name",                false, false, sectionGraph),
+    MARKER("Rows waited on:",              false, false, sectionRowsWaited),
+    MARKER("----- Current SQL Statement",  false, false, sectionSQL),
+    MARKER("PROCESS STATE",                false, false, sectionScanning),
+    MARKER("Current Wait Stack:",          true,  true,  sectionCurrentWait),
+    MARKER("Session Wait History:",        true,  true,  sectionWaitHistory)
+};
+
+#undef MARKER
+
+// Does line start with text? No temporary strings please, this is called
+// for every line.
+static inline bool startsWith(const string &line, const char *text, const size_t length,
+                              const size_t from = 0)
+{
+    return line.compare(from, length, text, length) == 0;
+}
+
+// Returns the section marker that line starts with, or nullptr if none.
+static const sectionMarker *findMarker(const string &line, const bool seenProcessState)
+{
+    for (auto m = std::begin(sectionMarkers); m != std::end(sectionMarkers); m++) {
+        if (m->needsProcessState && !seenProcessState) {
+            continue;
+        }
+
+        size_t from = 0;
+        if (m->nearStart) {
+            from = line.find_first_not_of(" \t");
+            if (from == string::npos) {
+                continue;
+            }
+        }
+
+        if (startsWith(line, m->text, m->length, from)) {
+            return m;
+        }
     }
 
-    if (!extractCurrentSQL()) {
-        cerr << "Cannot extract current SQL statement.";
+    return nullptr;
+}
+
+// Reads an unsigned number from line, starting at from, after any spaces,
+// and looking no further than length characters. Returns false, and leaves
+// value alone, if there isn't one there. Trace files can be truncated, or
+// corrupt, so this never throws.
+static inline bool parseNumber(const string &line, const size_t from, unsigned &value,
+                               const size_t length = string::npos)
+{
+    if (from >= line.size()) {
         return false;
     }
 
-    if (!extractProcessState()) {
-        cerr << "Cannot extract process state details.";
-        return false;
+    const char *first = line.data() + from;
+    const char *last = line.data() + (length < line.size() - from ? from + length : line.size());
+    while (first < last && *first == ' ') {
+        first++;
     }
 
-    if (!extractWaitStack()) {
-        cerr << "Cannot extract process wait stack details.";
-        return false;
+    return std::from_chars(first, last, value).ec == std::errc();
+}
+
+// As substr(), but returns "" instead of throwing if from is past the end.
+static inline string field(const string &line, const size_t from,
+                           const size_t length = string::npos)
+{
+    return (from < line.size()) ? line.substr(from, length) : string();
+}
+
+//==============================================================================
+//                                                                    location()
+//------------------------------------------------------------------------------
+// Where the trace file is now, for error messages. Line numbers aren't known
+// if we skipped through the file by time.
+//==============================================================================
+string oraDeadlock::location()
+{
+    if (mTraceFile->lineNumbersKnown()) {
+        return "line " + std::to_string(mTraceFile->lineNumber());
     }
 
+    return "byte offset " + std::to_string(mTraceFile->currentOffset());
+}
 
+//==============================================================================
+//                                                                  overBudget()
+//------------------------------------------------------------------------------
+// Has this deadlock gone on for longer than the trace file's byte budget? If
+// so, it's noted, and extraction should stop here.
+//==============================================================================
+bool oraDeadlock::overBudget()
+{
+    unsigned long long budget = mTraceFile->mDeadlockBudget;
+    if (!budget || mTraceFile->nextOffset() - mStartOffset <= budget) {
+        return false;
+    }
+
+    parseError("Deadlock is over " + std::to_string(budget) + " bytes long at " +
+               location() + ", the rest is skipped.");
     return true;
 }
 
 //==============================================================================
-//                                                        extractDeadlockGraph()
+//                                                                  parseError()
 //------------------------------------------------------------------------------
-// Extracts relevant information from the tracefile for each deadlock
-// found within.
+// Records something we couldn't parse in this deadlock. Only the first few
+// are kept, and reported, but they are all counted. Quiet if the trace file
+// is, the library hands them back through dlaError() instead.
 //==============================================================================
-bool oraDeadlock::extractDeadlockGraph()
+void oraDeadlock::parseError(const string &what)
 {
-    // Extract the Date and time of this deadlock.
-    // *** 2018-12-19 15:42:20.941....
-    string deadlockTime = mTraceFile->previousLine();
-    auto pos = deadlockTime.find(' ');
-    auto pos2 = deadlockTime.find(' ', pos + 1);
-    mDate = deadlockTime.substr(pos + 1, pos2 - pos -1);
-    mTime = deadlockTime.substr(pos2 + 1, 8);
-
-    // Find the deadlock graph...
-    if (!mTraceFile->findDeadlockGraph()) {
-        return false;
+    mTraceFile->mStats.addParseError();
+    if (mParseErrors.size() >= MAX_PARSE_ERRORS) {
+        return;
     }
 
-    /*
-                           ---------Blocker(s)--------  ---------Waiter(s)---------
-    Resource Name          process session holds waits  process session holds waits
-    TX-0018001f-0025006a       985     272     X            821    1019           S
-    TX-0004000e-004a8a86       821    1019     X            779    2156           S
-    TX-00360007-001b448f       779    2156     X            985     272           S
-    */
+    mParseErrors.push_back(what);
+    if (mTraceFile->mVerbose) {
+        cerr << what << endl;
+    }
+}
 
-    // Find the resources in the deadlock.
-    if (!mTraceFile->findAtStart("Resource Name")) {
-        cerr << "Cannot find [Resource Name]" << endl;
-        return false;
+//==============================================================================
+// Everything we need to know while extracting, but not afterwards.
+//==============================================================================
+struct oraDeadlock::extractContext {
+    section current = sectionScanning;
+    bool seen[sectionCount] = {};
+    bool seenProcessState = false;
+    oraBlockerWaiter *pendingWaiter = nullptr;
+    oraWaitEvent thisWait;
+    bool inWait = false;
+    bool needParameters = false;
+
+    // Only if the phases are being timed.
+    bool timed = oraStats::timing();
+    std::chrono::steady_clock::time_point started =
+        timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    oraAllocMark alloc;
+};
+
+//==============================================================================
+//                                                                enterSection()
+//------------------------------------------------------------------------------
+// Moves the state machine to a new section. If phases are being timed, this
+// accounts for the time spent in the old one, and the memory it allocated,
+// and fires the phase tracepoints.
+//==============================================================================
+void oraDeadlock::enterSection(extractContext &ctx, const section next)
+{
+    const section previous = ctx.current;
+    ctx.current = next;
+    ctx.seen[next] = true;
+
+    if (!ctx.timed) {
+        return;
     }
 
-    // Each resource should have a blocker and waiter.
-    oraBlockerWaiter tempBlocker(false), tempWaiter(true);
+    oraStats *stats = &mTraceFile->mStats;
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> d = now - ctx.started;
 
-    // And a signature.
-    string signature;
+    ORA_PROBE4(phase__end, sectionNames[previous], mTraceFile->lineNumber(),
+               mTraceFile->currentOffset(),
+               std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    stats->addPhase(sectionNames[previous], d.count(), ctx.alloc.finish());
+
+    ctx.started = now;
+    ctx.alloc.start();
+    ORA_PROBE3(phase__start, sectionNames[next], mTraceFile->lineNumber(),
+               mTraceFile->currentOffset());
+}
+
+//==============================================================================
+//                                                             extractDeadlock()
+//------------------------------------------------------------------------------
+// Extracts relevant information from the tracefile for one deadlock. We are
+// sitting on the "DEADLOCK DETECTED" line at this point.
+//==============================================================================
+bool oraDeadlock::extractDeadlock()
+{
+    // Extract the Date and time of this deadlock.
+    extractDateTime();
+
+    extractContext ctx;
+    const string &line = mTraceFile->mCurrentLine;
+    ORA_PROBE3(phase__start, sectionNames[ctx.current], mTraceFile->lineNumber(),
+               mTraceFile->currentOffset());
 
-    deadlockTime = mTraceFile->readLine();
-    while (mTraceFile->good()) {
-        // The resources end at a one-space line.
-        if (deadlockTime == " ") {
+    while (true) {
+        mTraceFile->readLine();
+        if (!mTraceFile->good()) {
+            mTruncated = true;
             break;
         }
 
-        //Extract the blocking session's details.
-        signature = deadlockTime.substr(0, 2) + '-';
-
-        auto pos = deadlockTime.find(" ");
-        tempBlocker.setResourceName(deadlockTime.substr(0, pos));
-        tempBlocker.setProcess(stoi(deadlockTime.substr(23, 7)));
-        tempBlocker.setSession(stoi(deadlockTime.substr(31, 7)));
-        tempBlocker.setHolds(deadlockTime.substr(39, 5));
-        signature += (tempBlocker.holds().empty() ? "" : tempBlocker.holds());
-        tempBlocker.setWaits(deadlockTime.substr(45, 5));
-        signature += (tempBlocker.waits().empty() ? "" : tempBlocker.waits());
-
-        //Extract the waiting session's details.
-        tempWaiter.setResourceName(tempBlocker.resourceName());
-        tempWaiter.setProcess(stoi(deadlockTime.substr(52, 7)));
-        tempWaiter.setSession(stoi(deadlockTime.substr(60, 7)));
-        tempWaiter.setHolds(deadlockTime.substr(68, 5));
-        signature += '-' + (tempWaiter.holds().empty() ? "" : tempWaiter.holds());
-        tempWaiter.setWaits(deadlockTime.substr(74, 5));
-        signature += (tempWaiter.waits().empty() ? "" : tempWaiter.waits());
-
-        // Set the corresponding other session.
-        tempBlocker.setOtherSession(tempWaiter.session());
-        tempWaiter.setOtherSession(tempBlocker.session());
-
-        // Save the deadlock signature if the list is currently empty, or
-        // if we don't have this signature already. I know it's a palava
-        // scanning the vector, but it's only small.
-        vector<string>::iterator i;
-        for (i = mSignatures.begin(); i != mSignatures.end(); i++) {
-            if (*i == signature) {
-                // Exists, stop looking.
+        // The end of this deadlock?
+        if (line == "END OF PROCESS STATE") {
+            break;
+        }
+
+        // Or too big to be believed? The trace file carries on from here.
+        if (overBudget()) {
+            break;
+        }
+
+        // Or the start of the next one? Let the trace file find it again.
+        if (startsWith(line, "DEADLOCK DETECTED", 17)) {
+            mTraceFile->mResync = true;
+            break;
+        }
+
+        // Let the current section have the line. If it's done with, we go
+        // back to scanning for the next one.
+        if (!(this->*mHandlers[ctx.current])(ctx, line)) {
+            section finished = ctx.current;
+            enterSection(ctx, sectionScanning);
+
+            // Do we still want this deadlock? If not, don't waste time on
+            // the rest of it, the trace file will skip to the next one.
+            if (!wanted(finished)) {
+                mRejected = true;
                 break;
             }
+
+            // The line that ended it may well start the next section.
+            scanLine(ctx, line);
+        }
+    }
+
+    // Account for the final section.
+    enterSection(ctx, sectionScanning);
+
+    // A filtered section that never turned up can't match.
+    for (unsigned x = sectionGraph; !mRejected && x <= sectionRowsWaited; x++) {
+        if (!ctx.seen[x] && !wanted(static_cast<section>(x))) {
+            mRejected = true;
+        }
+    }
+
+    if (mRejected) {
+        return true;
+    }
+
+    // However it went, this is where the deadlock ends, as far as we know. If
+    // we ran into the next one, we end where it, and its timestamp, start.
+    mEndOffset = mTraceFile->nextOffset();
+    if (mTraceFile->mResync) {
+        mEndOffset = mTraceFile->currentOffset();
+        if (startsWith(mTraceFile->mPreviousLine, "*** ", 4)) {
+            mEndOffset = mTraceFile->previousOffset();
+        }
+    }
+
+    // Did we get everything?
+    bool ok = true;
+    for (unsigned x = sectionGraph; x < sectionCount; x++) {
+        if (!ctx.seen[x]) {
+            parseError(string("Cannot extract ") + (sectionNames[x] + 7) +
+                       " details from deadlock at line " + std::to_string(mLineNumber) + '.');
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+//==============================================================================
+//                                                          extractGlobalGraph()
+//------------------------------------------------------------------------------
+// Extracts a global (RAC) deadlock from an LMD trace file. We are sitting on
+// the "Global Wait-For-Graph(WFG)" line, and each lock follows on a line of
+// its own. Newer versions also dump the session, indented, after each lock.
+//
+// Global Wait-For-Graph(WFG) at ddTS[0.a5c2] :
+// BLOCKED 0x7000001cbfccba8 5 wq 2 cvtops x1 TX 0x1470008.0x72(ext 0x5,0x0)[68000-0002-0000000A] inst 2
+// BLOCKER 0x7000001cbfcf0b0 5 wq 1 cvtops x28 TX 0x1470008.0x72(ext 0x5,0x0)[66000-0001-00000014] inst 1
+//   sid: 1402 ser: 1259 audsid: 4294967295 user: 0/SYS
+//
+// The graph ends at a blank line, or any other unindented line, once we have
+// some locks.
+//==============================================================================
+bool oraDeadlock::extractGlobalGraph()
+{
+    mGlobal = true;
+    extractDateTime();
+
+    oraPhaseTimer timer(&mTraceFile->mStats, "extractGlobalGraph");
+    const string &line = mTraceFile->mCurrentLine;
+
+    while (true) {
+        mTraceFile->readLine();
+        if (!mTraceFile->good()) {
+            mEndOffset = mTraceFile->nextOffset();
+            mTruncated = true;
+            break;
+        }
+
+        // Anything that isn't ours ends the graph here.
+        mEndOffset = mTraceFile->currentOffset();
+
+        if (overBudget()) {
+            break;
+        }
+
+        // Or the start of the next one? Let the trace file find it again.
+        if (startsWith(line, "DEADLOCK DETECTED", 17) ||
+            startsWith(line, "Global Wait-For-Graph(WFG)", 26)) {
+            mTraceFile->mResync = true;
+            break;
+        }
+
+        if (startsWith(line, "BLOCKED ", 8) || startsWith(line, "BLOCKER ", 8)) {
+            oraGlobalLock lock;
+            std::istringstream fields(line);
+            string kind, wq, cvtops, ops, type, id;
+            unsigned queue;
+            fields >> kind >> lock.lockAddress >> lock.mode >> wq >> queue
+                   >> cvtops >> ops >> type >> id;
+
+            lock.blocker = (kind == "BLOCKER");
+            lock.resource = type + ' ' + id.substr(0, id.find('('));
+            if (kind.empty() || type.empty()) {
+                parseError("Invalid global lock at " + location());
+                continue;
+            }
+
+            auto pos = line.find('[');
+            auto pos2 = line.find(']', pos);
+            if (pos != string::npos && pos2 != string::npos) {
+                lock.transaction = line.substr(pos + 1, pos2 - pos - 1);
+            }
+
+            pos = line.rfind(" inst ");
+            if (pos != string::npos && !parseNumber(line, pos + 6, lock.instance)) {
+                parseError("Invalid instance number at " + location());
+            }
+
+            mGlobalLocks.push_back(lock);
+            continue;
+        }
+
+        auto pos = line.find_first_not_of(" \t");
+        if (pos != string::npos && pos > 0) {
+            // Indented, the session for the last lock, or something else
+            // we aren't interested in.
+            if (!mGlobalLocks.empty() && startsWith(line, "sid: ", 5, pos) &&
+                !parseNumber(line, pos + 5, mGlobalLocks.back().session)) {
+                parseError("Invalid session number at " + location());
+            }
+            continue;
         }
 
-        // If we hit the end, add it. Even if the final string was equal
-        // we won't be sitting at mSignatures.end() as that is past the end.
-        if (i == mSignatures.end()) {
-            mSignatures.push_back(signature);
+        if (!mGlobalLocks.empty()) {
+            break;
         }
+    }
+
+    if (mGlobalLocks.empty()) {
+        parseError("Cannot extract GlobalGraph details from deadlock at line " +
+                   std::to_string(mLineNumber) + '.');
+        return false;
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                      wanted()
+//------------------------------------------------------------------------------
+// Having just finished a section, does this deadlock still pass the trace
+// file's filter? Signatures and SIDs are known once the graph is done, and
+// object ids once the rows waited on are.
+//==============================================================================
+bool oraDeadlock::wanted(const section finished)
+{
+    oraFilter *filter = mTraceFile->mFilter;
+    if (!filter) {
+        return true;
+    }
 
-        // Save the blocker's details.
-        auto ok = mBlockers.insert(pair<unsigned, oraBlockerWaiter>(tempBlocker.session(), tempBlocker));
-        if (!ok.second) {
+    if (finished == sectionGraph) {
+        if (!filter->wantedSignatures(mSignatures)) {
             return false;
         }
 
-        // Save the waiter's details.
-        ok = mWaiters.insert(pair<unsigned, oraBlockerWaiter>(tempWaiter.session(), tempWaiter));
-        if (!ok.second) {
+        if (filter->hasSessionFilter()) {
+            // Every session in the graph is both a blocker and a waiter.
+            for (auto i = mWaiters.begin(); i != mWaiters.end(); i++) {
+                if (filter->wantedSession(i->first)) {
+                    return true;
+                }
+            }
+
             return false;
         }
+    }
+
+    if (finished == sectionRowsWaited && filter->hasObjectFilter()) {
+        for (auto i = mWaiters.begin(); i != mWaiters.end(); i++) {
+            if (filter->wantedObjectId(i->second.objectId())) {
+                return true;
+            }
+        }
 
-        // Average White Band time ... let's go round again!
-        deadlockTime = mTraceFile->readLine();
+        return false;
     }
 
     return true;
 }
 
 //==============================================================================
-//                                                           extractRowsWaited()
+//                                                                    scanLine()
 //------------------------------------------------------------------------------
-// Extracts the rows being waited on which caused the deadlock.
+// Not in any section. Checks if this line starts one. Each section is only
+// extracted once, the first time its marker is seen. Always returns true as we
+// are still scanning, even if we are now scanning in a new section.
 //==============================================================================
-bool oraDeadlock::extractRowsWaited()
+bool oraDeadlock::scanLine(extractContext &ctx, const string &line)
 {
-    // Skip over the session stuff, not interesting at all.
-    if (!mTraceFile->findAtStart("Rows waited on:")) {
+    const sectionMarker *m = findMarker(line, ctx.seenProcessState);
+    if (m) {
+        // PROCESS STATE is not a section in itself, it just enables others.
+        if (m->next == sectionScanning) {
+            ctx.seenProcessState = true;
+            return true;
+        }
+
+        if (!ctx.seen[m->next]) {
+            enterSection(ctx, m->next);
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                   graphLine()
+//------------------------------------------------------------------------------
+// Extracts one blocker and waiter from the deadlock graph.
+//==============================================================================
+bool oraDeadlock::graphLine(extractContext &ctx, const string &line)
+{
+    /*
+                           ---------Blocker(s)--------  ---------Waiter(s)---------
+    Resource Name          process session holds waits  process session holds waits
+    TX-0018001f-0025006a       985     272     X            821    1019           S
+    TX-0004000e-004a8a86       821    1019     X            779    2156           S
+    TX-00360007-001b448f       779    2156     X            985     272           S
+    */
+
+    // The resources end at a one-space line.
+    if (line == " ") {
         return false;
     }
 
+    // Each resource should have a blocker and waiter. If the numbers aren't
+    // there, it's not a graph line we understand, so note it and move on.
+    // Unless it starts another section, in which case the blank line that
+    // ends the graph is missing.
+    unsigned blockerProcess, blockerSession, waiterProcess, waiterSession;
+    if (!parseNumber(line, 23, blockerProcess, 7) || !parseNumber(line, 31, blockerSession, 7) ||
+        !parseNumber(line, 52, waiterProcess, 7) || !parseNumber(line, 60, waiterSession, 7)) {
+        if (findMarker(line, ctx.seenProcessState)) {
+            return false;
+        }
+
+        parseError("Invalid deadlock graph line at " + location());
+        return true;
+    }
+
+    oraBlockerWaiter tempBlocker(false), tempWaiter(true);
+
+    //Extract the blocking session's details.
+    string signature = line.substr(0, 2) + '-';
+
+    auto pos = line.find(" ");
+    tempBlocker.setResourceName(line.substr(0, pos));
+    tempBlocker.setProcess(blockerProcess);
+    tempBlocker.setSession(blockerSession);
+    tempBlocker.setHolds(field(line, 39, 5));
+    signature += (tempBlocker.holds().empty() ? "" : tempBlocker.holds());
+    tempBlocker.setWaits(field(line, 45, 5));
+    signature += (tempBlocker.waits().empty() ? "" : tempBlocker.waits());
+
+    //Extract the waiting session's details.
+    tempWaiter.setResourceName(tempBlocker.resourceName());
+    tempWaiter.setProcess(waiterProcess);
+    tempWaiter.setSession(waiterSession);
+    tempWaiter.setHolds(field(line, 68, 5));
+    signature += '-' + (tempWaiter.holds().empty() ? "" : tempWaiter.holds());
+    tempWaiter.setWaits(field(line, 74, 5));
+    signature += (tempWaiter.waits().empty() ? "" : tempWaiter.waits());
+
+    // Set the corresponding other session.
+    tempBlocker.setOtherSession(tempWaiter.session());
+    tempWaiter.setOtherSession(tempBlocker.session());
+
+    // Save the deadlock signature if we don't have it already. I know it's a
+    // palava scanning the vector, but it's only small.
+    if (find(mSignatures.begin(), mSignatures.end(), signature) == mSignatures.end()) {
+        mSignatures.push_back(signature);
+    }
+
+    // Save the blocker's and waiter's details. A session can only block, or
+    // wait, once. Complain, but carry on, if not.
+    auto ok = mBlockers.insert(pair<unsigned, oraBlockerWaiter>(tempBlocker.session(), tempBlocker));
+    if (!ok.second) {
+        parseError("Duplicate blocking session " + std::to_string(tempBlocker.session()) +
+                   " at " + location());
+    }
+
+    ok = mWaiters.insert(pair<unsigned, oraBlockerWaiter>(tempWaiter.session(), tempWaiter));
+    if (!ok.second) {
+        parseError("Duplicate waiting session " + std::to_string(tempWaiter.session()) +
+                   " at " + location());
+    }
+
+    // Average White Band time ... let's go round again!
+    return true;
+}
+
+//==============================================================================
+//                                                              rowsWaitedLine()
+//------------------------------------------------------------------------------
+// Extracts the rows being waited on which caused the deadlock.
+//==============================================================================
+bool oraDeadlock::rowsWaitedLine(extractContext &ctx, const string &line)
+{
     // Extract the objects waited on. I'm using a map<> as I can't guarantee
     // that the order they appear here will always match the creation order.
 
@@ -249,178 +707,228 @@ bool oraDeadlock::extractRowsWaited()
       (dictionary objn - 77854, file - 5, block - 236408788, slot - 0)
     */
 
-    while (mTraceFile->good()) {
-        string traceLine = mTraceFile->readLine();
+    // The Rows waited on end at a one-space line.
+    if (line == " ") {
+        return false;
+    }
 
-        // The Rows waited on end at a one-space line.
-        if (traceLine == " ") {
-            break;
-        }
+    //  (dictionary objn - 5004374, file - 1024, block - 243378437, slot - 0)
+    if (startsWith(line, "  (dictionary objn", 18)) {
+        oraBlockerWaiter *thisWaiter = ctx.pendingWaiter;
+        ctx.pendingWaiter = nullptr;
 
-        // Should be something like these:
-        //  Session 97: no row
-        //  Session 272: obj - rowid = 004C5C56 - AATFxWAQAAOgakFAAA
+        if (!thisWaiter) {
+            // No "Session" line for this one.
+            return true;
+        }
 
-        // Session Number of waiting session.
-        auto pos = traceLine.find(":");
-        unsigned tempNumber = stoi(traceLine.substr(9, pos -1));
+        unsigned objectId, file, block, slot;
+        auto objn = line.find("objn - ");
+        auto filePos = line.find("file - ");
+        auto blockPos = line.find("block - ");
+        auto slotPos = line.find("slot - ");
+        if (objn == string::npos || !parseNumber(line, objn + 7, objectId) ||
+            filePos == string::npos || !parseNumber(line, filePos + 7, file) ||
+            blockPos == string::npos || !parseNumber(line, blockPos + 8, block) ||
+            slotPos == string::npos || !parseNumber(line, slotPos + 7, slot)) {
+            parseError("Invalid dictionary details at " + location());
+            return true;
+        }
 
-        // Find the oraBlockerWaiter for the session.
-        auto thisWaiter = waiterBySession(tempNumber);
+        thisWaiter->setObjectId(objectId);
+        thisWaiter->setFile(file);
+        thisWaiter->setBlock(block);
+        thisWaiter->setSlot(slot);
+        return true;
+    }
 
-        //auto waiterPair = mWaiters.find(tempNumber);
-        if (!thisWaiter) {
-            // Not found, oops!
-            cerr << "Cannot find waiting session: " << tempNumber << endl;
-            return false;
-        }
+    // Should be something like these:
+    //  Session 97: no row
+    //  Session 272: obj - rowid = 004C5C56 - AATFxWAQAAOgakFAAA
+    ctx.pendingWaiter = nullptr;
 
-        // Fill in the waiter's details.
+    // Anything else is ignored, unless it starts another section because
+    // the blank line that ends these is missing.
+    if (!startsWith(line, "  Session ", 10)) {
+        return !findMarker(line, ctx.seenProcessState);
+    }
 
-        // Rowid waited on, or No Row.
-        if (traceLine.find("no row") != string::npos) {
-            // No *row* waited for.
-            thisWaiter->setRowidWait("No row waited for");
+    // Session Number of waiting session.
+    auto pos = line.find(":");
+    unsigned tempNumber;
+    if (pos == string::npos || !parseNumber(line, 9, tempNumber, pos - 9)) {
+        parseError("Invalid waiting session at " + location());
+        return true;
+    }
 
-            // There isn't a following line for this waiter, so
-            // process the next waiting session's row.
-            continue;
-        }
+    // Find the oraBlockerWaiter for the session.
+    auto thisWaiter = waiterToUpdate(tempNumber);
 
-        string tempString = traceLine.substr(traceLine.length() -18, 18);
-        thisWaiter->setRowidWait(tempString);
+    if (!thisWaiter) {
+        // Not found, oops!
+        parseError("Cannot find waiting session " + std::to_string(tempNumber) +
+                   " at " + location());
+        return true;
+    }
 
-        //  (dictionary objn - 5004374, file - 1024, block - 243378437, slot - 0)
-        traceLine = mTraceFile->readLine();
+    // Fill in the waiter's details.
 
-        pos = traceLine.find("objn - ");
-        tempNumber = stoi(traceLine.substr(pos +7));
-        thisWaiter->setObjectId(tempNumber);
+    // Rowid waited on, or No Row.
+    if (line.find("no row") != string::npos) {
+        // No *row* waited for. There isn't a following line for this waiter.
+        thisWaiter->setRowidWait("No row waited for");
+        return true;
+    }
 
-        pos = traceLine.find("file - ");
-        tempNumber = stoi(traceLine.substr(pos +7));
-        thisWaiter->setFile(tempNumber);
+    if (line.length() < 18) {
+        parseError("Invalid rowid at " + location());
+        return true;
+    }
 
-        pos = traceLine.find("block - ");
-        tempNumber = stoi(traceLine.substr(pos +8));
-        thisWaiter->setBlock(tempNumber);
+    thisWaiter->setRowidWait(line.substr(line.length() -18, 18));
 
-        pos = traceLine.find("slot - ");
-        tempNumber = stoi(traceLine.substr(pos +7));
-        thisWaiter->setSlot(tempNumber);
+    // The rowid has the file, block and slot too, in case the next line is
+    // missing, and the data object id, which the next line doesn't have.
+    oraRowid rowid;
+    if (!oraRowid::decode(thisWaiter->rowidWait(), rowid)) {
+        parseError("Invalid rowid at " + location());
+        return true;
     }
 
+    thisWaiter->setDataObjectId(rowid.dataObjectId());
+    thisWaiter->setFile(rowid.file());
+    thisWaiter->setBlock(rowid.block());
+    thisWaiter->setSlot(rowid.row());
+
+    // The next line has the object, file, block and slot.
+    ctx.pendingWaiter = thisWaiter;
     return true;
 }
 
 //==============================================================================
-//                                                           extractCurrentSQL()
+//                                                                     sqlLine()
 //------------------------------------------------------------------------------
 // Extracts the SQL statement that was aborted because of the deadlock.
 //==============================================================================
-bool oraDeadlock::extractCurrentSQL()
+bool oraDeadlock::sqlLine(extractContext &ctx, const string &line)
 {
-    // Extract the aborted SQL statement.
-    if (!mTraceFile->findAtStart("----- Current SQL Statement")) {
-        cerr << "Cannot find [----- Current SQL Statement]" << endl;
+    // SQL code ends with =====...=====
+    // PL/SQL code may end with ----- if the stack is dumped.
+    if (startsWith(line, "=====", 5) ||
+        startsWith(line, "-----", 5)) {
         return false;
     }
 
-    mTraceFile->readLine();
-    while (true) {
-        unsigned length = mTraceFile->currentLine().size();
-        if (length >= 5) {
-            string temp = mTraceFile->currentLine().substr(0, 5);
-            // SQL code ends with =====...=====
-            // PL/SQL code may end with ----- if the stack is dumped.
-            if (temp == "=====" ||
-                temp == "-----") {
-                break;
-            }
-        }
-
-        mAbortedSQL += mTraceFile->currentLine();
-        mTraceFile->readLine();
+    // If the terminator is missing, don't swallow the process state too.
+    if (findMarker(line, ctx.seenProcessState)) {
+        return false;
     }
 
+    // Just remember where it is, SQL() fetches it if needed.
+    if (mSQLEnd == 0) {
+        mSQLStart = mTraceFile->currentOffset();
+    }
+    mSQLEnd = mTraceFile->nextOffset();
     return true;
 }
 
 //==============================================================================
-//                                                         extractProcessState()
+//                                                                         SQL()
 //------------------------------------------------------------------------------
-// Extracts the process state details for a deadlock.
+// Returns the SQL statement that was aborted. The lines are read back from the
+// trace file, and joined together, as they were in the trace. Line ends are
+// dropped, whether "\n" or "\r\n".
 //==============================================================================
-bool oraDeadlock::extractProcessState()
+string oraDeadlock::SQL() const
 {
-    // Scan for the reason we are waiting, it's in the process state.
-    if (!mTraceFile->findAtStart("PROCESS STATE")) {
-        cerr << "Cannot find [PROCESS STATE]" << endl;
-        return false;
+    if (mSQLEnd <= mSQLStart || !mText) {
+        return "";
     }
 
-    // Scan to a line with the "current wait stack" in it.
-    if (!mTraceFile->findNearStart("Current Wait Stack:")) {
-        cerr << "Cannot find [Current Wait Stack:]" << endl;
+    string sql = mText->excerpt(mSQLStart, mSQLEnd);
+    sql.erase(std::remove_if(sql.begin(), sql.end(),
+                             [](char c) { return c == '\n' || c == '\r'; }),
+              sql.end());
+    return sql;
+}
+
+//==============================================================================
+//                                                             currentWaitLine()
+//------------------------------------------------------------------------------
+// The line after "Current Wait Stack:" has the reason we deadlocked this
+// session.
+//==============================================================================
+bool oraDeadlock::currentWaitLine(extractContext &, const string &)
+{
+    string traceLine = mTraceFile->trimmedLine();
+    if (traceLine.size() < 4) {
+        parseError("Invalid current wait at " + location());
         return false;
     }
 
-    // Now we have a look for the reason we deadlocked this
-    // session which is on the following line.
-    mTraceFile->readLine();
-    string traceLine = mTraceFile->trimmedLine();
-    setDeadlockWait("W" + traceLine.substr(4));
+    setDeadlockWait("W" + field(traceLine, 4));
 
-    return mTraceFile->good();
+    // That's all, this section is just the one line.
+    return false;
 }
 
-
 //==============================================================================
-//                                                            extractWaitStack()
+//                                                             waitHistoryLine()
 //------------------------------------------------------------------------------
 // Extracts the aborted session's wait stack.
 //==============================================================================
-bool oraDeadlock::extractWaitStack()
+bool oraDeadlock::waitHistoryLine(extractContext &ctx, const string &line)
 {
-    // Find it first I suppose.
-    if (!mTraceFile->findNearStart("Session Wait History:")) {
-        cerr << "Cannot find [Session Wait History:]" << endl;
+    // Done yet?
+    if (startsWith(line, "    -------", 11)) {
         return false;
     }
 
-    // Scan the file looking for wait events or the end of the stack.
-    string traceLine;
-    string thisWait;
-    while (true) {
-        traceLine = mTraceFile->readLine();
+    /*
+     0: waited for 'SQL*Net message from client'
+        driver id=0x54435000, #bytes=0x1, =0x0
+        wait_id=11 seq_num=12 snap_id=1
+        wait times: snap=1.500000 sec, exc=1.500000 sec, total=1.500000 sec
+    */
 
-        // Done yet?
-        if (traceLine.find("    -------") == 0) {
-            break;
-        }
+    // Are we waiting?
+    auto pos = line.find(": waited for '");
+    if (pos != string::npos) {
+        // Found a wait, the event is in quotes.
+        pos += 14;
+        auto pos2 = line.find('\'', pos);
+        ctx.thisWait = oraWaitEvent(oraWaitEvent::internEvent(line.substr(pos, pos2 - pos)));
+        ctx.inWait = true;
+        ctx.needParameters = true;
+        return true;
+    }
 
-        // Are we waiting?
-        auto pos = traceLine.find(": waited for");
-        if (pos != string::npos) {
-            // Found a wait.
-            thisWait = "W" + traceLine.substr(pos + 3);
-            continue;
-        }
+    if (!ctx.inWait) {
+        return true;
+    }
 
-        // Look for the total time waited.
-        pos = traceLine.find("total=");
-        if (pos == string::npos) {
-            continue;
+    // Look for the total time waited.
+    pos = line.find("total=");
+    if (pos != string::npos) {
+        // We have the time waited. That's this wait done.
+        if (!ctx.thisWait.setDuration(line.substr(pos + 6))) {
+            parseError("Invalid wait time at " + location());
         }
 
-        // We have the time waited.
-        thisWait += " for " + traceLine.substr(pos + 6) + "(s)";
-        mWaitStack.push_back(thisWait);
-
+        mWaitStack.push_back(ctx.thisWait);
+        ctx.inWait = false;
+        return true;
     }
 
-    return mTraceFile->good();
+    // The line after the event name has the parameters.
+    if (ctx.needParameters) {
+        unsigned long long params[3] = {0, 0, 0};
+        oraWaitEvent::parseParameters(line, params);
+        ctx.thisWait.setParameters(params[0], params[1], params[2]);
+        ctx.needParameters = false;
+    }
 
+    return true;
 }
 
 //==============================================================================
@@ -428,17 +936,17 @@ bool oraDeadlock::extractWaitStack()
 //------------------------------------------------------------------------------
 // Returns a pointer to the list of signatures for this deadlock.
 //==============================================================================
-vector<string> *oraDeadlock::signatures()
+const vector<string> *oraDeadlock::signatures() const
 {
     return &mSignatures;
 }
 
 //==============================================================================
-//                                                                  signatures()
+//                                                                   waitStack()
 //------------------------------------------------------------------------------
-// Returns a pointer to the list of signatures for this deadlock.
+// Returns a pointer to the wait stack for this deadlock.
 //==============================================================================
-vector<string> *oraDeadlock::waitStack()
+const vector<oraWaitEvent> *oraDeadlock::waitStack() const
 {
     return &mWaitStack;
 }
@@ -469,7 +977,7 @@ vector<string> *oraDeadlock::waitStack()
 //------------------------------------------------------------------------------
 // Returns a pointer to a blocking session.
 //==============================================================================
-oraBlockerWaiter *oraDeadlock::blockerBySession(const unsigned session)
+const oraBlockerWaiter *oraDeadlock::blockerBySession(const unsigned session) const
 {
     auto b = mBlockers.find(session);
     if (b != mBlockers.end()) {
@@ -485,7 +993,23 @@ oraBlockerWaiter *oraDeadlock::blockerBySession(const unsigned session)
 //------------------------------------------------------------------------------
 // Returns a pointer to a waiting session.
 //==============================================================================
-oraBlockerWaiter *oraDeadlock::waiterBySession(const unsigned session)
+const oraBlockerWaiter *oraDeadlock::waiterBySession(const unsigned session) const
+{
+    auto w = mWaiters.find(session);
+    if (w != mWaiters.end()) {
+        return &(w->second);
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+//                                                              waiterToUpdate()
+//------------------------------------------------------------------------------
+// Returns a pointer to a waiting session, that we can fill in, while we are
+// extracting.
+//==============================================================================
+oraBlockerWaiter *oraDeadlock::waiterToUpdate(const unsigned session)
 {
     auto w = mWaiters.find(session);
     if (w != mWaiters.end()) {
@@ -502,7 +1026,7 @@ oraBlockerWaiter *oraDeadlock::waiterBySession(const unsigned session)
 // which it seems is not specifically allowed without a key. B*gg*r! Have to be
 // sneaky now.
 //==============================================================================
-oraBlockerWaiter *oraDeadlock::blockerByIndex(const unsigned index)
+const oraBlockerWaiter *oraDeadlock::blockerByIndex(const unsigned index) const
 {
     if (index >= mBlockers.size()) {
         return nullptr;
@@ -517,7 +1041,7 @@ oraBlockerWaiter *oraDeadlock::blockerByIndex(const unsigned index)
         currentIndex++;
     }
 
-    return &(mBlockers[index]);
+    return nullptr;
 }
 
 
@@ -526,9 +1050,9 @@ oraBlockerWaiter *oraDeadlock::blockerByIndex(const unsigned index)
 //------------------------------------------------------------------------------
 // Returns a pointer to a waiting session.
 //==============================================================================
-oraBlockerWaiter *oraDeadlock::waiterByIndex(const unsigned index)
+const oraBlockerWaiter *oraDeadlock::waiterByIndex(const unsigned index) const
 {
-    if (index > mWaiters.size()) {
+    if (index >= mWaiters.size()) {
         return nullptr;
     }
 
@@ -541,7 +1065,7 @@ oraBlockerWaiter *oraDeadlock::waiterByIndex(const unsigned index)
         currentIndex++;
     }
 
-    return &(mWaiters[index]);
+    return nullptr;
 }
 
 //==============================================================================
@@ -550,7 +1074,7 @@ oraBlockerWaiter *oraDeadlock::waiterByIndex(const unsigned index)
 // The following boolean functions return true if any of the deadlock signatures
 // match that requested.
 //==============================================================================
-bool oraDeadlock::sigType(const string what) {
+bool oraDeadlock::sigType(const string what) const {
     for (auto i = mSignatures.begin(); i != mSignatures.end(); i++) {
         if ((*i).substr(0, what.size()) == what) {
             return true;
@@ -560,22 +1084,22 @@ bool oraDeadlock::sigType(const string what) {
     return false;
 }
 
-bool oraDeadlock::txxx()    // Application error? Self Deadlock?
+bool oraDeadlock::txxx() const    // Application error? Self Deadlock?
 {
     return sigType("TX-X-X");
 }
 
-bool oraDeadlock::txxs()    // Bitmap Index? ITL? PK/UK inconsistency?
+bool oraDeadlock::txxs() const    // Bitmap Index? ITL? PK/UK inconsistency?
 {
     return sigType("TX-X-S");
 }
 
-bool oraDeadlock::ul()      // User defined lock;
+bool oraDeadlock::ul() const      // User defined lock;
 {
     return sigType("UL");
 }
 
-bool oraDeadlock::tm()      // Missing FK index?
+bool oraDeadlock::tm() const      // Missing FK index?
 {
     return sigType("TM-SX-SSX-SX-SSX");
 }
@@ -588,7 +1112,7 @@ bool oraDeadlock::tm()      // Missing FK index?
 // because of the deadlock. This is the first session in the waiters part of the
 // deadlock graph.
 //==============================================================================
-unsigned oraDeadlock::abortedSession()
+unsigned oraDeadlock::abortedSession() const
 {
     if (rows() > 0) {
         return waiterByIndex(0)->session();
@@ -597,6 +1121,186 @@ unsigned oraDeadlock::abortedSession()
     return 0;
 }
 
+//==============================================================================
+//                                                                      toJSON()
+//------------------------------------------------------------------------------
+// Writes this deadlock out as a JSON object. Each line is prefixed by indent.
+//==============================================================================
+void oraDeadlock::toJSON(ostream &out, const string &indent) const
+{
+    out << indent << "{\n"
+        << indent << "  \"line\": " << mLineNumber << ",\n"
+        << indent << "  \"startOffset\": " << mStartOffset << ",\n"
+        << indent << "  \"endOffset\": " << mEndOffset << ",\n"
+        << indent << "  \"date\": " << jsonString(mDate) << ",\n"
+        << indent << "  \"time\": " << jsonString(mTime) << ",\n"
+        << indent << "  \"global\": " << (mGlobal ? "true" : "false") << ",\n"
+        << indent << "  \"parseErrors\": [";
+
+    for (auto e = mParseErrors.begin(); e != mParseErrors.end(); e++) {
+        out << (e == mParseErrors.begin() ? "" : ", ") << jsonString(*e);
+    }
+    out << "],\n";
+
+    // Global deadlocks are just a list of locks.
+    if (mGlobal) {
+        out << indent << "  \"locks\": [";
+        for (auto l = mGlobalLocks.begin(); l != mGlobalLocks.end(); l++) {
+            out << (l == mGlobalLocks.begin() ? "\n" : ",\n")
+                << indent << "    { \"blocker\": " << (l->blocker ? "true" : "false")
+                << ", \"lock\": " << jsonString(l->lockAddress)
+                << ", \"mode\": " << l->mode
+                << ", \"resource\": " << jsonString(l->resource)
+                << ", \"transaction\": " << jsonString(l->transaction)
+                << ", \"instance\": " << l->instance
+                << ", \"session\": " << l->session << " }";
+        }
+        out << '\n' << indent << "  ]\n"
+            << indent << "}";
+        return;
+    }
+
+    out << indent << "  \"signatures\": [";
+    for (auto s = mSignatures.begin(); s != mSignatures.end(); s++) {
+        out << (s == mSignatures.begin() ? "" : ", ") << jsonString(*s);
+    }
+
+    out << "],\n"
+        << indent << "  \"abortedSession\": " << abortedSession() << ",\n"
+        << indent << "  \"wait\": " << jsonString(mDeadlockWait) << ",\n"
+        << indent << "  \"sql\": " << jsonString(SQL()) << ",\n"
+        << indent << "  \"graph\": [";
+
+    // One entry per resource, blocker and waiter.
+    for (auto b = mBlockers.begin(); b != mBlockers.end(); b++) {
+        const oraBlockerWaiter *blocker = &(b->second);
+        const oraBlockerWaiter *waiter = waiterBySession(blocker->otherSession());
+
+        out << (b == mBlockers.begin() ? "\n" : ",\n")
+            << indent << "    { \"resource\": " << jsonString(blocker->resourceName())
+            << ", \"blocker\": { \"process\": " << blocker->process()
+            << ", \"session\": " << blocker->session()
+            << ", \"holds\": " << jsonString(blocker->holds())
+            << ", \"waits\": " << jsonString(blocker->waits()) << " }";
+
+        if (waiter) {
+            out << ", \"waiter\": { \"process\": " << waiter->process()
+                << ", \"session\": " << waiter->session()
+                << ", \"holds\": " << jsonString(waiter->holds())
+                << ", \"waits\": " << jsonString(waiter->waits())
+                << ", \"objectId\": " << waiter->objectId()
+                << ", \"dataObjectId\": " << waiter->dataObjectId()
+                << ", \"file\": " << waiter->file()
+                << ", \"block\": " << waiter->block()
+                << ", \"slot\": " << waiter->slot()
+                << ", \"rowid\": " << jsonString(waiter->rowidWait()) << " }";
+        }
+
+        out << " }";
+    }
+
+    out << '\n' << indent << "  ],\n"
+        << indent << "  \"waitStack\": [";
+
+    for (auto w = mWaitStack.begin(); w != mWaitStack.end(); w++) {
+        out << (w == mWaitStack.begin() ? "\n" : ",\n")
+            << indent << "    { \"event\": " << jsonString(w->eventName())
+            << ", \"micros\": " << w->micros()
+            << ", \"p1\": " << w->p1()
+            << ", \"p2\": " << w->p2()
+            << ", \"p3\": " << w->p3() << " }";
+    }
+
+    out << '\n' << indent << "  ]\n"
+        << indent << "}";
+}
+
+//==============================================================================
+//                                                                   csvString()
+//------------------------------------------------------------------------------
+// Quotes a string for CSV, if it needs it.
+//==============================================================================
+static string csvString(const string &s)
+{
+    if (s.find_first_of(",\"\r\n") == string::npos) {
+        return s;
+    }
+
+    string result = "\"";
+    for (auto c = s.begin(); c != s.end(); c++) {
+        if (*c == '"') {
+            result += '"';
+        }
+        result += *c;
+    }
+
+    return result + '"';
+}
+
+//==============================================================================
+//                                                                   csvHeader()
+//------------------------------------------------------------------------------
+// Writes the heading line for toCSV().
+//==============================================================================
+void oraDeadlock::csvHeader(ostream &out)
+{
+    out << "deadlock,line,date,time,signature,abortedSession,resource,"
+           "blockerProcess,blockerSession,blockerHolds,blockerWaits,"
+           "waiterProcess,waiterSession,waiterHolds,waiterWaits,"
+           "objectId,file,block,slot,rowid,wait\n";
+}
+
+//==============================================================================
+//                                                                       toCSV()
+//------------------------------------------------------------------------------
+// Writes this deadlock out as CSV, one line per deadlock graph row, numbered
+// as in the report. Global deadlocks have a line per lock, with the session
+// as the blocker, or the waiter, as appropriate.
+//==============================================================================
+void oraDeadlock::toCSV(ostream &out, const unsigned number) const
+{
+    string common = std::to_string(number) + ',' + std::to_string(mLineNumber) + ',' +
+                    mDate + ',' + mTime + ',';
+
+    if (mGlobal) {
+        for (auto l = mGlobalLocks.begin(); l != mGlobalLocks.end(); l++) {
+            string session = std::to_string(l->session);
+            out << common << "GLOBAL,0," << csvString(l->resource) << ','
+                << (l->blocker ? ',' + session + string(12, ',') :
+                                 ",,,,," + session + string(8, ','))
+                << '\n';
+        }
+        return;
+    }
+
+    string signature;
+    for (auto s = mSignatures.begin(); s != mSignatures.end(); s++) {
+        signature += (s == mSignatures.begin() ? "" : " ") + *s;
+    }
+    common += csvString(signature) + ',' + std::to_string(abortedSession()) + ',';
+
+    for (auto b = mBlockers.begin(); b != mBlockers.end(); b++) {
+        const oraBlockerWaiter *blocker = &(b->second);
+        const oraBlockerWaiter *waiter = waiterBySession(blocker->otherSession());
+
+        out << common << csvString(blocker->resourceName()) << ','
+            << blocker->process() << ',' << blocker->session() << ','
+            << csvString(blocker->holds()) << ',' << csvString(blocker->waits()) << ',';
+
+        if (waiter) {
+            out << waiter->process() << ',' << waiter->session() << ','
+                << csvString(waiter->holds()) << ',' << csvString(waiter->waits()) << ','
+                << waiter->objectId() << ',' << waiter->file() << ','
+                << waiter->block() << ',' << waiter->slot() << ','
+                << csvString(waiter->rowidWait()) << ',';
+        } else {
+            out << ",,,,,,,,,";
+        }
+
+        out << csvString(mDeadlockWait) << '\n';
+    }
+}
+
 //==============================================================================
 //                                                                   Operator <<
 //------------------------------------------------------------------------------
@@ -0,0 +1,393 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraDeadlockAPI.h"
+#include "oraTraceFile.h"
+
+#include <deque>
+#include <exception>
+#include <memory>
+
+#ifdef _WIN32
+#include <io.h>
+#define readFd _read
+#else
+#include <unistd.h>
+#define readFd read
+#endif
+
+using std::deque;
+
+//==============================================================================
+// What's behind a dlaTrace handle. The strings handed out point into
+// mStrings, which is emptied at the start of each call.
+//==============================================================================
+struct dlaTrace {
+    string buffer;
+    oraTraceFile *traceFile = nullptr;
+    unsigned next = 0;
+    bool parsed = false;
+    string error;
+    deque<string> strings;
+
+    const char *keep(const string &s) {
+        strings.push_back(s);
+        return strings.back().c_str();
+    }
+};
+
+//==============================================================================
+//                                                                     newTrace()
+//------------------------------------------------------------------------------
+// Finishes off opening a trace file, and takes ownership of the handle. The
+// trace file reader stays quiet, we are somebody else's library now.
+//==============================================================================
+static dlaTrace *newTrace(std::unique_ptr<dlaTrace> trace)
+{
+    if (!trace->traceFile->good()) {
+        delete trace->traceFile;
+        return nullptr;
+    }
+
+    trace->traceFile->setVerbose(false);
+    return trace.release();
+}
+
+//==============================================================================
+//                                                                dlaAbiVersion()
+//==============================================================================
+int dlaAbiVersion(void)
+{
+    return DLA_ABI_VERSION;
+}
+
+//==============================================================================
+//                                                                  dlaOpenFile()
+//==============================================================================
+dlaTrace *dlaOpenFile(const char *path)
+{
+    if (!path) {
+        return nullptr;
+    }
+
+    try {
+        std::unique_ptr<dlaTrace> trace(new dlaTrace);
+        trace->traceFile = new oraTraceFile(path);
+        return newTrace(std::move(trace));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+//==============================================================================
+//                                                                dlaOpenBuffer()
+//------------------------------------------------------------------------------
+// The buffer is copied, the caller's memory might be moved, or freed, by its
+// garbage collector.
+//==============================================================================
+dlaTrace *dlaOpenBuffer(const char *name, const char *data, size_t length)
+{
+    if (!data && length) {
+        return nullptr;
+    }
+
+    try {
+        std::unique_ptr<dlaTrace> trace(new dlaTrace);
+        trace->buffer.assign(data ? data : "", length);
+        trace->traceFile = new oraTraceFile(name ? name : "", trace->buffer.data(), trace->buffer.size());
+        return newTrace(std::move(trace));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+//==============================================================================
+//                                                                    dlaOpenFd()
+//------------------------------------------------------------------------------
+// Reads everything from a file descriptor, which might be a pipe, then parses
+// it from memory.
+//==============================================================================
+dlaTrace *dlaOpenFd(const char *name, int fd)
+{
+    try {
+        std::unique_ptr<dlaTrace> trace(new dlaTrace);
+        char chunk[64 * 1024];
+
+        while (true) {
+            auto got = readFd(fd, chunk, sizeof(chunk));
+            if (got < 0) {
+                return nullptr;
+            }
+
+            if (got == 0) {
+                break;
+            }
+
+            trace->buffer.append(chunk, got);
+        }
+
+        trace->traceFile = new oraTraceFile(name ? name : "", trace->buffer.data(), trace->buffer.size());
+        return newTrace(std::move(trace));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+//==============================================================================
+//                                                           dlaSetGlobalGraphs()
+//==============================================================================
+void dlaSetGlobalGraphs(dlaTrace *trace, int enable)
+{
+    if (trace) {
+        trace->traceFile->setGlobalGraphs(enable != 0);
+    }
+}
+
+//==============================================================================
+//                                                                     dlaParse()
+//------------------------------------------------------------------------------
+// No exceptions can be allowed back across the C interface.
+//==============================================================================
+int dlaParse(dlaTrace *trace)
+{
+    if (!trace) {
+        return -1;
+    }
+
+    if (trace->parsed) {
+        return trace->traceFile->deadlockCount();
+    }
+
+    try {
+        trace->traceFile->parse();
+        trace->parsed = true;
+        trace->traceFile->stats()->stop();
+        return trace->traceFile->deadlockCount();
+    } catch (std::exception &e) {
+        trace->error = e.what();
+    } catch (...) {
+        trace->error = "Unknown error";
+    }
+
+    return -1;
+}
+
+//==============================================================================
+//                                                                      dlaInfo()
+//==============================================================================
+int dlaInfo(dlaTrace *trace, dlaTraceInfo *info)
+{
+    if (!trace || !info) {
+        return 0;
+    }
+
+    oraTraceFile *tf = trace->traceFile;
+    trace->strings.clear();
+    info->traceName = trace->keep(tf->traceName());
+    info->originalPath = trace->keep(tf->originalPath());
+    info->instanceName = trace->keep(tf->instanceName());
+    info->systemName = trace->keep(tf->systemName());
+    info->serverName = trace->keep(tf->serverName());
+    info->oracleHome = trace->keep(tf->oracleHome());
+    info->deadlockCount = tf->deadlockCount();
+    info->lines = tf->stats()->lines();
+    info->bytesRead = tf->stats()->bytesRead();
+    return 1;
+}
+
+//==============================================================================
+//                                                                dlaDeadlockAt()
+//------------------------------------------------------------------------------
+// Anything that couldn't be parsed in this deadlock is left for dlaError().
+//==============================================================================
+int dlaDeadlockAt(dlaTrace *trace, unsigned index, dlaDeadlock *deadlock)
+{
+    if (!trace || !deadlock || !trace->parsed) {
+        return 0;
+    }
+
+    oraDeadlock *dl = trace->traceFile->deadLock(index);
+    if (!dl) {
+        return 0;
+    }
+
+    string signature;
+    const vector<string> *signatures = dl->signatures();
+    for (auto s = signatures->begin(); s != signatures->end(); s++) {
+        signature += (signature.empty() ? "" : ",") + *s;
+    }
+
+    if (!dl->parseErrors()->empty()) {
+        trace->error = dl->parseErrors()->back();
+    }
+
+    trace->strings.clear();
+    deadlock->index = index;
+    deadlock->lineNumber = dl->lineNumber();
+    deadlock->startOffset = dl->startOffset();
+    deadlock->endOffset = dl->endOffset();
+    deadlock->epoch = dl->epoch();
+    deadlock->date = trace->keep(dl->date());
+    deadlock->time = trace->keep(dl->time());
+    deadlock->signature = trace->keep(signature);
+    deadlock->abortedSession = dl->abortedSession();
+    deadlock->deadlockWait = trace->keep(dl->deadlockWait());
+    deadlock->sql = trace->keep(dl->SQL());
+    deadlock->rows = dl->rows();
+    deadlock->waits = dl->waitStack()->size();
+    deadlock->globalLocks = dl->globalLocks()->size();
+    deadlock->global = dl->global() ? 1 : 0;
+    return 1;
+}
+
+//==============================================================================
+//                                                                      dlaNext()
+//==============================================================================
+int dlaNext(dlaTrace *trace, dlaDeadlock *deadlock)
+{
+    if (!trace || !dlaDeadlockAt(trace, trace->next, deadlock)) {
+        return 0;
+    }
+
+    trace->next++;
+    return 1;
+}
+
+//==============================================================================
+//                                                                    dlaRewind()
+//==============================================================================
+void dlaRewind(dlaTrace *trace)
+{
+    if (trace) {
+        trace->next = 0;
+    }
+}
+
+//==============================================================================
+//                                                                dlaGraphRowAt()
+//==============================================================================
+int dlaGraphRowAt(dlaTrace *trace, unsigned index, unsigned row, dlaGraphRow *graphRow)
+{
+    if (!trace || !graphRow || !trace->parsed) {
+        return 0;
+    }
+
+    oraDeadlock *dl = trace->traceFile->deadLock(index);
+    const oraBlockerWaiter *blocker = dl ? dl->blockerByIndex(row) : nullptr;
+    if (!blocker) {
+        return 0;
+    }
+
+    const oraBlockerWaiter *waiter = dl->waiterBySession(blocker->otherSession());
+    oraBlockerWaiter noWaiter(true);
+    if (!waiter) {
+        waiter = &noWaiter;
+    }
+
+    trace->strings.clear();
+    graphRow->resourceName = trace->keep(blocker->resourceName());
+    graphRow->blockerProcess = blocker->process();
+    graphRow->blockerSession = blocker->session();
+    graphRow->blockerHolds = trace->keep(blocker->holds());
+    graphRow->blockerWaits = trace->keep(blocker->waits());
+    graphRow->waiterProcess = waiter->process();
+    graphRow->waiterSession = waiter->session();
+    graphRow->waiterHolds = trace->keep(waiter->holds());
+    graphRow->waiterWaits = trace->keep(waiter->waits());
+    graphRow->objectId = waiter->objectId();
+    graphRow->file = waiter->file();
+    graphRow->block = waiter->block();
+    graphRow->slot = waiter->slot();
+    graphRow->rowid = trace->keep(waiter->rowidWait());
+    return 1;
+}
+
+//==============================================================================
+//                                                                    dlaWaitAt()
+//==============================================================================
+int dlaWaitAt(dlaTrace *trace, unsigned index, unsigned wait, dlaWait *waitEntry)
+{
+    if (!trace || !waitEntry || !trace->parsed) {
+        return 0;
+    }
+
+    oraDeadlock *dl = trace->traceFile->deadLock(index);
+    if (!dl || wait >= dl->waitStack()->size()) {
+        return 0;
+    }
+
+    const oraWaitEvent &we = dl->waitStack()->at(wait);
+    trace->strings.clear();
+    waitEntry->event = trace->keep(we.eventName());
+    waitEntry->micros = we.micros();
+    waitEntry->p1 = we.p1();
+    waitEntry->p2 = we.p2();
+    waitEntry->p3 = we.p3();
+    return 1;
+}
+
+//==============================================================================
+//                                                              dlaGlobalLockAt()
+//==============================================================================
+int dlaGlobalLockAt(dlaTrace *trace, unsigned index, unsigned lock, dlaGlobalLock *globalLock)
+{
+    if (!trace || !globalLock || !trace->parsed) {
+        return 0;
+    }
+
+    oraDeadlock *dl = trace->traceFile->deadLock(index);
+    if (!dl || lock >= dl->globalLocks()->size()) {
+        return 0;
+    }
+
+    const oraGlobalLock &gl = dl->globalLocks()->at(lock);
+    trace->strings.clear();
+    globalLock->blocker = gl.blocker ? 1 : 0;
+    globalLock->lockAddress = trace->keep(gl.lockAddress);
+    globalLock->mode = gl.mode;
+    globalLock->resource = trace->keep(gl.resource);
+    globalLock->transaction = trace->keep(gl.transaction);
+    globalLock->instance = gl.instance;
+    globalLock->session = gl.session;
+    return 1;
+}
+
+//==============================================================================
+//                                                                     dlaError()
+//==============================================================================
+const char *dlaError(dlaTrace *trace)
+{
+    return trace ? trace->error.c_str() : "No trace";
+}
+
+//==============================================================================
+//                                                                     dlaClose()
+//==============================================================================
+void dlaClose(dlaTrace *trace)
+{
+    if (trace) {
+        delete trace->traceFile;
+        delete trace;
+    }
+}
@@ -0,0 +1,727 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraDeadlockIndex.h"
+#include "oraFilter.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <cstring>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define INDEX_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::cerr;
+using std::endl;
+
+namespace fs = std::filesystem;
+
+//==============================================================================
+// One segment file, opened for reading. Mapped, or read into memory where it
+// can't be, and checked before anything in it is believed.
+//==============================================================================
+class oraDeadlockIndex::segment
+{
+    public:
+        segment() : mData(nullptr), mLength(0), mMapped(false) {}
+        ~segment() { close(); }
+        bool open(const string &fileName);
+        void close();
+
+        uint32_t recordCount() const { return mHeader->recordCount; }
+        const record &at(const uint32_t r) const { return mRecords[r]; }
+        const char *text(const uint32_t offset) const {
+            return offset < mHeader->stringsLength ? mStrings + offset : "";
+        }
+        void lookup(const uint32_t type, const uint64_t key, vector<uint32_t> &records) const;
+        entry read(const uint32_t r) const;
+        vector<entry> readAll() const;
+
+    private:
+        const char *mData;
+        size_t mLength;
+        bool mMapped;
+        vector<char> mCopy;
+
+        const header *mHeader;
+        const record *mRecords;
+        const posting *mPostings;
+        const char *mStrings;
+};
+
+//==============================================================================
+//                                                               segment::open()
+//------------------------------------------------------------------------------
+// Maps a segment file, and checks that it is one, and all there.
+//==============================================================================
+bool oraDeadlockIndex::segment::open(const string &fileName)
+{
+    close();
+
+#ifdef INDEX_MMAP
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) {
+                mData = static_cast<const char *>(mapped);
+                mLength = st.st_size;
+                mMapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if (!mData) {
+        std::ifstream in(fileName, std::ios::binary | std::ios::ate);
+        if (in.good()) {
+            mCopy.resize(in.tellg());
+            in.seekg(0);
+            in.read(mCopy.data(), mCopy.size());
+            if (in.good()) {
+                mData = mCopy.data();
+                mLength = mCopy.size();
+            }
+        }
+    }
+
+    mHeader = reinterpret_cast<const header *>(mData);
+    if (!mData || mLength < sizeof(header) ||
+        std::memcmp(mHeader->magic, DEADLOCK_INDEX_MAGIC, sizeof(mHeader->magic)) != 0 ||
+        mHeader->stringsLength == 0 ||
+        mLength != sizeof(header) + uint64_t(mHeader->recordCount) * sizeof(record) +
+                   uint64_t(mHeader->postingCount) * sizeof(posting) + mHeader->stringsLength ||
+        mData[mLength - 1] != '\0') {
+        cerr << fileName << " is not a valid deadlock index segment." << endl;
+        close();
+        return false;
+    }
+
+    mRecords = reinterpret_cast<const record *>(mData + sizeof(header));
+    mPostings = reinterpret_cast<const posting *>(mRecords + mHeader->recordCount);
+    mStrings = reinterpret_cast<const char *>(mPostings + mHeader->postingCount);
+    return true;
+}
+
+//==============================================================================
+//                                                              segment::close()
+//==============================================================================
+void oraDeadlockIndex::segment::close()
+{
+#ifdef INDEX_MMAP
+    if (mMapped) {
+        munmap(const_cast<char *>(mData), mLength);
+    }
+#endif
+
+    mCopy.clear();
+    mData = nullptr;
+    mLength = 0;
+    mMapped = false;
+}
+
+//==============================================================================
+//                                                             segment::lookup()
+//------------------------------------------------------------------------------
+// Appends the records with this key to records. They come out in order.
+//==============================================================================
+void oraDeadlockIndex::segment::lookup(const uint32_t type, const uint64_t key,
+                                       vector<uint32_t> &records) const
+{
+    const posting *end = mPostings + mHeader->postingCount;
+    auto range = std::equal_range(mPostings, end, posting{type, 0, key},
+        [](const posting &a, const posting &b) {
+            return a.type != b.type ? a.type < b.type : a.key < b.key;
+        });
+
+    for (const posting *p = range.first; p != range.second; p++) {
+        if (p->record < mHeader->recordCount) {
+            records.push_back(p->record);
+        }
+    }
+}
+
+//==============================================================================
+//                                                               segment::read()
+//------------------------------------------------------------------------------
+// Returns a record, without its keys.
+//==============================================================================
+oraDeadlockIndex::entry oraDeadlockIndex::segment::read(const uint32_t r) const
+{
+    const record &rec = mRecords[r];
+    entry e;
+    e.epoch = rec.epoch;
+    e.sqlHash = rec.sqlHash;
+    e.startOffset = rec.startOffset;
+    e.lineNumber = rec.lineNumber;
+    e.abortedSession = rec.abortedSession;
+    e.traceName = text(rec.traceName);
+    e.instance = text(rec.instance);
+    e.signatures = text(rec.signatures);
+    e.global = rec.global != 0;
+    return e;
+}
+
+//==============================================================================
+//                                                            segment::readAll()
+//------------------------------------------------------------------------------
+// Returns every record, with its keys, for merging into another segment.
+//==============================================================================
+vector<oraDeadlockIndex::entry> oraDeadlockIndex::segment::readAll() const
+{
+    vector<entry> entries;
+    entries.reserve(mHeader->recordCount);
+    for (uint32_t r = 0; r < mHeader->recordCount; r++) {
+        entries.push_back(read(r));
+    }
+
+    for (uint32_t p = 0; p < mHeader->postingCount; p++) {
+        if (mPostings[p].record < entries.size()) {
+            entries[mPostings[p].record].keys.push_back(
+                std::make_pair(mPostings[p].type, mPostings[p].key));
+        }
+    }
+
+    return entries;
+}
+
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraDeadlockIndex::oraDeadlockIndex(const string &directory) :
+    mDirectory(directory)
+{
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraDeadlockIndex::~oraDeadlockIndex()
+{
+    mPending.clear();
+}
+
+//==============================================================================
+//                                                                        hash()
+//------------------------------------------------------------------------------
+// 64 bit FNV-1a. Quick, and good enough for the number of different strings
+// we'll ever see. Matches are checked anyway.
+//==============================================================================
+uint64_t oraDeadlockIndex::hash(const string &text)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (auto c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+//==============================================================================
+//                                                                     sqlHash()
+//------------------------------------------------------------------------------
+// Hashes a SQL statement, with each run of white space squashed to a single
+// space and none at either end, so the same statement, however it was laid
+// out, hashes the same. Zero for no SQL at all.
+//==============================================================================
+uint64_t oraDeadlockIndex::sqlHash(const string &sql)
+{
+    string squashed;
+    squashed.reserve(sql.size());
+    bool space = false;
+    for (auto c : sql) {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            space = !squashed.empty();
+            continue;
+        }
+
+        if (space) {
+            squashed += ' ';
+            space = false;
+        }
+        squashed += c;
+    }
+
+    return squashed.empty() ? 0 : hash(squashed);
+}
+
+//==============================================================================
+//                                                                     monthOf()
+//------------------------------------------------------------------------------
+// The segment a deadlock belongs in, YYYYMM. Those with no time go in 000000.
+//==============================================================================
+string oraDeadlockIndex::monthOf(const long long epoch)
+{
+    if (!epoch) {
+        return "000000";
+    }
+
+    string when = oraFilter::formatTimestamp(epoch);
+    return when.substr(0, 4) + when.substr(5, 2);
+}
+
+//==============================================================================
+//                                                                         add()
+//------------------------------------------------------------------------------
+// Adds every deadlock in a parse result to the next segments to be saved.
+//==============================================================================
+void oraDeadlockIndex::add(const oraParseResult &result)
+{
+    std::error_code ec;
+    string traceName = fs::absolute(result.traceName(), ec).string();
+    if (ec) {
+        traceName = result.traceName();
+    }
+
+    for (unsigned x = 0; x < result.deadlockCount(); x++) {
+        const oraDeadlock *dl = result.deadLock(x);
+
+        entry e;
+        e.epoch = dl->epoch();
+        e.sqlHash = dl->global() ? 0 : sqlHash(dl->SQL());
+        e.startOffset = dl->startOffset();
+        e.lineNumber = dl->lineNumber();
+        e.abortedSession = dl->global() ? 0 : dl->abortedSession();
+        e.traceName = traceName;
+        e.instance = result.instanceName();
+        e.global = dl->global();
+
+        // Whole signatures, and the first one and two parts of them.
+        const vector<string> *signatures = dl->signatures();
+        for (auto s = signatures->begin(); s != signatures->end(); s++) {
+            e.signatures += (e.signatures.empty() ? "" : " ") + *s;
+            for (auto dash = s->find('-'); dash != string::npos; dash = s->find('-', dash + 1)) {
+                e.keys.push_back(std::make_pair(keySignature, hash(s->substr(0, dash))));
+            }
+            e.keys.push_back(std::make_pair(keySignature, hash(*s)));
+        }
+
+        // Everyone involved, and what they were waiting for.
+        if (dl->global()) {
+            const vector<oraGlobalLock> *locks = dl->globalLocks();
+            for (auto l = locks->begin(); l != locks->end(); l++) {
+                if (l->session) {
+                    e.keys.push_back(std::make_pair(keySession, l->session));
+                }
+            }
+        } else {
+            for (unsigned r = 0; r < dl->rows(); r++) {
+                const oraBlockerWaiter *blocker = dl->blockerByIndex(r);
+                const oraBlockerWaiter *waiter = dl->waiterByIndex(r);
+                if (blocker) {
+                    e.keys.push_back(std::make_pair(keySession, blocker->session()));
+                }
+                if (waiter) {
+                    e.keys.push_back(std::make_pair(keySession, waiter->session()));
+                    if (waiter->objectId()) {
+                        e.keys.push_back(std::make_pair(keyObject, waiter->objectId()));
+                    }
+                }
+            }
+        }
+
+        if (!e.instance.empty()) {
+            e.keys.push_back(std::make_pair(keyInstance, hash(e.instance)));
+        }
+
+        if (e.sqlHash) {
+            e.keys.push_back(std::make_pair(keySQL, e.sqlHash));
+        }
+
+        std::sort(e.keys.begin(), e.keys.end());
+        e.keys.erase(std::unique(e.keys.begin(), e.keys.end()), e.keys.end());
+        mPending[monthOf(e.epoch)].push_back(std::move(e));
+    }
+}
+
+//==============================================================================
+//                                                                    segments()
+//------------------------------------------------------------------------------
+// Lists the segment files for a month, or all months if month is empty, with
+// their sequence numbers, in month and sequence order.
+//==============================================================================
+vector<std::pair<string, unsigned>> oraDeadlockIndex::segments(const string &month)
+{
+    vector<std::pair<string, unsigned>> result;
+    std::error_code ec;
+
+    for (fs::directory_iterator d(mDirectory, ec), end; !ec && d != end; d.increment(ec)) {
+        // YYYYMM-N.dlx
+        string name = d->path().filename().string();
+        if (name.size() < 12 || name[6] != '-' || name.compare(name.size() - 4, 4, ".dlx") != 0 ||
+            (!month.empty() && name.compare(0, 6, month) != 0)) {
+            continue;
+        }
+
+        string sequence = name.substr(7, name.size() - 11);
+        if (sequence.empty() || sequence.find_first_not_of("0123456789") != string::npos) {
+            continue;
+        }
+
+        result.push_back(std::make_pair(d->path().string(), std::stoul(sequence)));
+    }
+
+    std::sort(result.begin(), result.end(),
+        [](const std::pair<string, unsigned> &a, const std::pair<string, unsigned> &b) {
+            string am = fs::path(a.first).filename().string().substr(0, 6);
+            string bm = fs::path(b.first).filename().string().substr(0, 6);
+            return am != bm ? am < bm : a.second < b.second;
+        });
+
+    return result;
+}
+
+//==============================================================================
+//                                                                writeSegment()
+//------------------------------------------------------------------------------
+// Writes a new segment file, under a temporary name until it is complete, so
+// nobody ever sees half of one.
+//==============================================================================
+bool oraDeadlockIndex::writeSegment(const string &fileName, const vector<entry> &entries)
+{
+    // String zero is the empty string.
+    string strings(1, '\0');
+    std::unordered_map<string, uint32_t> offsets;
+    offsets[""] = 0;
+    auto stringOffset = [&strings, &offsets](const string &s) {
+        auto found = offsets.find(s);
+        if (found != offsets.end()) {
+            return found->second;
+        }
+
+        uint32_t offset = strings.size();
+        strings.append(s.c_str(), s.size() + 1);
+        offsets[s] = offset;
+        return offset;
+    };
+
+    vector<record> records;
+    vector<posting> postings;
+    records.reserve(entries.size());
+
+    for (auto e = entries.begin(); e != entries.end(); e++) {
+        record r;
+        r.epoch = e->epoch;
+        r.sqlHash = e->sqlHash;
+        r.startOffset = e->startOffset;
+        r.lineNumber = e->lineNumber;
+        r.abortedSession = e->abortedSession;
+        r.traceName = stringOffset(e->traceName);
+        r.instance = stringOffset(e->instance);
+        r.signatures = stringOffset(e->signatures);
+        r.global = e->global;
+
+        for (auto k = e->keys.begin(); k != e->keys.end(); k++) {
+            postings.push_back(posting{k->first, static_cast<uint32_t>(records.size()), k->second});
+        }
+
+        records.push_back(r);
+    }
+
+    std::sort(postings.begin(), postings.end(),
+        [](const posting &a, const posting &b) {
+            if (a.type != b.type) {
+                return a.type < b.type;
+            }
+            return a.key != b.key ? a.key < b.key : a.record < b.record;
+        });
+
+    header h;
+    std::memcpy(h.magic, DEADLOCK_INDEX_MAGIC, sizeof(h.magic));
+    h.recordCount = records.size();
+    h.postingCount = postings.size();
+    h.stringsLength = strings.size();
+
+    string tempName = fileName + ".tmp";
+    {
+        std::ofstream out(tempName, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(record));
+        out.write(reinterpret_cast<const char *>(postings.data()), postings.size() * sizeof(posting));
+        out.write(strings.data(), strings.size());
+        out.close();
+        if (out.fail()) {
+            cerr << "Cannot write deadlock index segment " << tempName << endl;
+            std::remove(tempName.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tempName.c_str(), fileName.c_str()) != 0) {
+        cerr << "Cannot rename " << tempName << " to " << fileName << endl;
+        std::remove(tempName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                        save()
+//------------------------------------------------------------------------------
+// Writes what has been added since the last save, a new segment per month,
+// then merges any month which now has too many segments.
+//==============================================================================
+bool oraDeadlockIndex::save()
+{
+    std::error_code ec;
+    fs::create_directories(mDirectory, ec);
+    if (ec) {
+        cerr << "Cannot create deadlock index directory " << mDirectory << endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (auto m = mPending.begin(); m != mPending.end(); m++) {
+        auto existing = segments(m->first);
+        unsigned sequence = existing.empty() ? 1 : existing.back().second + 1;
+        string fileName = (fs::path(mDirectory) / (m->first + '-' + std::to_string(sequence) + ".dlx")).string();
+
+        if (!writeSegment(fileName, m->second)) {
+            ok = false;
+            continue;
+        }
+
+        if (existing.size() + 1 > DEADLOCK_INDEX_MAX_SEGMENTS && !compact(m->first)) {
+            ok = false;
+        }
+    }
+
+    mPending.clear();
+    return ok;
+}
+
+//==============================================================================
+//                                                                     compact()
+//------------------------------------------------------------------------------
+// Merges all of a month's segments into one new one, then removes the old.
+//==============================================================================
+bool oraDeadlockIndex::compact(const string &month)
+{
+    auto existing = segments(month);
+    vector<entry> entries;
+
+    for (auto s = existing.begin(); s != existing.end(); s++) {
+        segment seg;
+        if (!seg.open(s->first)) {
+            return false;
+        }
+
+        vector<entry> more = seg.readAll();
+        std::move(more.begin(), more.end(), std::back_inserter(entries));
+    }
+
+    string fileName = (fs::path(mDirectory) /
+                       (month + '-' + std::to_string(existing.back().second + 1) + ".dlx")).string();
+    if (!writeSegment(fileName, entries)) {
+        return false;
+    }
+
+    for (auto s = existing.begin(); s != existing.end(); s++) {
+        std::remove(s->first.c_str());
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                     matches()
+//------------------------------------------------------------------------------
+// Checks a record found by its keys against the things the keys can't be sure
+// of. The time window, and the hashed strings.
+//==============================================================================
+bool oraDeadlockIndex::matches(const query &q, const segment &s, const uint32_t r)
+{
+    const record &rec = s.at(r);
+    if ((q.hasSince && rec.epoch < q.since) || (q.hasUntil && rec.epoch > q.until)) {
+        return false;
+    }
+
+    if (!q.instances.empty() &&
+        std::find(q.instances.begin(), q.instances.end(), s.text(rec.instance)) == q.instances.end()) {
+        return false;
+    }
+
+    if (q.signatures.empty()) {
+        return true;
+    }
+
+    // Whole signatures, or up to a dash.
+    string signatures = string(" ") + s.text(rec.signatures);
+    for (auto w = q.signatures.begin(); w != q.signatures.end(); w++) {
+        for (auto pos = signatures.find(' ' + *w); pos != string::npos;
+             pos = signatures.find(' ' + *w, pos + 1)) {
+            char next = pos + w->size() + 1 < signatures.size() ? signatures[pos + w->size() + 1] : ' ';
+            if (next == ' ' || next == '-') {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+//==============================================================================
+//                                                                        find()
+//------------------------------------------------------------------------------
+// Writes a line for every deadlock in the index that the query matches, in
+// time order, and returns how many there were:
+//
+// 2018-12-19 15:42:20  ORCL1  /traces/orcl1_ora_1234.trc:11  DEADLOCK  TX-X-S  aborted 272  SQL 5f1c0d4e2a9b3c71
+//
+// The same deadlock, indexed twice by analysing its trace file twice, is only
+// written once.
+//==============================================================================
+unsigned oraDeadlockIndex::find(const query &q, ostream &out)
+{
+    // Which months?
+    string firstMonth = q.hasSince ? monthOf(q.since) : "";
+    string lastMonth = q.hasUntil ? monthOf(q.until) : "999999";
+
+    // Each list of keys, as types and keys.
+    vector<vector<std::pair<uint32_t, uint64_t>>> terms;
+    auto addTerm = [&terms](const uint32_t type, const vector<uint64_t> &keys) {
+        if (!keys.empty()) {
+            terms.push_back(vector<std::pair<uint32_t, uint64_t>>());
+            for (auto k = keys.begin(); k != keys.end(); k++) {
+                terms.back().push_back(std::make_pair(type, *k));
+            }
+        }
+    };
+
+    addTerm(keyObject, vector<uint64_t>(q.objectIds.begin(), q.objectIds.end()));
+    addTerm(keySession, vector<uint64_t>(q.sessions.begin(), q.sessions.end()));
+    vector<uint64_t> hashes;
+    for (auto s = q.signatures.begin(); s != q.signatures.end(); s++) {
+        hashes.push_back(hash(*s));
+    }
+    addTerm(keySignature, hashes);
+    hashes.clear();
+    for (auto i = q.instances.begin(); i != q.instances.end(); i++) {
+        hashes.push_back(hash(*i));
+    }
+    addTerm(keyInstance, hashes);
+    addTerm(keySQL, q.sqlHashes);
+
+    vector<entry> found;
+    auto all = segments("");
+    for (auto s = all.begin(); s != all.end(); s++) {
+        string month = fs::path(s->first).filename().string().substr(0, 6);
+        if (month < firstMonth || month > lastMonth) {
+            continue;
+        }
+
+        segment seg;
+        if (!seg.open(s->first)) {
+            continue;
+        }
+
+        // Any of each term's keys, and all of the terms.
+        vector<uint32_t> candidates;
+        bool first = true;
+        for (auto t = terms.begin(); t != terms.end() && (first || !candidates.empty()); t++) {
+            vector<uint32_t> records;
+            for (auto k = t->begin(); k != t->end(); k++) {
+                seg.lookup(k->first, k->second, records);
+            }
+            std::sort(records.begin(), records.end());
+            records.erase(std::unique(records.begin(), records.end()), records.end());
+
+            if (first) {
+                candidates.swap(records);
+                first = false;
+            } else {
+                vector<uint32_t> both;
+                std::set_intersection(candidates.begin(), candidates.end(),
+                                      records.begin(), records.end(), std::back_inserter(both));
+                candidates.swap(both);
+            }
+        }
+
+        // No keys at all? Then it's everything in the time window.
+        if (terms.empty()) {
+            for (uint32_t r = 0; r < seg.recordCount(); r++) {
+                candidates.push_back(r);
+            }
+        }
+
+        for (auto r = candidates.begin(); r != candidates.end(); r++) {
+            if (matches(q, seg, *r)) {
+                found.push_back(seg.read(*r));
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end(), [](const entry &a, const entry &b) {
+        if (a.epoch != b.epoch) {
+            return a.epoch < b.epoch;
+        }
+        return a.traceName != b.traceName ? a.traceName < b.traceName : a.startOffset < b.startOffset;
+    });
+    found.erase(std::unique(found.begin(), found.end(), [](const entry &a, const entry &b) {
+        return a.epoch == b.epoch && a.traceName == b.traceName && a.startOffset == b.startOffset;
+    }), found.end());
+
+    for (auto e = found.begin(); e != found.end(); e++) {
+        out << (e->epoch ? oraFilter::formatTimestamp(e->epoch) : "Unknown time       ")
+            << "  " << (e->instance.empty() ? "?" : e->instance)
+            << "  " << e->traceName << ':';
+        if (e->lineNumber) {
+            out << e->lineNumber;
+        } else {
+            out << '@' << e->startOffset;
+        }
+
+        out << (e->global ? "  GLOBAL" : "  DEADLOCK");
+        if (!e->signatures.empty()) {
+            out << "  " << e->signatures;
+        }
+
+        if (!e->global) {
+            out << "  aborted " << e->abortedSession;
+        }
+
+        if (e->sqlHash) {
+            char hex[20];
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(e->sqlHash));
+            out << "  SQL " << hex;
+        }
+
+        out << '\n';
+    }
+
+    return found.size();
+}
@@ -23,33 +23,60 @@
  */
 
 #include "oraDeadlockReport.h"
+#include "oraReportText.h"
+#include "oraRowid.h"
+#include "oraHtmlEscape.h"
 
+#include <set>
+#include <mutex>
+
+// The CSS files we know exist, so that a long running process, the daemon
+// for example, doesn't keep checking for them.
+static std::set<string> cssKnown;
+static std::mutex cssKnownMutex;
 
 //==============================================================================
 //                                                                   Constructor
+//------------------------------------------------------------------------------
+// The report only reads the parse result, so any number of reports, or other
+// formats, can be written from the same one at once. The phase timings go in
+// stats, which must be this report's own. If writeBehind isn't zero, the
+// report is written by another thread, up to that many chunks behind.
 //==============================================================================
-oraDeadlockReport::oraDeadlockReport(oraTraceFile *traceFile):
-    mTraceFile(traceFile)
+oraDeadlockReport::oraDeadlockReport(const oraParseResult *result, oraStats *stats,
+                                     const size_t writeBehind):
+    mResult(result),
+    mStats(stats)
 {
-    string traceName = traceFile->traceName();
+    mExcerpts = false;
+    mObjects = nullptr;
+    string traceName = result->traceName();
     cerr << "\tReport file: " << traceName << '\n';
-    auto pos = traceName.find_last_of('.');
 
     // Strip off the current extension and replace it with html.
-    mReportName = traceName.substr(0, pos) + ".html";
-    mOFS = new ofstream(mReportName);
+    mReportName = result->outputName(".html");
+    mOFS = oraAsyncFile::open(mReportName, writeBehind);
+    ORA_PROBE1(report__open, mReportName.c_str());
 
     // Find the current directory for the trace file.
     string directoryName = "";
-    pos = traceName.find_last_of("\\/");
+    auto pos = traceName.find_last_of("\\/");
     if (pos != string::npos) {
         directoryName = traceName.substr(0, pos + 1);
     }
 
     mCssName = directoryName + "DeadlockAnalysis.css";
-    ifstream *cssFS = new ifstream(mCssName);
-    mCssExists = cssFS->good();
-    cssFS->close();
+
+    std::lock_guard<std::mutex> lock(cssKnownMutex);
+    mCssExists = (cssKnown.count(mCssName) != 0);
+    if (!mCssExists) {
+        ifstream cssFS(mCssName);
+        mCssExists = cssFS.good();
+    }
+
+    if (mCssExists) {
+        cssKnown.insert(mCssName);
+    }
 }
 
 //==============================================================================
@@ -57,7 +84,8 @@ oraDeadlockReport::oraDeadlockReport(oraTraceFile *traceFile):
 //==============================================================================
 oraDeadlockReport::~oraDeadlockReport()
 {
-    mOFS->close();
+    ORA_PROBE2(report__close, mReportName.c_str(), static_cast<long>(mOFS->tellp()));
+    mOFS.reset();
 }
 
 
@@ -80,6 +108,9 @@ void oraDeadlockReport::report()
     reportSidebar();
     reportBody();
     reportFooter();
+
+    // How much did we write?
+    mStats->addBytesWritten(mOFS->tellp());
 }
 
 //==============================================================================
@@ -89,223 +120,17 @@ void oraDeadlockReport::report()
 //==============================================================================
 void oraDeadlockReport::createCSSFile()
 {
-    ofstream *cssFS = new ofstream(mCssName);
-
-    if (cssFS->good()) {
-        *cssFS << "body {\n"
-               << "    margin: 0;\n"
-               << "    padding: 0;\n"
-               << "    background: rgb(95%, 95%, 80%);\n"
-               << "    color: black;\n"
-               << "}\n\n";
-
-        *cssFS << "table, th, td {\n"
-               << "    border: 1px solid rgb(85%,85%,70%);\n"
-               << "    padding-left: 4px;\n"
-               << "    padding-right: 4px;\n"
-               << "    padding-top: 2px;\n"
-               << "    padding-bottom: 2px;\n"
-               << "    vertical-align: top;\n"
-               << "}\n\n";
-
-        *cssFS << "table {\n"
-               << "    border-collapse: collapse;\n"
-               << "    background: beige;\n"
-               << "    font-size: smaller;\n"
-               << "    table-layout: fixed;\n"
-               << "    /* margin-left: 2.5%; */\n"
-               << "}\n\n";
-
-        *cssFS << "pre {\n"
-               << "    white-space: pre-wrap;\n"
-               << "    word-break: keep-all;\n"
-               << "    font: 100% mono;\n"
-               << "}\n\n";
-
-        *cssFS << "th {\n"
-               << "    background: rgb(90%,90%,75%);\n"
-               << "}\n\n";
-
-        *cssFS << ".number {\n"
-               << "    text-align: right;\n"
-               << "}\n\n";
-
-        *cssFS << ".left {\n"
-               << "    text-align: left;\n"
-               << "}\n\n";
-
-        *cssFS << ".middle {\n"
-               << "    text-align: center;\n"
-               << "}\n\n";
-
-        *cssFS << ".right {\n"
-               << "    text-align: right;\n"
-               << "}\n\n";
-
-        *cssFS << ".th_tiny {\n"
-               << "    width: 10%;\n"
-               << "}\n\n";
-
-        *cssFS << "/* \n"
-               << " * Used to hide the top left cell in the Deadlock Graph table. \n"
-               << " */ \n"
-               << ".th_background { \n"
-               << "    background: rgb(95%, 95%, 80%); \n"
-               << "    border-top: 1px solid rgb(95%, 95%, 80%); \n"
-               << "    border-left: 1px solid rgb(95%, 95%, 80%); \n"
-               << "}\n\n";
-
-        *cssFS << ".th_small {\n"
-               << "    width: 12%;\n"
-               << "}\n\n";
-
-        *cssFS << ".th_medium {\n"
-               << "    width: 20%;\n"
-               << "}\n\n";
-
-        *cssFS << ".th_large {\n"
-               << "    width: 40%;\n"
-               << "}\n\n";
-
-        *cssFS << ".th_small {\n"
-               << "    width: 12%;\n"
-               << "}\n\n";
-
-        *cssFS << "ul {\n"
-               << "    font-size: 0.7em;\n"
-               << "}\n\n";
-
-        *cssFS << "li {\n"
-               << "}\n\n";
-
-        *cssFS << "/*\n"
-               << " * Analysis Header details. \n"
-               << " * Feel free to modify these to suit your style requirements.\n"
-               << " */\n"
-               << "#TraceFile {\n"
-               << "    font-weight: bold;\n"
-               << "}\n\n";
-
-        *cssFS << "#SystemName {\n"
-               << "}\n\n";
-
-        *cssFS << "#ServerName {\n"
-               << "}\n\n";
-
-        *cssFS << "#OracleHome {\n"
-               << "}\n\n";
-
-        *cssFS << "#InstanceName {\n"
-               << "    font-weight: bold;\n"
-               << "}\n\n";
-
-        *cssFS << "#AnalysisResult {\n"
-               << "}\n\n";
-
-        *cssFS << "#DeadlockWait {\n"
-               << "    font-weight: bold;\n"
-               << "}\n\n";
-
-        *cssFS << "#DeadlockSignature {\n"
-               << "}\n\n";
-
-        *cssFS << "#DeadlockCause {\n"
-               << "    color: red;\n"
-               << "    font-weight: bold;\n"
-               << "}\n\n";
-
-        *cssFS << "#WaitStack {\n"
-               << "}\n\n";
-
-        *cssFS << "/*\n"
-               << " * If the analysis found deadlocks, change the highlighting.\n"
-               << " */\n"
-               << ".nonZero {\n"
-               << "    color: red;\n"
-               << "    font-weight: bold;\n"
-               << "}\n\n";
-
-        *cssFS << "/*\n"
-               << " * Footer Stuff\n"
-               << " */\n";
-
-        *cssFS << ".footer {\n"
-               << "    text-align: center;\n"
-               << "    font-size: x-small;\n"
-               << "}\n\n";
-
-        *cssFS << ".url {\n"
-               << "    color: blue;\n"
-               << "    font: mono;\n"
-               << "}\n\n";
-
-        *cssFS << "/* Sidebar stuff - stays still when scrolling */\n"
-               << "div {\n"
-               << "    display: block;\n"
-               << "}\n\n";
-
-        *cssFS << "div#entry {\n"
-               << "    padding-left: 15%;\n"
-               << "}\n\n";
-
-        *cssFS << "div#sidebar {\n"
-               << "    position: fixed;\n"
-               << "    top: 8;\n"
-               << "    left: 4;\n"
-               << "    width: 10%;\n"
-               << "    margin: 0 0 0 2;\n"
-               << "    text-align: center;\n"
-               << "    border-bottom: 1px solid rgb(95%,95%,80%);\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar h4 {\n"
-               << "    border: 1px solid rgb(73%,73%,58%);\n"
-               << "    border-bottom: none;\n"
-               << "    background: rgb(90%,90%,75%);\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar ul {\n"
-               << "    list-style: none;\n"
-               << "    margin: 0;\n"
-               << "    padding: 0 0 2em;\n"
-               << "    border: 1px solid rgb(73%,73%,58%);\n"
-               << "    background: beige;\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar h4, #sidebar ul {\n"
-               << "    margin: 0 6px 0 0;\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar li {\n"
-               << "    padding: 0.5em 0;\n"
-               << "    line-height: 1em;\n"
-               << "    border-bottom: 1px solid rgb(84%,84%,69%);\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar a {\n"
-               << "    text-decoration: none;\n"
-               << "    padding: 0 0.25em;\n"
-               << "    border: 1px solid rgb(84%,84%,69%);\n"
-               << "    background: rgb(95%,95%,80%);\n"
-               << "    position: relative; top: 1em;\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar a:link {\n"
-               << "   color: rgb(20%,40%,0%);\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar a:visited {\n"
-               << "   color: rgb(58%,68%,40%);\n"
-               << "}\n\n";
-
-        *cssFS << "#sidebar a:hover {\n"
-               << "   color: rgb(10%,20%,0%);\n"
-               << "   background: #FFF;\n"
-               << "}\n\n";
-
-
-        // Flush.
-        *cssFS << endl;
+    oraPhaseTimer timer(mStats, "createCSSFile");
+
+    ofstream cssFS(mCssName);
+
+    if (cssFS.good()) {
+        cssFS.write(cssText, sizeof(cssText) - 1);
+        mStats->addBytesWritten(sizeof(cssText) - 1);
+        cssFS.flush();
+
+        std::lock_guard<std::mutex> lock(cssKnownMutex);
+        cssKnown.insert(mCssName);
     }
 }
 
@@ -316,14 +141,9 @@ void oraDeadlockReport::createCSSFile()
 //==============================================================================
 void oraDeadlockReport::reportHeader()
 {
-    *mOFS << "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0 Transitional//EN\"\n\t"
-		  << "\thttp://www.w3.org/TR/REC-html40/loose.dtd\">"
-          << "<html>\n"
-          << "<head>\n"
-          << "<title>Deadlock Analysis</title>\n"
-          << "<link rel=\"stylesheet\" href=\"DeadlockAnalysis.css\">\n"
-          << "</head>\n"
-          << "<body>\n" << endl;
+    oraPhaseTimer timer(mStats, "reportHeader");
+
+    writeText(htmlHeader);
 }
 
 //==============================================================================
@@ -333,15 +153,14 @@ void oraDeadlockReport::reportHeader()
 //==============================================================================
 void oraDeadlockReport::reportSidebar()
 {
-    *mOFS << "<div id=\"sidebar\">\n"
-		  << "<h4>Contents</h4>\n"
-          << "<ul>\n";
+    oraPhaseTimer timer(mStats, "reportSidebar");
+
+    writeText(sidebarStart);
 
     // Write the index entries.
     quickIndex();
 
-    *mOFS << "</ul>\n"
-          << "</div>\n" << endl;
+    writeText(sidebarEnd);
 }
 
 //==============================================================================
@@ -351,26 +170,20 @@ void oraDeadlockReport::reportSidebar()
 //==============================================================================
 void oraDeadlockReport::reportFooter()
 {
+    oraPhaseTimer timer(mStats, "reportFooter");
+
     extern string programName;
     extern string programVersion;
     extern string programAuthor;
 
-    *mOFS << "<p></p>\n<hr>\n"
-          << "<p class=\"footer\">\n\t"
-          << "Created with <strong>" << programName << ' ' << programVersion
-          << "</strong><br>Copyright &copy; " << programAuthor << " 2017-2019<br>\n\t"
-          << "Released under the <a href=\"https://opensource.org/licenses/MIT\"><span class=\"url\">MIT Licence</span></a><br><br>\n\t"
-          << "Binary releases available from: "
-          << "<a href=\"https://github.com/NormanDunbar/DeadlockAnalysys/releases\">"
-          << "<span class=\"url\">https://github.com/NormanDunbar/DeadlockAnalysys/releases</span></a><br>\n\t"
-          << "Source code available from: "
-          << "<a href=\"https://github.com/NormanDunbar/DeadlockAnalysys\">"
-          << "<span class=\"url\">https://github.com/NormanDunbar/DeadlockAnalysys</span></a>\n</p>\n\n";
+    writeText(footerStart);
+    *mOFS << programName << ' ' << programVersion;
+    writeText(footerMiddle);
+    *mOFS << programAuthor;
 
     // Close main div and the report.
-    *mOFS << "</div>\n\n"
-          << "</body>\n"
-          << "</html>" << endl;
+    writeText(footerEnd);
+    mOFS->flush();
 }
 
 //==============================================================================
@@ -385,6 +198,8 @@ void oraDeadlockReport::reportFooter()
 void oraDeadlockReport::reportBody()
 {
     traceFileDetails();
+    waitStatistics();
+    hotBlocks();
     reportSidebar();
     deadlocks();
 }
@@ -397,6 +212,8 @@ void oraDeadlockReport::reportBody()
 //==============================================================================
 void oraDeadlockReport::traceFileDetails()
 {
+    oraPhaseTimer timer(mStats, "traceFileDetails");
+
     // Main div and heading.
     *mOFS << "<div id=\"entry\">\n\n";
 
@@ -413,9 +230,9 @@ void oraDeadlockReport::traceFileDetails()
 
     // Local trace file name.
     *mOFS << "<tr>\n\t"
-          << "<th class=\"right th_small\">Trace File</th>\n\t"
-          << "<td id=\"TraceFile\">"
-          << mTraceFile->traceName()
+             "<th class=\"right th_small\">Trace File</th>\n\t"
+             "<td id=\"TraceFile\">"
+          << oraHtmlEscape(mResult->traceName())
           << "</td>\n</tr>\n";
 
     // Close the table.
@@ -426,55 +243,55 @@ void oraDeadlockReport::traceFileDetails()
 
     // Original trace file name on the server.
     *mOFS << "<tr>\n\t"
-          << "<th class=\"right th_small\">Original Trace File</th>\n\t"
-          << "<td id=\"TraceFile\">"
-          << mTraceFile->originalPath()
+             "<th class=\"right th_small\">Original Trace File</th>\n\t"
+             "<td id=\"TraceFile\">"
+          << oraHtmlEscape(mResult->originalPath())
           << "</td>\n</tr>\n";
 
     // System name.
     *mOFS << "<tr>\n\t"
-          << "<th class=\"right th_small\">System</th>\n\t"
-          << "<td id=\"SystemName\">"
-          << mTraceFile->systemName()
+             "<th class=\"right th_small\">System</th>\n\t"
+             "<td id=\"SystemName\">"
+          << oraHtmlEscape(mResult->systemName())
           << "</td>\n</tr>\n";
 
     // Server Name.
     *mOFS << "<tr>\n\t"
-          << "<th class=\"right th_small\">Server name</th>\n\t"
-          << "<td id=\"ServerName\">"
-          << mTraceFile->serverName()
+             "<th class=\"right th_small\">Server name</th>\n\t"
+             "<td id=\"ServerName\">"
+          << oraHtmlEscape(mResult->serverName())
           << "</td>\n</tr>\n";
 
     // Oracle Home.
     *mOFS << "<tr>\n\t"
-          << "<th class=\"right th_small\">Oracle Home</th>\n\t"
-          << "<td id=\"OracleHome\">"
-          << mTraceFile->oracleHome()
+             "<th class=\"right th_small\">Oracle Home</th>\n\t"
+             "<td id=\"OracleHome\">"
+          << oraHtmlEscape(mResult->oracleHome())
           << "</td>\n</tr>\n";
 
     // Instance Name.
     *mOFS << "<tr>\n\t"
-          << "<th class=\"right th_small\">Instance Name</th>\n\t"
-          << "<td id=\"InstanceName\">"
-          << mTraceFile->instanceName()
+             "<th class=\"right th_small\">Instance Name</th>\n\t"
+             "<td id=\"InstanceName\">"
+          << oraHtmlEscape(mResult->instanceName())
           << "</td>\n</tr>\n";
 
     // How many deadlocks were found?
-    unsigned deadlockCount = mTraceFile->deadlockCount();
+    unsigned deadlockCount = mResult->deadlockCount();
     *mOFS << "<tr>\n\t"
-          << "<th class=\"right th_small\">Analysis</td>\n\t"
-          << "<td id=\"AnalysisResult\" class=\""
+             "<th class=\"right th_small\">Analysis</td>\n\t"
+             "<td id=\"AnalysisResult\" class=\""
           << (deadlockCount != 0 ? "nonZero" : "number")
           << "\"> There "
           << (deadlockCount == 1 ? "was " : "were ") << deadlockCount << " deadlock"
           << (deadlockCount == 1 ? "" : "s")
           << " in the trace file:<br><br>\n";
 
-    for (unsigned x = 0; x < mTraceFile->deadlockCount(); x++)     {
+    for (unsigned x = 0; x < mResult->deadlockCount(); x++)     {
         // List each deadlock reason, with a link to the deadlock.
         *mOFS << "<a href=\"#deadlock_" << x + 1 << "\">"
-              << "Deadlock " << x + 1 << "</a>: "
-              << mTraceFile->deadLock(x)->deadlockWait()
+                 "Deadlock " << x + 1 << "</a>: "
+              << oraHtmlEscape(mResult->deadLock(x)->deadlockWait())
               << "<br>";
     }
 
@@ -482,7 +299,87 @@ void oraDeadlockReport::traceFileDetails()
     *mOFS << "</td>\n</tr>\n";
 
     // Close the table.
-    *mOFS << "</table>\n" << endl;
+    *mOFS << "</table>\n\n";
+}
+
+//==============================================================================
+//                                                              waitStatistics()
+//------------------------------------------------------------------------------
+// Writes the wait event statistics for all the deadlocked sessions' wait
+// stacks in the trace file. Only if there were any waits of course.
+//==============================================================================
+void oraDeadlockReport::waitStatistics()
+{
+    oraPhaseTimer timer(mStats, "waitStatistics");
+
+    oraWaitStats waitStats;
+    for (unsigned x = 0; x < mResult->deadlockCount(); x++) {
+        waitStats.add(*mResult->deadLock(x)->waitStack());
+    }
+
+    if (waitStats.empty()) {
+        return;
+    }
+
+    heading(2, "Wait Event Statistics");
+    writeText(waitStatsHeadings);
+
+    auto summary = waitStats.summary();
+    for (auto i = summary.begin(); i != summary.end(); i++) {
+        *mOFS << "<tr>\n\t<td class=\"left\">" << oraHtmlEscape(oraWaitEvent::eventName(i->eventId)) << "</td>\n\t"
+                 "<td class=\"number\">" << i->count << "</td>\n\t"
+                 "<td class=\"number\">" << oraWaitEvent::formatDuration(i->totalMicros) << "</td>\n\t"
+                 "<td class=\"number\">" << oraWaitEvent::formatDuration(i->p50Micros) << "</td>\n\t"
+                 "<td class=\"number\">" << oraWaitEvent::formatDuration(i->p95Micros) << "</td>\n\t"
+                 "<td class=\"number\">" << oraWaitEvent::formatDuration(i->maxMicros) << "</td>\n"
+                 "</tr>\n";
+    }
+
+    // Close the table.
+    *mOFS << "</table>\n\n";
+}
+
+//==============================================================================
+//                                                                   hotBlocks()
+//------------------------------------------------------------------------------
+// Writes the blocks whose rows were waited on in more than one deadlock. Those
+// are usually short of ITL slots, or bitmap index blocks, rather than rows that
+// the application locks in the wrong order. Nothing if there aren't any.
+//==============================================================================
+void oraDeadlockReport::hotBlocks()
+{
+    oraPhaseTimer timer(mStats, "hotBlocks");
+
+    oraHotBlocks blocks;
+    for (unsigned x = 0; x < mResult->deadlockCount(); x++) {
+        blocks.add(*mResult->deadLock(x));
+    }
+
+    auto summary = blocks.summary(HOT_BLOCK_DEADLOCKS);
+    if (summary.empty()) {
+        return;
+    }
+
+    heading(2, "Hot Blocks");
+    writeText(hotBlocksHeadings);
+
+    if (summary.size() > HOT_BLOCK_ROWS) {
+        summary.resize(HOT_BLOCK_ROWS);
+    }
+
+    for (auto i = summary.begin(); i != summary.end(); i++) {
+        *mOFS << "<tr>\n\t<td class=\"number\">" << i->file << "</td>\n\t"
+                 "<td class=\"number\">" << i->block << "</td>\n\t"
+                 "<td class=\"number\">" << i->objectId << "</td>\n\t"
+                 "<td class=\"number\">" << i->dataObjectId << "</td>\n\t"
+                 "<td class=\"number\">" << i->deadlocks << "</td>\n\t"
+                 "<td class=\"number\">" << i->waiters << "</td>\n\t"
+                 "<td class=\"middle\">" << oraHtmlEscape(i->modes) << "</td>\n"
+                 "</tr>\n";
+    }
+
+    // Close the table.
+    *mOFS << "</table>\n\n";
 }
 
 //==============================================================================
@@ -495,7 +392,7 @@ void oraDeadlockReport::traceFileDetails()
 //==============================================================================
 void oraDeadlockReport::quickIndex()
 {
-    unsigned maxDeadlocks = mTraceFile->deadlockCount();
+    unsigned maxDeadlocks = mResult->deadlockCount();
 
     if (maxDeadlocks > 0) {
         // There's always a summary.
@@ -504,7 +401,7 @@ void oraDeadlockReport::quickIndex()
         // Now the deadlocks themselves.
         for (unsigned x = 0; x < maxDeadlocks; x++) {
             *mOFS << "\t<li><a href=\"#deadlock_" << x + 1 << "\">"
-                  << "Deadlock " << x + 1 << "</a></li>\n";
+                     "Deadlock " << x + 1 << "</a></li>\n";
         }
     }
 }
@@ -517,8 +414,8 @@ void oraDeadlockReport::quickIndex()
 //==============================================================================
 void oraDeadlockReport::deadlocks()
 {
-    for (unsigned x = 0; x < mTraceFile->deadlockCount(); x++) {
-        oraDeadlock *thisDeadlock = mTraceFile->deadLock(x);
+    for (unsigned x = 0; x < mResult->deadlockCount(); x++) {
+        const oraDeadlock *thisDeadlock = mResult->deadLock(x);
 
         // Open the div.
         *mOFS << "<div id=\"deadlock_" << x + 1 << "\">\n";
@@ -533,8 +430,13 @@ void oraDeadlockReport::deadlocks()
         // Waiter details.
         deadlockWaiters(thisDeadlock);
 
+        // The raw trace file text, if requested.
+        if (mExcerpts) {
+            deadlockExcerpt(thisDeadlock);
+        }
+
         // Close the div.
-        *mOFS << "</div>\n\n\n" << endl;
+        *mOFS << "</div>\n\n\n\n";
     }
 }
 
@@ -543,42 +445,48 @@ void oraDeadlockReport::deadlocks()
 //------------------------------------------------------------------------------
 // Dumps out a summary of a single deadlock.
 //==============================================================================
-void oraDeadlockReport::deadlockSummary(oraDeadlock *dl)
+void oraDeadlockReport::deadlockSummary(const oraDeadlock *dl)
 {
+    oraPhaseTimer timer(mStats, "deadlockSummary");
+
     heading(4, "Deadlock Summary");
     // Open the table.
     *mOFS << "<table  style=\"width:95%\">\n";
 
-    // Line number.
+    // Line number. Unknown if the file was skipped through by time.
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Line Number</th>\n\t"
-          << "<td class=\"left\">"
-          << dl->lineNumber()
-          << "</td>\n</tr>\n";
+             "<td class=\"left\">";
+    if (dl->lineNumber()) {
+        *mOFS << dl->lineNumber();
+    } else {
+        *mOFS << "Unknown, byte offset " << dl->startOffset();
+    }
+    *mOFS << "</td>\n</tr>\n";
 
     // Sessions involved in the deadlock.
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Sessions</th>\n\t"
-          << "<td class=\"left\">"
+             "<td class=\"left\">"
           << dl->rows()
           << "</td>\n</tr>\n";
 
     // The aborted session (SID).
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Dumped SID</th>\n\t"
-          << "<td class=\"left\">"
+             "<td class=\"left\">"
           << dl->abortedSession()
           << "</td>\n</tr>\n";
 
     // Main deadlock wait reason.
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Current Wait</th>\n\t"
-          << "<td id=\"DeadlockWait\">"
-          << dl->deadlockWait()
+             "<td id=\"DeadlockWait\">"
+          << oraHtmlEscape(dl->deadlockWait())
           << "</td>\n</tr>\n";
 
     // Session wait stack.
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Wait Stack</th>\n\t"
-          << "<td id=\"WaitStack\">";
+             "<td id=\"WaitStack\">";
 
           for (unsigned ws = 0; ws < dl->waitStack()->size(); ws++) {
-              *mOFS << dl->waitStack()->at(ws)
+              *mOFS << oraHtmlEscape(dl->waitStack()->at(ws).text())
                     << "<br>";
           }
 
@@ -586,10 +494,10 @@ void oraDeadlockReport::deadlockSummary(oraDeadlock *dl)
 
     // Deadlock signature.
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Signature</th>\n\t"
-          << "<td id=\"DeadlockSignature\">";
+             "<td id=\"DeadlockSignature\">";
 
           for (unsigned s = 0; s < dl->signatures()->size(); s++) {
-              *mOFS << dl->signatures()->at(s)
+              *mOFS << oraHtmlEscape(dl->signatures()->at(s))
                     << "<br>";
           }
     *mOFS << "</td>\n</tr>\n";
@@ -597,12 +505,11 @@ void oraDeadlockReport::deadlockSummary(oraDeadlock *dl)
     // Probable cause.
     bool gotCause = false;
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Probable Cause</th>\n\t"
-          << "<td id=\"DeadlockCause\">\n";
+             "<td id=\"DeadlockCause\">\n";
 
     if (dl->ul()) {
         gotCause = true;
-        *mOFS << "\t\t User defined locking - you are, unfortunately, on your own!<br><br>\n"
-              << "\t\t Check for inappropriate use of DBMS_LOCK, LOCK TABLE or SELECT FOR UPDATE.<br>\n";
+        writeText(causeUL);
     }
 
     if (dl->txxs()) {
@@ -610,61 +517,47 @@ void oraDeadlockReport::deadlockSummary(oraDeadlock *dl)
 
         // If we have " ITL " in the current wait, we know the reason.
         if (dl->deadlockWait().find(" ITL ") != string::npos) {
-            *mOFS << "\t\t Insufficient ITL entries (See docId 1552191.1);<br><br>\n"
-                  << "\t\t Increase the INITRANS settings on the affected object (see below) and<br>\n"
-                  << "\t\t then <strong>ALTER <object_type> xxx MOVE;</strong> to make the change stick.<br>\n";
+            writeText(causeITL);
         } else {
             // It's either bitmap indexes or PK/UK manipulation gone wrong.
-            *mOFS << "\t\t Bitmap indexes (See docId 1552175.1);<br><br>\n"
-                  << "\t\t If the objects (see below) are bitmap indexes, then that's your problem.<br>\n"
-                  << "\t\t Those should not be used in an OLTP or in <em>frequently</em> updated system. Change them<br>\n"
-                  << "\t\t to normal type indexes and watch  the deadlocks vanish!<br><hr>\n"
-                  //
-                  << "\t\t Manipulation of primary/unique key in an inconsistent order (See docId 1552191.1).<br><br>\n"
-                  << "\t\t The sessions are, apparently, attempting to maintain numerous rows with the same Primary<br>\n"
-                  << "\t\t or Unique Key. Are you using sequence numbers based on a table, rather than on sequences?<br><br>\n"
-                  << "\t\t If one or more of the waiters is showing 'no rows' in the waited on rowid, <em>and</em> at least <br>\n"
-                  << "\t\t one other is an index object, then this is the most likely cause of this type of deadlock.<br>\n";
+            writeText(causeBitmapOrKey);
         }
     }
 
     if (dl->tm()) {
         gotCause = true;
-        *mOFS << "\t\t Unindexed FK constraint columns (See docId 1552169.1).<br><br>\n"
-              << "\t\t If a parent table's referenced column(s) can be deleted or updated<br>\n"
-              << "\t\t or, if the data are ever retrieved using a join between the parent and child<br>\n"
-              << "\t\t on the FK column(s), then the child table's FK column(s) must be indexed.<br>\n";
+        writeText(causeTM);
     }
 
     if (dl->txxx()) {
         gotCause = true;
         if (dl->rows() == 1) {
-            *mOFS << "\t\t Self deadlock - with an autonomous transaction (See docId 1552173); or,<br>\n"
-                  << "\t\t Self deadlock - without an autonomous transaction (See docId 1552123).<br><br>\n"
-                  << "\t\t The main code has fired off an autonomous transaction, perhaps, and that is waiting to<br>\n"
-                  << "\t\t update rows held by the main transaction. Fix the code to avoid this situation.<br>\n";
+            writeText(causeSelfDeadlock);
         } else {
-            *mOFS << "\t\t Deadlock caused by application code (See docId 1552120.1).<br><br>\n"
-                  << "\t\t The code is updating rows in different orders, most likely, and this is best<br>\n"
-                  << "\t\t avoided. Make sure that the code gets object data in the same order (alphabetic?)<br>\n"
-                  << "\t\t to avoid this type of deadlock.<br>\n";
+            writeText(causeApplication);
         }
     }
 
     if (!gotCause) {
-        *mOFS << "\t\t Deadlock cause unknown. Please zip and send this trace file - after obfuscating any personal\n"
-              << "\t\t data or server names, IP addresses, just in case - to Norm via Github as an issue\n"
-              << "\t\t and he'll attempt to find the cause and fix the code to avoid this in future.<br><br>\n"
-              << "\t\t The Issues URL is <a href=\"https://github.com/NormanDunbar/DeadlockAnalysys/issues\">"
-              << "<span class=\"url\">https://github.com/NormanDunbar/DeadlockAnalysys/issues</span></a>.<br>";
+        writeText(causeUnknown);
     }
     *mOFS << "\t</td>\n</tr>\n";
 
     // Aborted SQL
     *mOFS << "<tr>\n\t<th class=\"right th_small\">Aborted SQL</th>\n\t"
-          << "<td>\n\t\t<pre>" << dl->SQL()
+             "<td>\n\t\t<pre>" << oraHtmlEscape(dl->SQL())
           << "</pre>\n\t</td>\n</tr>\n";
 
+    // Anything we couldn't parse. Only there if there was some.
+    if (!dl->parseErrors()->empty()) {
+        *mOFS << "<tr>\n\t<th class=\"right th_small\">Parse Errors</th>\n\t"
+                 "<td>";
+        for (auto e = dl->parseErrors()->begin(); e != dl->parseErrors()->end(); e++) {
+            *mOFS << oraHtmlEscape(*e) << "<br>";
+        }
+        *mOFS << "</td>\n</tr>\n";
+    }
+
     // Close the table.
     *mOFS << "</table>\n\n";
 
@@ -675,50 +568,37 @@ void oraDeadlockReport::deadlockSummary(oraDeadlock *dl)
 //------------------------------------------------------------------------------
 // Dumps out details of a single deadlock graph.
 //==============================================================================
-void oraDeadlockReport::deadlockGraph(oraDeadlock *dl)
+void oraDeadlockReport::deadlockGraph(const oraDeadlock *dl)
 {
-    heading(4, "Deadlock Graph");
+    oraPhaseTimer timer(mStats, "deadlockGraph");
 
-    // Open the table.
-    *mOFS << "<table  style=\"width:95%\">\n";
+    heading(4, "Deadlock Graph");
 
-    // Headings for table.
-    *mOFS << "<tr>\n\t<th class=\"th_medium th_background\">&nbsp;</th>\n\t"
-          << "<th colspan=4 class=\"th_large\">Blockers</th>\n\t"
-          << "<th colspan=4 class=\"th_large\">Waiters</th>\n</tr>\n";
-
-    *mOFS << "<tr>\n\t<th>Resource Name</th>\n\t";
-    for (unsigned x = 0; x < 2; x++) {
-        // Two sets of headings here.
-        *mOFS << "<th>Process</th>\n\t"
-              << "<th>SID</th>\n\t"
-              << "<th>Holding</th>\n\t"
-              << "<th>Waiting</th>\n\t";
-    }
-    *mOFS << "\n</tr>\n";
+    // Open the table and write the headings.
+    writeText(graphHeadings);
 
     // Process all the blockers, and whoever is waiting for them.
     for (unsigned x = 0; x < dl->rows(); x++) {
-        oraBlockerWaiter *b = dl->blockerByIndex(x);
+        const oraBlockerWaiter *b = dl->blockerByIndex(x);
 
         if (b) {
             // Get the waiter for this blocker.
-            oraBlockerWaiter *w = dl->waiterBySession(b->otherSession());
+            const oraBlockerWaiter *w = dl->waiterBySession(b->otherSession());
 
             // Resource name.
-            *mOFS << "<tr>\n\t<td>" << b->resourceName() << "</td>\n\t";
+            *mOFS << "<tr>\n\t<td>" << oraHtmlEscape(b->resourceName()) << "</td>\n\t";
 
             // Blocker details
             *mOFS << "<td class=\"middle\">" << b->process() << "</td>\n\t"
-                  << "<td class=\"middle\">" << b->session() << "</td>\n\t"
-                  << "<td class=\"middle\">" << (b->holds().empty() ? "&nbsp;" : b->holds()) << "</td>\n\t"
-                  << "<td class=\"middle\">" << (b->waits().empty() ? "&nbsp;" : b->waits()) << "</td>\n\t";
+                     "<td class=\"middle\">" << b->session() << "</td>\n\t"
+                     "<td class=\"middle\">" << oraHtmlEscape(b->holds(), "&nbsp;") << "</td>\n\t"
+                     "<td class=\"middle\">" << oraHtmlEscape(b->waits(), "&nbsp;") << "</td>\n\t";
 
             // Waiter details
             *mOFS << "<td class=\"middle\">" << w->process() << "</td>\n\t"
-                  << "<td class=\"middle\">" << w->session() << "</td>\n\t"
-                  << "<td class=\"middle\">" << (w->holds().empty() ? "&nbsp;" : w->holds()) << "</td>\n\t"
-                  << "<td class=\"middle\">" << (w->waits().empty() ? "&nbsp;" : w->waits()) << "</td>\n";
+                     "<td class=\"middle\">" << w->session() << "</td>\n\t"
+                     "<td class=\"middle\">" << oraHtmlEscape(w->holds(), "&nbsp;") << "</td>\n\t"
+                     "<td class=\"middle\">" << oraHtmlEscape(w->waits(), "&nbsp;") << "</td>\n";
 
             *mOFS << "</tr>\n";
         }
@@ -735,36 +615,30 @@ void oraDeadlockReport::deadlockGraph(oraDeadlock *dl)
 //------------------------------------------------------------------------------
 // Dumps out details of deadlock's waiters.
 //==============================================================================
-void oraDeadlockReport::deadlockWaiters(oraDeadlock *dl)
+void oraDeadlockReport::deadlockWaiters(const oraDeadlock *dl)
 {
-    heading(4, "Deadlock Waiters");
-
-    // Open the table.
-    *mOFS << "<table  style=\"width:95%\">\n";
+    oraPhaseTimer timer(mStats, "deadlockWaiters");
 
-    // Headings.
-    *mOFS << "<tr>\n\t<th class=\"th_medium\">Resource Name</th>\n\t"
-          << "<th class=\"th_tiny\">SID</th>\n\t"
-          << "<th class=\"th_tiny\">Blocker</th>\n\t"
-          << "<th class=\"th_medium\">Rowid Waited</th>\n\t"
-          << "<th class=\"th_tiny\">File No.</th>\n\t"
-          << "<th class=\"th_tiny\">Block No.</th>\n\t"
-          << "<th class=\"th_tiny\">Slot No.</th>\n\t"
-          << "<th class=\"th_tiny\">Object Id</th>\n";
+    heading(4, "Deadlock Waiters");
 
-    *mOFS << "</tr>\n";
+    // Open the table and write the headings.
+    if (mObjects) {
+        writeText(waiterHeadingsNamed);
+    } else {
+        writeText(waiterHeadings);
+    }
 
     // Grab the waiters in the order they are in the deadlock graph
     // so, basically, process the blockers and grab their waiting session.
     for (unsigned x = 0; x < dl->rows(); x++) {
-        oraBlockerWaiter *b = dl->blockerByIndex(x);
+        const oraBlockerWaiter *b = dl->blockerByIndex(x);
 
         if (b) {
             // Get the waiter for this blocker.
-            oraBlockerWaiter *w = dl->waiterBySession(b->otherSession());
+            const oraBlockerWaiter *w = dl->waiterBySession(b->otherSession());
 
             // Resource name.
-            *mOFS << "<tr>\n\t<td class=\"left\">" << w->resourceName() << "</td>\n\t";
+            *mOFS << "<tr>\n\t<td class=\"left\">" << oraHtmlEscape(w->resourceName()) << "</td>\n\t";
 
             // Session.
             *mOFS << "<td class=\"middle\">" << w->session() << "</td>\n\t";
@@ -773,7 +647,7 @@ void oraDeadlockReport::deadlockWaiters(oraDeadlock *dl)
             *mOFS << "<td class=\"middle\">" << w->otherSession() << "</td>\n\t";
 
             // Rowid.
-            *mOFS << "<td class=\"middle\">" << w->rowidWait() << "</td>\n\t";
+            *mOFS << "<td class=\"middle\">" << oraHtmlEscape(w->rowidWait()) << "</td>\n\t";
 
             // File.
             *mOFS << "<td class=\"middle\">" << w->file() << "</td>\n\t";
@@ -787,6 +661,21 @@ void oraDeadlockReport::deadlockWaiters(oraDeadlock *dl)
             // Object Id.
             *mOFS << "<td class=\"middle\">" << w->objectId() << "</td>\n";
 
+            // And its name, if we can.
+            if (mObjects) {
+                const char *owner, *name, *type;
+                *mOFS << "\t<td class=\"left\">";
+                if (w->objectId() && mObjects->lookup(w->objectId(), owner, name, type)) {
+                    *mOFS << oraHtmlEscape(string(owner) + '.' + name);
+                    if (*type) {
+                        *mOFS << " (" << oraHtmlEscape(type) << ')';
+                    }
+                } else if (w->objectId()) {
+                    *mOFS << "Unknown";
+                }
+                *mOFS << "</td>\n";
+            }
+
             // Close the row.
             *mOFS << "</tr>\n";
         }
@@ -798,6 +687,29 @@ void oraDeadlockReport::deadlockWaiters(oraDeadlock *dl)
 
 }
 
+//==============================================================================
+//                                                             deadlockExcerpt()
+//------------------------------------------------------------------------------
+// Dumps out the raw trace file text for a single deadlock. This is read
+// directly from the trace file, using the deadlock's byte offsets, so there's
+// no need to scan the file again.
+//==============================================================================
+void oraDeadlockReport::deadlockExcerpt(const oraDeadlock *dl)
+{
+    oraPhaseTimer timer(mStats, "deadlockExcerpt");
+
+    heading(4, "Trace File Extract");
+
+    *mOFS << "<p>Bytes " << dl->startOffset() << " to " << dl->endOffset()
+          << " of the trace file.</p>\n"
+             "<pre>";
+
+    // The trace is full of '<' and '>' so needs escaping.
+    *mOFS << oraHtmlEscape(mResult->excerpt(dl));
+
+    *mOFS << "</pre>\n\n";
+}
+
 //==============================================================================
 //                                                                     heading()
 //------------------------------------------------------------------------------
@@ -805,6 +717,6 @@ void oraDeadlockReport::deadlockWaiters(oraDeadlock *dl)
 //==============================================================================
 void oraDeadlockReport::heading(const unsigned level, const string heading)
 {
-    *mOFS << "<h" << level << '>' << heading << "</h" << level << ">\n" << endl;
+    *mOFS << "<h" << level << '>' << heading << "</h" << level << ">\n\n";
 }
 
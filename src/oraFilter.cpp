@@ -0,0 +1,217 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraFilter.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using std::find;
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraFilter::oraFilter()
+{
+    mHasSince = false;
+    mSince = 0;
+    mHasUntil = false;
+    mUntil = 0;
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraFilter::~oraFilter()
+{
+    //dtor
+}
+
+//==============================================================================
+//                                                            wantedSignatures()
+//------------------------------------------------------------------------------
+// Does any of a deadlock's signatures start with any of the wanted ones? So
+// "TM" matches "TM-SX-SSX-SX-SSX" and "TX-X-S" matches "TX-X-S-X-S" etc.
+//==============================================================================
+bool oraFilter::wantedSignatures(const vector<string> &signatures)
+{
+    if (mSignatures.empty()) {
+        return true;
+    }
+
+    for (auto want = mSignatures.begin(); want != mSignatures.end(); want++) {
+        for (auto sig = signatures.begin(); sig != signatures.end(); sig++) {
+            if (sig->compare(0, want->size(), *want) == 0) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+//==============================================================================
+//                                                               wantedSession()
+//------------------------------------------------------------------------------
+// Is this one of the wanted sessions (SIDs)?
+//==============================================================================
+bool oraFilter::wantedSession(const unsigned session)
+{
+    return find(mSessions.begin(), mSessions.end(), session) != mSessions.end();
+}
+
+//==============================================================================
+//                                                              wantedObjectId()
+//------------------------------------------------------------------------------
+// Is this one of the wanted object ids?
+//==============================================================================
+bool oraFilter::wantedObjectId(const unsigned objectId)
+{
+    return find(mObjectIds.begin(), mObjectIds.end(), objectId) != mObjectIds.end();
+}
+
+//==============================================================================
+//                                                                daysFromCivil()
+//------------------------------------------------------------------------------
+// Days since 1970-01-01 for a given date. Howard Hinnant's algorithm, which
+// saves dragging in mktime() and its timezones.
+//==============================================================================
+static long long daysFromCivil(long long y, const unsigned m, const unsigned d)
+{
+    y -= m <= 2;
+    const long long era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long long>(doe) - 719468;
+}
+
+//==============================================================================
+//                                                                civilFromDays()
+//------------------------------------------------------------------------------
+// And back again. The date for a number of days since 1970-01-01.
+//==============================================================================
+static void civilFromDays(long long days, long long &y, unsigned &m, unsigned &d)
+{
+    days += 719468;
+    const long long era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<long long>(yoe) + era * 400 + (m <= 2);
+}
+
+//==============================================================================
+//                                                                      digits()
+//------------------------------------------------------------------------------
+// Converts count digits at text[pos] into a number. Returns false if they are
+// not all digits, or we run out of text.
+//==============================================================================
+static bool digits(const char *text, const size_t length, const size_t pos,
+                   const unsigned count, unsigned &value)
+{
+    if (pos + count > length) {
+        return false;
+    }
+
+    value = 0;
+    for (unsigned x = 0; x < count; x++) {
+        char c = text[pos + x];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                              parseTimestamp()
+//------------------------------------------------------------------------------
+// Converts "YYYY-MM-DD HH:MM:SS" into seconds since 1970. The time, or just
+// the seconds, can be omitted. A 'T' may separate the date and time, and
+// anything after the seconds, fractions for example, is ignored.
+//==============================================================================
+bool oraFilter::parseTimestamp(const char *text, const size_t length, long long &when)
+{
+    unsigned year, month, day;
+    unsigned hour = 0, minute = 0, second = 0;
+
+    if (!digits(text, length, 0, 4, year) || length < 10 || text[4] != '-' ||
+        !digits(text, length, 5, 2, month) || text[7] != '-' ||
+        !digits(text, length, 8, 2, day)) {
+        return false;
+    }
+
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+
+    if (length > 10 && (text[10] == ' ' || text[10] == 'T')) {
+        if (!digits(text, length, 11, 2, hour) || length < 16 || text[13] != ':' ||
+            !digits(text, length, 14, 2, minute)) {
+            return false;
+        }
+
+        if (length > 16 && text[16] == ':' && !digits(text, length, 17, 2, second)) {
+            return false;
+        }
+    }
+
+    when = daysFromCivil(year, month, day) * 86400LL + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+bool oraFilter::parseTimestamp(const string &text, long long &when)
+{
+    return parseTimestamp(text.data(), text.size(), when);
+}
+
+//==============================================================================
+//                                                             formatTimestamp()
+//------------------------------------------------------------------------------
+// Converts seconds since 1970 back into "YYYY-MM-DD HH:MM:SS".
+//==============================================================================
+string oraFilter::formatTimestamp(const long long when)
+{
+    long long days = when / 86400;
+    long long seconds = when % 86400;
+    if (seconds < 0) {
+        seconds += 86400;
+        days--;
+    }
+
+    long long year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    char buffer[48];
+    std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u %02lld:%02lld:%02lld",
+                  year, month, day, seconds / 3600, (seconds / 60) % 60, seconds % 60);
+    return buffer;
+}
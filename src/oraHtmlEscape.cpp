@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraHtmlEscape.h"
+
+#include <cstring>
+
+// Build with -DDEADLOCK_NO_SIMD to leave SSE2 out.
+#if defined(__SSE2__) && !defined(DEADLOCK_NO_SIMD)
+    #include <emmintrin.h>
+    #define HTML_ESCAPE_SSE2
+#endif
+
+//==============================================================================
+//                                                                 replacement()
+//------------------------------------------------------------------------------
+// The entity for a special character, or nullptr if it isn't one.
+//==============================================================================
+static inline const char *replacement(const char c)
+{
+    switch (c) {
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        case '&': return "&amp;";
+        case '"': return "&quot;";
+        default: return nullptr;
+    }
+}
+
+//==============================================================================
+//                                                                       write()
+//------------------------------------------------------------------------------
+// Writes length bytes of text, escaped. Everything up to a special character
+// goes out in one write, then its entity, and so on.
+//==============================================================================
+void oraHtmlEscape::write(ostream &out, const char *text, const size_t length)
+{
+    const char *clean = text;           // Not written yet.
+    const char *next = text;            // Not checked yet.
+    const char *end = text + length;
+
+#ifdef HTML_ESCAPE_SSE2
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i quot = _mm_set1_epi8('"');
+
+    for (; end - next >= 16; next += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(next));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, lt),
+                                                 _mm_cmpeq_epi8(chunk, gt)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, amp),
+                                                 _mm_cmpeq_epi8(chunk, quot)));
+
+        // One bit per byte, set for the special ones, first byte lowest.
+        unsigned mask = _mm_movemask_epi8(hits);
+        while (mask) {
+            const char *special = next + __builtin_ctz(mask);
+            const char *entity = replacement(*special);
+            out.write(clean, special - clean);
+            out.write(entity, std::strlen(entity));
+            clean = special + 1;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // The tail, or everything, a byte at a time.
+    for (; next < end; next++) {
+        const char *entity = replacement(*next);
+        if (entity) {
+            out.write(clean, next - clean);
+            out.write(entity, std::strlen(entity));
+            clean = next + 1;
+        }
+    }
+
+    out.write(clean, end - clean);
+}
+
+//==============================================================================
+//                                                                   Operator <<
+//------------------------------------------------------------------------------
+// Writes the text escaped, or the ifEmpty text, as is, if there isn't any.
+//==============================================================================
+ostream &operator<<(ostream &out, const oraHtmlEscape &escape)
+{
+    if (escape.mText.empty()) {
+        out << escape.mIfEmpty;
+    } else {
+        oraHtmlEscape::write(out, escape.mText.data(), escape.mText.size());
+    }
+
+    return out;
+}
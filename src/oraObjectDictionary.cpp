@@ -0,0 +1,394 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraObjectDictionary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DICTIONARY_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::cerr;
+using std::endl;
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraObjectDictionary::oraObjectDictionary()
+{
+    mData = nullptr;
+    mLength = 0;
+    mMapped = false;
+    mRecords = nullptr;
+    mCount = 0;
+    mStrings = nullptr;
+    mStringsLength = 0;
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraObjectDictionary::~oraObjectDictionary()
+{
+    close();
+}
+
+//==============================================================================
+//                                                                       close()
+//==============================================================================
+void oraObjectDictionary::close()
+{
+#ifdef DICTIONARY_MMAP
+    if (mMapped) {
+        munmap(const_cast<char *>(mData), mLength);
+    }
+#endif
+
+    mCopy.clear();
+    mData = nullptr;
+    mLength = 0;
+    mMapped = false;
+    mRecords = nullptr;
+    mCount = 0;
+    mStrings = nullptr;
+    mStringsLength = 0;
+}
+
+//==============================================================================
+//                                                                   csvFields()
+//------------------------------------------------------------------------------
+// Reads one CSV record, which can be more than one line if a quoted field has
+// a newline in it. Quotes are removed, and "" becomes ". Returns false at EOF.
+//==============================================================================
+static bool csvFields(std::istream &in, vector<string> &fields)
+{
+    string line;
+    if (!getline(in, line)) {
+        return false;
+    }
+
+    fields.clear();
+    fields.push_back(string());
+    bool quoted = false;
+
+    for (size_t x = 0; ; x++) {
+        if (x == line.size()) {
+            // A newline inside quotes is part of the field.
+            if (quoted && in.good()) {
+                string more;
+                if (getline(in, more)) {
+                    fields.back() += '\n';
+                    line = more;
+                    x = static_cast<size_t>(-1);
+                    continue;
+                }
+            }
+            break;
+        }
+
+        char c = line[x];
+        if (quoted) {
+            if (c == '"') {
+                if (x + 1 < line.size() && line[x + 1] == '"') {
+                    fields.back() += '"';
+                    x++;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                fields.back() += c;
+            }
+            continue;
+        }
+
+        if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(string());
+        } else if (c != '\r') {
+            fields.back() += c;
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                     compile()
+//------------------------------------------------------------------------------
+// Compiles a DBA_OBJECTS export into a dictionary file. The CSV must have a
+// heading line with at least OBJECT_ID, OWNER and OBJECT_NAME. OBJECT_TYPE,
+// and SUBOBJECT_NAME, for partitions, are used if they are there. Any other
+// columns are ignored, in any order. Returns false, having said why, if the
+// dictionary couldn't be written.
+//
+// The dictionary is written under a temporary name and renamed into place, a
+// running daemon may have the old one mapped, and would die if it shrank.
+//==============================================================================
+bool oraObjectDictionary::compile(const string &csvName, const string &dictionaryName)
+{
+    std::ifstream csv(csvName, std::ios::binary);
+    if (!csv.good()) {
+        cerr << "Cannot open " << csvName << endl;
+        return false;
+    }
+
+    // Which columns are which?
+    vector<string> fields;
+    if (!csvFields(csv, fields)) {
+        cerr << csvName << " is empty." << endl;
+        return false;
+    }
+
+    int idColumn = -1, ownerColumn = -1, nameColumn = -1, typeColumn = -1, subColumn = -1;
+    for (size_t x = 0; x < fields.size(); x++) {
+        string heading = fields[x];
+        std::transform(heading.begin(), heading.end(), heading.begin(), ::toupper);
+        if (heading == "OBJECT_ID") {
+            idColumn = x;
+        } else if (heading == "OWNER") {
+            ownerColumn = x;
+        } else if (heading == "OBJECT_NAME") {
+            nameColumn = x;
+        } else if (heading == "OBJECT_TYPE") {
+            typeColumn = x;
+        } else if (heading == "SUBOBJECT_NAME") {
+            subColumn = x;
+        }
+    }
+
+    if (idColumn < 0 || ownerColumn < 0 || nameColumn < 0) {
+        cerr << csvName << " needs OBJECT_ID, OWNER and OBJECT_NAME columns." << endl;
+        return false;
+    }
+
+    // Build the records, and the string pool. Offset zero is "".
+    vector<record> records;
+    string strings(1, '\0');
+    std::unordered_map<string, uint32_t> shared;
+    unsigned long long skipped = 0;
+
+    auto addString = [&strings](const string &s) -> uint64_t {
+        uint64_t offset = strings.size();
+        strings += s;
+        strings += '\0';
+        return offset;
+    };
+
+    auto addShared = [&shared, &addString](const string &s) -> uint64_t {
+        auto found = shared.find(s);
+        if (found != shared.end()) {
+            return found->second;
+        }
+
+        uint64_t offset = addString(s);
+        shared[s] = offset;
+        return offset;
+    };
+
+    size_t columns = std::max({idColumn, ownerColumn, nameColumn, typeColumn, subColumn}) + 1;
+    while (csvFields(csv, fields)) {
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue;
+        }
+
+        // Short lines, and ids that aren't numbers, are skipped.
+        if (fields.size() < columns || fields[idColumn].empty()) {
+            skipped++;
+            continue;
+        }
+
+        char *end;
+        unsigned long objectId = std::strtoul(fields[idColumn].c_str(), &end, 10);
+        if (*end != '\0' || objectId > UINT32_MAX) {
+            skipped++;
+            continue;
+        }
+
+        string name = fields[nameColumn];
+        if (subColumn >= 0 && !fields[subColumn].empty()) {
+            name += ':' + fields[subColumn];
+        }
+
+        record r;
+        r.objectId = objectId;
+        uint64_t owner = addShared(fields[ownerColumn]);
+        uint64_t type = (typeColumn >= 0) ? addShared(fields[typeColumn]) : 0;
+        uint64_t nameOffset = addString(name);
+        if (strings.size() > UINT32_MAX) {
+            cerr << csvName << " has too many names for a dictionary file." << endl;
+            return false;
+        }
+
+        r.owner = owner;
+        r.name = nameOffset;
+        r.type = type;
+        records.push_back(r);
+    }
+
+    // Sorted, for the binary search. Object ids are unique, but just in case,
+    // only the first of any duplicates is kept.
+    std::stable_sort(records.begin(), records.end(),
+                     [](const record &a, const record &b) { return a.objectId < b.objectId; });
+    auto last = std::unique(records.begin(), records.end(),
+                            [](const record &a, const record &b) { return a.objectId == b.objectId; });
+    skipped += records.end() - last;
+    records.erase(last, records.end());
+
+    header h;
+    std::memcpy(h.magic, OBJECT_DICTIONARY_MAGIC, sizeof(h.magic));
+    h.count = records.size();
+    h.stringsLength = strings.size();
+
+    string tempName = dictionaryName + ".tmp";
+    {
+        std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(record));
+        out.write(strings.data(), strings.size());
+        out.close();
+        if (out.fail()) {
+            cerr << "Cannot write " << tempName << endl;
+            std::remove(tempName.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    // Windows won't rename over an existing file.
+    std::remove(dictionaryName.c_str());
+#endif
+
+    if (std::rename(tempName.c_str(), dictionaryName.c_str()) != 0) {
+        cerr << "Cannot rename " << tempName << " to " << dictionaryName << endl;
+        std::remove(tempName.c_str());
+        return false;
+    }
+
+    cerr << "Compiled " << records.size() << " object(s) into " << dictionaryName;
+    if (skipped) {
+        cerr << ", skipped " << skipped << " invalid or duplicate line(s)";
+    }
+    cerr << '.' << endl;
+    return true;
+}
+
+//==============================================================================
+//                                                                        open()
+//------------------------------------------------------------------------------
+// Maps a compiled dictionary file. Returns false, having said why, if it can't
+// be used.
+//==============================================================================
+bool oraObjectDictionary::open(const string &dictionaryName)
+{
+    close();
+
+#ifdef DICTIONARY_MMAP
+    int fd = ::open(dictionaryName.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) {
+                mData = static_cast<const char *>(mapped);
+                mLength = st.st_size;
+                mMapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    // No mmap()? Read it all in, then.
+    if (!mData) {
+        std::ifstream in(dictionaryName, std::ios::binary | std::ios::ate);
+        if (in.good()) {
+            mCopy.resize(in.tellg());
+            in.seekg(0);
+            in.read(mCopy.data(), mCopy.size());
+            if (in.good()) {
+                mData = mCopy.data();
+                mLength = mCopy.size();
+            }
+        }
+    }
+
+    if (!mData) {
+        cerr << "Cannot open object dictionary " << dictionaryName << endl;
+        return false;
+    }
+
+    // Is it one of ours, and all there?
+    const header *h = reinterpret_cast<const header *>(mData);
+    if (mLength < sizeof(header) ||
+        std::memcmp(h->magic, OBJECT_DICTIONARY_MAGIC, sizeof(h->magic)) != 0 ||
+        h->count > mLength / sizeof(record) || h->stringsLength == 0 ||
+        mLength != sizeof(header) + h->count * sizeof(record) + h->stringsLength ||
+        mData[mLength - 1] != '\0') {
+        cerr << dictionaryName << " is not a valid object dictionary." << endl;
+        close();
+        return false;
+    }
+
+    mCount = h->count;
+    mRecords = reinterpret_cast<const record *>(mData + sizeof(header));
+    mStringsLength = h->stringsLength;
+    mStrings = mData + sizeof(header) + mCount * sizeof(record);
+    return true;
+}
+
+//==============================================================================
+//                                                                      lookup()
+//------------------------------------------------------------------------------
+// Finds an object's owner, name and type, which point into the dictionary, so
+// are only valid while it's open. Returns false if it's not there.
+//==============================================================================
+bool oraObjectDictionary::lookup(const unsigned objectId, const char *&owner,
+                                 const char *&name, const char *&type) const
+{
+    const record *end = mRecords + mCount;
+    const record *found = std::lower_bound(mRecords, end, objectId,
+        [](const record &r, const unsigned id) { return r.objectId < id; });
+
+    if (found == end || found->objectId != objectId ||
+        found->owner >= mStringsLength || found->name >= mStringsLength ||
+        found->type >= mStringsLength) {
+        return false;
+    }
+
+    owner = mStrings + found->owner;
+    name = mStrings + found->name;
+    type = mStrings + found->type;
+    return true;
+}
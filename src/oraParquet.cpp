@@ -0,0 +1,495 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraParquet.h"
+
+#include <iostream>
+
+using std::cerr;
+using std::endl;
+
+// Parquet's enumerations, from parquet.thrift, those we use anyway.
+#define PARQUET_BOOLEAN 0
+#define PARQUET_INT32 1
+#define PARQUET_INT64 2
+#define PARQUET_BYTE_ARRAY 6
+
+#define PARQUET_REQUIRED 0
+
+#define PARQUET_UTF8 0
+#define PARQUET_TIMESTAMP_MILLIS 9
+
+#define PARQUET_PLAIN 0
+#define PARQUET_PLAIN_DICTIONARY 2
+#define PARQUET_RLE 3
+
+#define PARQUET_DATA_PAGE 0
+#define PARQUET_DICTIONARY_PAGE 2
+
+#define PARQUET_UNCOMPRESSED 0
+
+// Thrift compact protocol types.
+#define THRIFT_TRUE 1
+#define THRIFT_FALSE 2
+#define THRIFT_I32 5
+#define THRIFT_I64 6
+#define THRIFT_BINARY 8
+#define THRIFT_LIST 9
+#define THRIFT_STRUCT 12
+
+//==============================================================================
+// Just enough of the Thrift compact protocol to write Parquet's metadata.
+// Field ids are written as deltas from the previous field in the same struct,
+// so each struct remembers its last one.
+//==============================================================================
+class thriftWriter
+{
+    public:
+        thriftWriter() { mLastField.push_back(0); }
+        const string &bytes() const { return mOut; }
+
+        void varint(uint64_t value) {
+            while (value >= 0x80) {
+                mOut += static_cast<char>((value & 0x7F) | 0x80);
+                value >>= 7;
+            }
+            mOut += static_cast<char>(value);
+        }
+
+        void zigzag(const int64_t value) {
+            varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+        }
+
+        void field(const int id, const int type) {
+            int delta = id - mLastField.back();
+            if (delta > 0 && delta <= 15) {
+                mOut += static_cast<char>((delta << 4) | type);
+            } else {
+                mOut += static_cast<char>(type);
+                zigzag(id);
+            }
+            mLastField.back() = id;
+        }
+
+        void i32(const int id, const int32_t value) { field(id, THRIFT_I32); zigzag(value); }
+        void i64(const int id, const int64_t value) { field(id, THRIFT_I64); zigzag(value); }
+        void boolean(const int id, const bool value) { field(id, value ? THRIFT_TRUE : THRIFT_FALSE); }
+        void binary(const string &value) { varint(value.size()); mOut += value; }
+        void binary(const int id, const string &value) { field(id, THRIFT_BINARY); binary(value); }
+
+        void list(const int id, const int elementType, const size_t size) {
+            field(id, THRIFT_LIST);
+            if (size < 15) {
+                mOut += static_cast<char>((size << 4) | elementType);
+            } else {
+                mOut += static_cast<char>(0xF0 | elementType);
+                varint(size);
+            }
+        }
+
+        // A struct, as a field, or a list element if id is zero.
+        void structBegin(const int id = 0) {
+            if (id) {
+                field(id, THRIFT_STRUCT);
+            }
+            mLastField.push_back(0);
+        }
+
+        void structEnd() {
+            mOut += '\0';
+            mLastField.pop_back();
+        }
+
+    private:
+        string mOut;
+        vector<int> mLastField;
+};
+
+//==============================================================================
+//                                                                    little*()
+//------------------------------------------------------------------------------
+// Appends a little endian integer, whatever this machine is.
+//==============================================================================
+static void little32(string &out, const uint32_t value)
+{
+    for (int x = 0; x < 4; x++) {
+        out += static_cast<char>((value >> (8 * x)) & 0xFF);
+    }
+}
+
+static void little64(string &out, const uint64_t value)
+{
+    for (int x = 0; x < 8; x++) {
+        out += static_cast<char>((value >> (8 * x)) & 0xFF);
+    }
+}
+
+//==============================================================================
+//                                                                   bitPacked()
+//------------------------------------------------------------------------------
+// Encodes dictionary indices as a single bit packed run of the RLE/bit packing
+// hybrid, preceded by the bit width. Runs are groups of eight, padded with
+// zeros. The page header says how many are real.
+//==============================================================================
+static string bitPacked(const vector<uint32_t> &indices, const uint32_t dictionarySize)
+{
+    unsigned width = 1;
+    while (width < 32 && (1ULL << width) < dictionarySize) {
+        width++;
+    }
+
+    string out(1, static_cast<char>(width));
+    size_t groups = (indices.size() + 7) / 8;
+
+    // The run header is a varint, groups << 1 | 1.
+    uint64_t header = (static_cast<uint64_t>(groups) << 1) | 1;
+    while (header >= 0x80) {
+        out += static_cast<char>((header & 0x7F) | 0x80);
+        header >>= 7;
+    }
+    out += static_cast<char>(header);
+
+    uint64_t buffer = 0;
+    unsigned bits = 0;
+    for (size_t x = 0; x < groups * 8; x++) {
+        buffer |= static_cast<uint64_t>(x < indices.size() ? indices[x] : 0) << bits;
+        bits += width;
+        while (bits >= 8) {
+            out += static_cast<char>(buffer & 0xFF);
+            buffer >>= 8;
+            bits -= 8;
+        }
+    }
+
+    return out;
+}
+
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// Creates the file. Check good() before going any further.
+//==============================================================================
+oraParquetWriter::oraParquetWriter(const string &fileName, const string &createdBy) :
+    mFile(fileName, std::ios::binary),
+    mCreatedBy(createdBy)
+{
+    mOffset = 0;
+    mNextColumn = 0;
+    mRows = 0;
+    mGroupRows = 0;
+    mGroupBytes = 0;
+    mClosed = false;
+
+    write("PAR1");
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraParquetWriter::~oraParquetWriter()
+{
+    close();
+}
+
+//==============================================================================
+//                                                                   addColumn()
+//------------------------------------------------------------------------------
+// Adds a column to the schema. Only before the first row.
+//==============================================================================
+void oraParquetWriter::addColumn(const string &name, const columnType type)
+{
+    column c;
+    c.name = name;
+    c.type = type;
+    mColumns.push_back(c);
+}
+
+//==============================================================================
+//                                                                         add()
+//------------------------------------------------------------------------------
+// Adds the next column's value to the current row. Numbers for the number,
+// timestamp and boolean columns, strings for the string columns.
+//==============================================================================
+void oraParquetWriter::add(const long long value)
+{
+    column &c = mColumns[mNextColumn++];
+    switch (c.type) {
+        case int32Column:
+            little32(c.values, static_cast<uint32_t>(value));
+            break;
+
+        case boolColumn:
+            c.values += static_cast<char>(value != 0);
+            break;
+
+        default:
+            little64(c.values, static_cast<uint64_t>(value));
+    }
+}
+
+void oraParquetWriter::add(const string &value)
+{
+    column &c = mColumns[mNextColumn++];
+    if (c.type == dictionaryColumn) {
+        auto found = c.dictionary.find(value);
+        if (found == c.dictionary.end()) {
+            found = c.dictionary.insert(std::make_pair(value, static_cast<uint32_t>(c.dictionary.size()))).first;
+            little32(c.dictionaryValues, value.size());
+            c.dictionaryValues += value;
+            mGroupBytes += value.size() + 4;
+        }
+        c.indices.push_back(found->second);
+        return;
+    }
+
+    little32(c.values, value.size());
+    c.values += value;
+    mGroupBytes += value.size() + 4;
+}
+
+//==============================================================================
+//                                                                      endRow()
+//------------------------------------------------------------------------------
+// Finishes a row, and writes the row group if it's big enough.
+//==============================================================================
+void oraParquetWriter::endRow()
+{
+    mNextColumn = 0;
+    mRows++;
+    mGroupRows++;
+    mGroupBytes += 8 * mColumns.size();
+
+    if (mGroupRows >= PARQUET_ROW_GROUP_ROWS || mGroupBytes >= PARQUET_ROW_GROUP_BYTES) {
+        writeRowGroup();
+    }
+}
+
+//==============================================================================
+//                                                                       write()
+//------------------------------------------------------------------------------
+// Writes to the file, keeping count of where we are.
+//==============================================================================
+void oraParquetWriter::write(const string &bytes)
+{
+    mFile.write(bytes.data(), bytes.size());
+    mOffset += bytes.size();
+}
+
+//==============================================================================
+//                                                                   writePage()
+//------------------------------------------------------------------------------
+// Writes a page header, then the page.
+//==============================================================================
+void oraParquetWriter::writePage(const int pageType, const uint32_t values, const int encoding,
+                                 const string &data)
+{
+    thriftWriter header;
+    header.i32(1, pageType);
+    header.i32(2, data.size());
+    header.i32(3, data.size());
+
+    if (pageType == PARQUET_DICTIONARY_PAGE) {
+        header.structBegin(7);
+        header.i32(1, values);
+        header.i32(2, encoding);
+        header.structEnd();
+    } else {
+        header.structBegin(5);
+        header.i32(1, values);
+        header.i32(2, encoding);
+        header.i32(3, PARQUET_RLE);
+        header.i32(4, PARQUET_RLE);
+        header.structEnd();
+    }
+
+    header.structEnd();
+    write(header.bytes());
+    write(data);
+}
+
+//==============================================================================
+//                                                               writeRowGroup()
+//------------------------------------------------------------------------------
+// Writes each column's values, as one column chunk, and starts again.
+//==============================================================================
+void oraParquetWriter::writeRowGroup()
+{
+    if (!mGroupRows) {
+        return;
+    }
+
+    uint64_t groupStart = mOffset;
+    for (auto c = mColumns.begin(); c != mColumns.end(); c++) {
+        chunkInfo chunk;
+        chunk.start = mOffset;
+        chunk.values = mGroupRows;
+        chunk.dictionaryPageOffset = 0;
+
+        if (c->type == dictionaryColumn) {
+            chunk.dictionaryPageOffset = mOffset;
+            writePage(PARQUET_DICTIONARY_PAGE, c->dictionary.size(), PARQUET_PLAIN_DICTIONARY,
+                      c->dictionaryValues);
+            chunk.dataPageOffset = mOffset;
+            writePage(PARQUET_DATA_PAGE, mGroupRows, PARQUET_PLAIN_DICTIONARY,
+                      bitPacked(c->indices, c->dictionary.size()));
+        } else if (c->type == boolColumn) {
+            // One bit each, first value in the lowest bit.
+            string bits((c->values.size() + 7) / 8, '\0');
+            for (size_t x = 0; x < c->values.size(); x++) {
+                if (c->values[x]) {
+                    bits[x / 8] |= static_cast<char>(1 << (x % 8));
+                }
+            }
+            chunk.dataPageOffset = mOffset;
+            writePage(PARQUET_DATA_PAGE, mGroupRows, PARQUET_PLAIN, bits);
+        } else {
+            chunk.dataPageOffset = mOffset;
+            writePage(PARQUET_DATA_PAGE, mGroupRows, PARQUET_PLAIN, c->values);
+        }
+
+        chunk.size = mOffset - chunk.start;
+        c->chunks.push_back(chunk);
+
+        // Dictionaries are per row group, so memory doesn't grow.
+        c->values.clear();
+        c->indices.clear();
+        c->dictionary.clear();
+        c->dictionaryValues.clear();
+    }
+
+    mRowGroups.push_back(rowGroupInfo{mGroupRows, mOffset - groupStart});
+    mGroupRows = 0;
+    mGroupBytes = 0;
+}
+
+//==============================================================================
+//                                                                      footer()
+//------------------------------------------------------------------------------
+// The file metadata. The schema, and where every column chunk is.
+//==============================================================================
+string oraParquetWriter::footer()
+{
+    thriftWriter meta;
+    meta.i32(1, 1);
+
+    // The schema is a root, then the columns.
+    meta.list(2, THRIFT_STRUCT, mColumns.size() + 1);
+    meta.structBegin();
+    meta.binary(4, "schema");
+    meta.i32(5, mColumns.size());
+    meta.structEnd();
+
+    for (auto c = mColumns.begin(); c != mColumns.end(); c++) {
+        int type = PARQUET_BYTE_ARRAY;
+        switch (c->type) {
+            case int32Column: type = PARQUET_INT32; break;
+            case int64Column:
+            case timestampColumn: type = PARQUET_INT64; break;
+            case boolColumn: type = PARQUET_BOOLEAN; break;
+            default: break;
+        }
+
+        meta.structBegin();
+        meta.i32(1, type);
+        meta.i32(3, PARQUET_REQUIRED);
+        meta.binary(4, c->name);
+        if (c->type == stringColumn || c->type == dictionaryColumn) {
+            meta.i32(6, PARQUET_UTF8);
+        } else if (c->type == timestampColumn) {
+            meta.i32(6, PARQUET_TIMESTAMP_MILLIS);
+        }
+        meta.structEnd();
+    }
+
+    meta.i64(3, mRows);
+
+    meta.list(4, THRIFT_STRUCT, mRowGroups.size());
+    for (size_t g = 0; g < mRowGroups.size(); g++) {
+        meta.structBegin();
+        meta.list(1, THRIFT_STRUCT, mColumns.size());
+
+        for (auto c = mColumns.begin(); c != mColumns.end(); c++) {
+            const chunkInfo &chunk = c->chunks[g];
+            bool dictionary = (c->type == dictionaryColumn);
+            int type = (c->type == int32Column ? PARQUET_INT32 :
+                        c->type == int64Column || c->type == timestampColumn ? PARQUET_INT64 :
+                        c->type == boolColumn ? PARQUET_BOOLEAN : PARQUET_BYTE_ARRAY);
+
+            meta.structBegin();
+            meta.i64(2, chunk.start);
+            meta.structBegin(3);
+            meta.i32(1, type);
+            meta.list(2, THRIFT_I32, 1);
+            meta.zigzag(dictionary ? PARQUET_PLAIN_DICTIONARY : PARQUET_PLAIN);
+            meta.list(3, THRIFT_BINARY, 1);
+            meta.binary(c->name);
+            meta.i32(4, PARQUET_UNCOMPRESSED);
+            meta.i64(5, chunk.values);
+            meta.i64(6, chunk.size);
+            meta.i64(7, chunk.size);
+            meta.i64(9, chunk.dataPageOffset);
+            if (dictionary) {
+                meta.i64(11, chunk.dictionaryPageOffset);
+            }
+            meta.structEnd();
+            meta.structEnd();
+        }
+
+        meta.i64(2, mRowGroups[g].bytes);
+        meta.i64(3, mRowGroups[g].rows);
+        meta.structEnd();
+    }
+
+    meta.binary(6, mCreatedBy);
+    meta.structEnd();
+    return meta.bytes();
+}
+
+//==============================================================================
+//                                                                       close()
+//------------------------------------------------------------------------------
+// Writes the last row group, and the footer. False if anything couldn't be
+// written.
+//==============================================================================
+bool oraParquetWriter::close()
+{
+    if (mClosed) {
+        return good();
+    }
+
+    mClosed = true;
+    writeRowGroup();
+
+    string meta = footer();
+    write(meta);
+
+    string tail;
+    little32(tail, meta.size());
+    tail += "PAR1";
+    write(tail);
+
+    mFile.close();
+    return !mFile.fail();
+}
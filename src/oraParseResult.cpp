@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraParseResult.h"
+
+#include <utility>
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// Takes the details, and the deadlocks, from a parsed trace file.
+//==============================================================================
+oraParseResult::oraParseResult(oraTraceFile &traceFile):
+    mTraceName(traceFile.mTraceName),
+    mOriginalPath(traceFile.mOriginalPath),
+    mInstanceName(traceFile.mInstanceName),
+    mOracleHome(traceFile.mOracleHome),
+    mSystemName(traceFile.mSystemName),
+    mServerName(traceFile.mServerName),
+    mTimedOut(traceFile.cancelled()),
+    mDeadlocks(std::move(traceFile.mDeadlocks)),
+    mText(traceFile.mText)
+{
+    traceFile.mDeadlocks.clear();
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraParseResult::~oraParseResult()
+{
+    //dtor
+}
+
+//==============================================================================
+//                                                                    deadLock()
+//------------------------------------------------------------------------------
+// Returns one of the deadlocks, or nullptr if there isn't one at that index.
+//==============================================================================
+const oraDeadlock *oraParseResult::deadLock(const unsigned index) const
+{
+    if (index >= mDeadlocks.size()) {
+        return nullptr;
+    }
+
+    return &mDeadlocks[index];
+}
+
+//==============================================================================
+//                                                                     excerpt()
+//------------------------------------------------------------------------------
+// Returns the raw text of the trace file for one deadlock.
+//==============================================================================
+string oraParseResult::excerpt(const oraDeadlock *dl) const
+{
+    return mText->excerpt(dl->startOffset(), dl->endOffset());
+}
+
+//==============================================================================
+//                                                                  outputName()
+//------------------------------------------------------------------------------
+// The trace file name, with its extension replaced by this one, ".html" say.
+//==============================================================================
+string oraParseResult::outputName(const string &extension) const
+{
+    auto pos = mTraceName.find_last_of('.');
+    return mTraceName.substr(0, pos) + extension;
+}
+
+//==============================================================================
+//                                                                      toJSON()
+//------------------------------------------------------------------------------
+// Writes the trace file details, and all its deadlocks, as one JSON object.
+//==============================================================================
+void oraParseResult::toJSON(ostream &out) const
+{
+    out << "{\n"
+        << "  \"trace\": " << jsonString(mTraceName) << ",\n"
+        << "  \"originalPath\": " << jsonString(mOriginalPath) << ",\n"
+        << "  \"instance\": " << jsonString(mInstanceName) << ",\n"
+        << "  \"server\": " << jsonString(mServerName) << ",\n"
+        << "  \"system\": " << jsonString(mSystemName) << ",\n"
+        << "  \"oracleHome\": " << jsonString(mOracleHome) << ",\n"
+        << "  \"deadlockCount\": " << mDeadlocks.size() << ",\n"
+        << "  \"timedOut\": " << (mTimedOut ? "true" : "false") << ",\n"
+        << "  \"deadlocks\": [";
+
+    for (auto d = mDeadlocks.begin(); d != mDeadlocks.end(); d++) {
+        out << (d == mDeadlocks.begin() ? "\n" : ",\n");
+        d->toJSON(out, "    ");
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+//==============================================================================
+//                                                                       toCSV()
+//------------------------------------------------------------------------------
+// Writes all the deadlocks as CSV, with a heading line. Deadlocks are numbered
+// as they are in the report.
+//==============================================================================
+void oraParseResult::toCSV(ostream &out) const
+{
+    oraDeadlock::csvHeader(out);
+    for (unsigned x = 0; x < mDeadlocks.size(); x++) {
+        mDeadlocks[x].toCSV(out, x + 1);
+    }
+}
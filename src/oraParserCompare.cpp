@@ -0,0 +1,279 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraParserCompare.h"
+#include "oraTraceFile.h"
+#include "oraParseResult.h"
+#include "oraWaitEvent.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+
+using std::endl;
+using std::to_string;
+
+typedef std::chrono::steady_clock compareClock;
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// The results go to out. The deadlock budget is passed on to oraTraceFile, as
+// --max-deadlock-bytes would be.
+//==============================================================================
+oraParserCompare::oraParserCompare(ostream &out, const unsigned long long deadlockBudget) :
+    mOut(out),
+    mDeadlockBudget(deadlockBudget)
+{
+    mFileMismatches = 0;
+    mMismatches = 0;
+    mFiles = 0;
+    mReferenceSeconds = 0.0;
+    mOptimisedSeconds = 0.0;
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraParserCompare::~oraParserCompare()
+{
+}
+
+//==============================================================================
+//                                                                     compare()
+//------------------------------------------------------------------------------
+// Parses one trace file both ways, and compares the results. Returns false if
+// the trace file can't be read, or anything didn't match.
+//==============================================================================
+bool oraParserCompare::compare(const string &traceName)
+{
+    mTraceName = traceName;
+    mFileMismatches = 0;
+
+    // The reference first, so that the optimised parser doesn't get the
+    // benefit of a cold cache.
+    auto started = compareClock::now();
+    oraReferenceParser reference(traceName);
+    if (!reference.good()) {
+        mOut << traceName << ": cannot open tracefile.\n";
+        return false;
+    }
+    reference.parse();
+    std::chrono::duration<double> referenceTook = compareClock::now() - started;
+
+    // Exactly as a normal run does it, but quietly, as the reference is, or
+    // we would be timing stderr.
+    started = compareClock::now();
+    oraTraceFile traceFile(traceName);
+    traceFile.setVerbose(false);
+    traceFile.setDeadlockBudget(mDeadlockBudget);
+    traceFile.parse();
+    oraParseResult result(traceFile);
+    std::chrono::duration<double> optimisedTook = compareClock::now() - started;
+
+    mFiles++;
+    mReferenceSeconds += referenceTook.count();
+    mOptimisedSeconds += optimisedTook.count();
+
+    // Match them up by line number. Both are in trace file order.
+    const vector<oraReferenceDeadlock> &refs = reference.deadlocks();
+    unsigned compared = 0, skipped = 0, extra = 0;
+    unsigned r = 0, o = 0;
+    while (r < refs.size() || o < result.deadlockCount()) {
+        const oraDeadlock *dl = (o < result.deadlockCount() ? result.deadLock(o) : nullptr);
+
+        // Found only by the optimised parser. The reference loses its way
+        // after a broken deadlock, so that's not a regression.
+        if (dl && (r == refs.size() || dl->lineNumber() < refs[r].lineNumber)) {
+            extra++;
+            o++;
+            continue;
+        }
+
+        if (!dl || refs[r].lineNumber < dl->lineNumber()) {
+            if (refs[r].complete) {
+                mismatch(refs[r].lineNumber, "deadlock", "found", "missing");
+            } else {
+                skipped++;
+            }
+            r++;
+            continue;
+        }
+
+        if (refs[r].complete && !dl->global()) {
+            compareDeadlock(refs[r], *dl);
+            compared++;
+        } else {
+            skipped++;
+        }
+        r++;
+        o++;
+    }
+
+    if (mFileMismatches > COMPARE_MAX_LISTED) {
+        mOut << "\t... and " << mFileMismatches - COMPARE_MAX_LISTED << " more.\n";
+    }
+
+    mOut << traceName << ": " << compared << " deadlock(s) compared, "
+         << skipped << " skipped, " << extra << " extra, " << mFileMismatches << " mismatch(es). "
+         << std::fixed << std::setprecision(1)
+         << "Reference " << referenceTook.count() * 1000.0 << "ms, "
+         << "optimised " << optimisedTook.count() * 1000.0 << "ms, "
+         << std::setprecision(2)
+         << referenceTook.count() / std::max(optimisedTook.count(), 1e-9) << "x speedup."
+         << endl;
+
+    return mFileMismatches == 0;
+}
+
+//==============================================================================
+//                                                                     summary()
+//------------------------------------------------------------------------------
+// The totals, for all the trace files compared.
+//==============================================================================
+void oraParserCompare::summary()
+{
+    mOut << "Total: " << mFiles << " file(s), " << mMismatches << " mismatch(es). "
+         << std::fixed << std::setprecision(1)
+         << "Reference " << mReferenceSeconds * 1000.0 << "ms, "
+         << "optimised " << mOptimisedSeconds * 1000.0 << "ms, "
+         << std::setprecision(2)
+         << mReferenceSeconds / std::max(mOptimisedSeconds, 1e-9) << "x speedup."
+         << endl;
+}
+
+//==============================================================================
+//                                                                    mismatch()
+//------------------------------------------------------------------------------
+// Counts a mismatch, and lists it, if we haven't listed too many already.
+//==============================================================================
+void oraParserCompare::mismatch(const unsigned line, const string &what,
+                                const string &reference, const string &optimised)
+{
+    mMismatches++;
+    if (++mFileMismatches > COMPARE_MAX_LISTED) {
+        return;
+    }
+
+    mOut << mTraceName << ':' << line << ": " << what
+         << ": reference [" << reference << "], optimised [" << optimised << "]\n";
+}
+
+//==============================================================================
+//                                                                       check()
+//------------------------------------------------------------------------------
+// A mismatch if they are different.
+//==============================================================================
+void oraParserCompare::check(const unsigned line, const string &what,
+                             const string &reference, const string &optimised)
+{
+    if (reference != optimised) {
+        mismatch(line, what, reference, optimised);
+    }
+}
+
+void oraParserCompare::check(const unsigned line, const string &what,
+                             const unsigned long long reference, const unsigned long long optimised)
+{
+    if (reference != optimised) {
+        mismatch(line, what, to_string(reference), to_string(optimised));
+    }
+}
+
+//==============================================================================
+//                                                             compareDeadlock()
+//------------------------------------------------------------------------------
+// Every field of one deadlock. The wait stack times are compared as the
+// report shows them, against the reference's text, so that our parsing of
+// them is checked too.
+//==============================================================================
+void oraParserCompare::compareDeadlock(const oraReferenceDeadlock &ref, const oraDeadlock &dl)
+{
+    unsigned line = ref.lineNumber;
+
+    check(line, "date", ref.date, dl.date());
+    check(line, "time", ref.time, dl.time());
+    check(line, "rows", ref.blockers.size(), dl.rows());
+
+    for (auto b = ref.blockers.begin(); b != ref.blockers.end(); b++) {
+        compareSession(line, "blocker " + to_string(b->first), b->second, dl.blockerBySession(b->first));
+    }
+
+    for (auto w = ref.waiters.begin(); w != ref.waiters.end(); w++) {
+        const oraBlockerWaiter *waiter = dl.waiterBySession(w->first);
+        string what = "waiter " + to_string(w->first);
+        compareSession(line, what, w->second, waiter);
+        if (waiter) {
+            check(line, what + " rowid", w->second.rowidWait(), waiter->rowidWait());
+            check(line, what + " object id", w->second.objectId(), waiter->objectId());
+            check(line, what + " file", w->second.file(), waiter->file());
+            check(line, what + " block", w->second.block(), waiter->block());
+            check(line, what + " slot", w->second.slot(), waiter->slot());
+        }
+    }
+
+    string refSignatures, signatures;
+    for (auto s = ref.signatures.begin(); s != ref.signatures.end(); s++) {
+        refSignatures += (s == ref.signatures.begin() ? "" : " ") + *s;
+    }
+    for (auto s = dl.signatures()->begin(); s != dl.signatures()->end(); s++) {
+        signatures += (s == dl.signatures()->begin() ? "" : " ") + *s;
+    }
+    check(line, "signatures", refSignatures, signatures);
+
+    const vector<oraWaitEvent> *waits = dl.waitStack();
+    check(line, "waits", ref.waitStack.size(), waits->size());
+    for (unsigned x = 0; x < ref.waitStack.size() && x < waits->size(); x++) {
+        string what = "wait " + to_string(x);
+        check(line, what + " event", ref.waitStack[x].first, waits->at(x).eventName());
+
+        check(line, what + " time",
+              "Waited for '" + ref.waitStack[x].first + "' for " + ref.waitStack[x].second + "(s)",
+              waits->at(x).text());
+    }
+
+    check(line, "current wait", ref.deadlockWait, dl.deadlockWait());
+    check(line, "SQL", ref.SQL, dl.SQL());
+}
+
+//==============================================================================
+//                                                              compareSession()
+//------------------------------------------------------------------------------
+// The graph fields of a blocker or waiter.
+//==============================================================================
+void oraParserCompare::compareSession(const unsigned line, const string &what,
+                                      const oraBlockerWaiter &ref, const oraBlockerWaiter *bw)
+{
+    if (!bw) {
+        mismatch(line, what, "found", "missing");
+        return;
+    }
+
+    check(line, what + " resource", ref.resourceName(), bw->resourceName());
+    check(line, what + " process", ref.process(), bw->process());
+    check(line, what + " holds", ref.holds(), bw->holds());
+    check(line, what + " waits", ref.waits(), bw->waits());
+    check(line, what + " other session", ref.otherSession(), bw->otherSession());
+}
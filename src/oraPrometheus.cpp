@@ -0,0 +1,370 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraPrometheus.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using std::ifstream;
+using std::ofstream;
+using std::ostringstream;
+using std::cerr;
+using std::endl;
+
+static const unsigned long long bucketMicros[PROMETHEUS_BUCKETS] = {
+    1000, 10000, 100000, 1000000, 10000000, 60000000, 300000000
+};
+
+static const char *bucketLabels[PROMETHEUS_BUCKETS + 1] = {
+    "0.001", "0.01", "0.1", "1", "10", "60", "300", "+Inf"
+};
+
+//==============================================================================
+//                                                                  labelValue()
+//------------------------------------------------------------------------------
+// Escapes a label value, quotes included.
+//==============================================================================
+static string labelValue(const string &s)
+{
+    string result = "\"";
+    for (auto c = s.begin(); c != s.end(); c++) {
+        switch (*c) {
+            case '\\': result += "\\\\"; break;
+            case '"':  result += "\\\""; break;
+            case '\n': result += "\\n"; break;
+            default:   result += *c;
+        }
+    }
+
+    return result + '"';
+}
+
+//==============================================================================
+//                                                                 splitFields()
+//------------------------------------------------------------------------------
+// Splits a state file line on tabs.
+//==============================================================================
+static vector<string> splitFields(const string &line)
+{
+    vector<string> fields;
+    std::istringstream in(line);
+    string field;
+    while (getline(in, field, '\t')) {
+        fields.push_back(field);
+    }
+
+    return fields;
+}
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraPrometheus::oraPrometheus(const string promName):
+    mPromName(promName)
+{
+    mStateName = promName + ".state";
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraPrometheus::~oraPrometheus()
+{
+    //dtor
+}
+
+//==============================================================================
+//                                                                        load()
+//------------------------------------------------------------------------------
+// Reads the state file, if there is one. It looks like this, tab separated:
+//
+// file     size    offset  inode   mtime   /path/to/trace.trc
+// counter  instance    signature   objectId    count
+// histogram    instance    event   count   sumMicros   bucket...
+//
+// with the counters and histograms belonging to the file before them. Older
+// state files have no inode or mtime, those files are only checked by size
+// until they have been read again. Returns false if the state file is there,
+// but not valid.
+//==============================================================================
+bool oraPrometheus::load()
+{
+    ifstream in(mStateName);
+    if (!in.good()) {
+        return true;
+    }
+
+    traceState *state = nullptr;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        vector<string> fields = splitFields(line);
+
+        if (fields[0] == "file" && (fields.size() == 4 || fields.size() == 6)) {
+            state = &mTraces[fields.back()];
+            state->size = std::strtoull(fields[1].c_str(), nullptr, 10);
+            state->offset = std::strtoull(fields[2].c_str(), nullptr, 10);
+            if (fields.size() == 6) {
+                state->inode = std::strtoull(fields[3].c_str(), nullptr, 10);
+                state->mtime = std::strtoll(fields[4].c_str(), nullptr, 10);
+            }
+            continue;
+        }
+
+        if (state && fields[0] == "counter" && fields.size() == 5) {
+            string key = fields[1] + '\t' + fields[2] + '\t' + fields[3];
+            state->counters[key] = std::strtoull(fields[4].c_str(), nullptr, 10);
+            continue;
+        }
+
+        if (state && fields[0] == "histogram" && fields.size() == 6 + PROMETHEUS_BUCKETS) {
+            histogram &h = state->histograms[fields[1] + '\t' + fields[2]];
+            h.count = std::strtoull(fields[3].c_str(), nullptr, 10);
+            h.sumMicros = std::strtoull(fields[4].c_str(), nullptr, 10);
+            for (unsigned x = 0; x <= PROMETHEUS_BUCKETS; x++) {
+                h.buckets[x] = std::strtoull(fields[5 + x].c_str(), nullptr, 10);
+            }
+            continue;
+        }
+
+        cerr << "Invalid line in " << mStateName << ": " << line << endl;
+        mTraces.clear();
+        return false;
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                      update()
+//------------------------------------------------------------------------------
+// Reads whatever is new in a trace file, and counts its deadlocks. Deadlocks
+// are streamed, not kept. We carry on next time from the end of the last
+// deadlock found. One that the end of the file cut short was still being
+// written, so it isn't counted yet, and next time starts from its beginning,
+// to read it again, in full.
+//==============================================================================
+void oraPrometheus::update(const string &traceName, oraFilter *filter, oraStats &totalStats)
+{
+    // How big is it now, and is it the same file as last time? Windows has
+    // no inodes, st_ino is always zero there, so only mtime tells.
+    struct stat st;
+    if (stat(traceName.c_str(), &st) != 0) {
+        cerr << "\tCannot open tracefile " << traceName << endl;
+        return;
+    }
+    unsigned long long size = st.st_size;
+    unsigned long long inode = st.st_ino;
+    long long mtime = st.st_mtime;
+
+    // An older state file doesn't know the inode or mtime, only the size.
+    traceState &state = mTraces[traceName];
+    bool known = (state.mtime != 0);
+    if (size == state.size && (!known || (inode == state.inode && mtime == state.mtime))) {
+        cerr << "\tUnchanged.\n";
+        return;
+    }
+
+    // Smaller, a different file, or written to without growing? It's been
+    // replaced, read the new one from the start. The counts so far stay,
+    // counters don't go down.
+    if (size < state.size || size < state.offset ||
+        (known && (inode != state.inode || size == state.size))) {
+        cerr << "\tReplaced, reading from the start.\n";
+        state.offset = 0;
+    }
+
+    oraTraceFile traceFile(traceName);
+    traceFile.setFilter(filter);
+    traceFile.setStartOffset(state.offset);
+
+    oraDeadlock dl(&traceFile);
+    unsigned long long resume = size;
+    unsigned deadlockCount = 0;
+    while (traceFile.nextDeadlock(dl)) {
+        if (dl.truncated()) {
+            resume = dl.startOffset();
+            break;
+        }
+
+        add(state, traceFile, dl);
+        resume = dl.endOffset();
+        deadlockCount++;
+    }
+
+    state.size = size;
+    state.offset = resume;
+    state.inode = inode;
+    state.mtime = mtime;
+
+    cerr << "\tThere was/were " << deadlockCount << " new deadlock(s) found.\n";
+    traceFile.stats()->stop();
+    totalStats.merge(*traceFile.stats());
+}
+
+//==============================================================================
+//                                                                         add()
+//------------------------------------------------------------------------------
+// Counts one deadlock. The signature is the first one in the graph, and the
+// object is the one the aborted session was waiting for, if any.
+//==============================================================================
+void oraPrometheus::add(traceState &state, oraTraceFile &traceFile, oraDeadlock &dl)
+{
+    string instance = traceFile.instanceName();
+    string signature = dl.global() ? "GLOBAL" : "UNKNOWN";
+    if (!dl.signatures()->empty()) {
+        signature = dl.signatures()->front();
+    }
+
+    unsigned objectId = 0;
+    const oraBlockerWaiter *waiter = dl.waiterBySession(dl.abortedSession());
+    if (waiter) {
+        objectId = waiter->objectId();
+    }
+
+    state.counters[instance + '\t' + signature + '\t' + std::to_string(objectId)]++;
+
+    const vector<oraWaitEvent> *waits = dl.waitStack();
+    for (auto w = waits->begin(); w != waits->end(); w++) {
+        histogram &h = state.histograms[instance + '\t' + w->eventName()];
+        unsigned bucket = 0;
+        while (bucket < PROMETHEUS_BUCKETS && w->micros() > bucketMicros[bucket]) {
+            bucket++;
+        }
+
+        h.count++;
+        h.sumMicros += w->micros();
+        h.buckets[bucket]++;
+    }
+}
+
+//==============================================================================
+//                                                                        save()
+//------------------------------------------------------------------------------
+// Adds up every trace file's counts, and writes the .prom file, and the state
+// file for next time.
+//==============================================================================
+bool oraPrometheus::save()
+{
+    map<string, unsigned long long> counters;
+    map<string, histogram> histograms;
+    ostringstream state;
+
+    state << "# DeadlockAnalysis Prometheus state. Don't edit.\n";
+    for (auto t = mTraces.begin(); t != mTraces.end(); t++) {
+        state << "file\t" << t->second.size << '\t' << t->second.offset << '\t'
+              << t->second.inode << '\t' << t->second.mtime << '\t' << t->first << '\n';
+
+        for (auto c = t->second.counters.begin(); c != t->second.counters.end(); c++) {
+            counters[c->first] += c->second;
+            state << "counter\t" << c->first << '\t' << c->second << '\n';
+        }
+
+        for (auto h = t->second.histograms.begin(); h != t->second.histograms.end(); h++) {
+            histogram &total = histograms[h->first];
+            total.count += h->second.count;
+            total.sumMicros += h->second.sumMicros;
+            state << "histogram\t" << h->first << '\t' << h->second.count << '\t' << h->second.sumMicros;
+            for (unsigned x = 0; x <= PROMETHEUS_BUCKETS; x++) {
+                total.buckets[x] += h->second.buckets[x];
+                state << '\t' << h->second.buckets[x];
+            }
+            state << '\n';
+        }
+    }
+
+    ostringstream prom;
+    prom << "# HELP oracle_deadlocks_total Deadlocks found in Oracle trace files.\n"
+         << "# TYPE oracle_deadlocks_total counter\n";
+    for (auto c = counters.begin(); c != counters.end(); c++) {
+        vector<string> labels = splitFields(c->first);
+        prom << "oracle_deadlocks_total{oracle_instance=" << labelValue(labels[0])
+             << ",signature=" << labelValue(labels[1])
+             << ",object_id=" << labelValue(labels[2]) << "} " << c->second << '\n';
+    }
+
+    prom << "# HELP oracle_deadlock_wait_seconds Wait durations in the wait stacks of deadlocked sessions.\n"
+         << "# TYPE oracle_deadlock_wait_seconds histogram\n";
+    for (auto h = histograms.begin(); h != histograms.end(); h++) {
+        vector<string> labels = splitFields(h->first);
+        string common = "oracle_instance=" + labelValue(labels[0]) + ",event=" + labelValue(labels[1]);
+
+        unsigned long long cumulative = 0;
+        for (unsigned x = 0; x <= PROMETHEUS_BUCKETS; x++) {
+            cumulative += h->second.buckets[x];
+            prom << "oracle_deadlock_wait_seconds_bucket{" << common
+                 << ",le=\"" << bucketLabels[x] << "\"} " << cumulative << '\n';
+        }
+
+        char sum[32];
+        std::snprintf(sum, sizeof(sum), "%.6f", h->second.sumMicros / 1000000.0);
+        prom << "oracle_deadlock_wait_seconds_sum{" << common << "} " << sum << '\n'
+             << "oracle_deadlock_wait_seconds_count{" << common << "} " << h->second.count << '\n';
+    }
+
+    // State first. If we die in between, the worst that happens is the
+    // .prom file is a run behind.
+    return writeAtomically(mStateName, state.str()) &&
+           writeAtomically(mPromName, prom.str());
+}
+
+//==============================================================================
+//                                                             writeAtomically()
+//------------------------------------------------------------------------------
+// Writes a file under a temporary name, then renames it over the real one.
+//==============================================================================
+bool oraPrometheus::writeAtomically(const string &fileName, const string &contents)
+{
+    string tempName = fileName + ".tmp";
+
+    {
+        ofstream out(tempName, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size());
+        out.flush();
+        if (!out.good()) {
+            cerr << "Cannot write " << tempName << endl;
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    // Windows won't rename over an existing file.
+    std::remove(fileName.c_str());
+#endif
+
+    if (std::rename(tempName.c_str(), fileName.c_str()) != 0) {
+        cerr << "Cannot rename " << tempName << " to " << fileName << endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,578 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraReadAhead.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define READ_AHEAD_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <fstream>
+#endif
+
+// Build with -DDEADLOCK_NO_URING to always use pread().
+#if defined(__linux__) && defined(__has_include) && !defined(DEADLOCK_NO_URING)
+#if __has_include(<linux/io_uring.h>)
+#define READ_AHEAD_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// Starts reading straight away.
+//==============================================================================
+oraReadAhead::oraReadAhead(const vector<string> &fileNames, const unsigned queueDepth)
+{
+    mQueueDepth = std::max(1u, std::min(queueDepth, 4096u));
+    mUsingUring = false;
+    mConsumed = 0;
+    mBufferedBytes = 0;
+    mStopping = false;
+
+    mFiles.resize(fileNames.size());
+    for (size_t x = 0; x < fileNames.size(); x++) {
+        mFiles[x].name = fileNames[x];
+    }
+
+    mReader = std::thread(&oraReadAhead::readAll, this);
+}
+
+//==============================================================================
+//                                                                    Destructor
+//------------------------------------------------------------------------------
+// Stops the reader, which finishes off anything in flight first.
+//==============================================================================
+oraReadAhead::~oraReadAhead()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mChanged.notify_all();
+    mReader.join();
+}
+
+//==============================================================================
+//                                                                        next()
+//------------------------------------------------------------------------------
+// Waits for the next file to be read, and hands over its contents. Returns
+// false if it couldn't be read.
+//==============================================================================
+bool oraReadAhead::next(string &buffer)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mConsumed >= mFiles.size()) {
+        return false;
+    }
+
+    file &f = mFiles[mConsumed];
+    mChanged.wait(lock, [&f] { return f.done; });
+
+    buffer.swap(f.buffer);
+    f.buffer.clear();
+    f.buffer.shrink_to_fit();
+    mBufferedBytes -= f.size;
+    mConsumed++;
+    mChanged.notify_all();
+
+    return !f.failed;
+}
+
+//==============================================================================
+//                                                                      wanted()
+//------------------------------------------------------------------------------
+// Should the reader start on a file yet? Always the next one to be parsed, and
+// any others while there's room. The mutex must be held.
+//==============================================================================
+bool oraReadAhead::wanted(const size_t index)
+{
+    return !mStopping && (index <= mConsumed || mBufferedBytes < READ_AHEAD_BYTES);
+}
+
+//==============================================================================
+//                                                                      opened()
+//------------------------------------------------------------------------------
+// A file has been opened. Finds out how big it is, and makes room for it.
+//==============================================================================
+bool oraReadAhead::opened(file &f)
+{
+#ifdef READ_AHEAD_POSIX
+    struct stat info;
+    if (fstat(f.fd, &info) != 0) {
+        return false;
+    }
+
+    f.open = true;
+    f.size = info.st_size;
+    f.buffer.resize(f.size);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBufferedBytes += f.size;
+    return true;
+#else
+    (void) f;
+    return false;
+#endif
+}
+
+//==============================================================================
+//                                                                    finished()
+//------------------------------------------------------------------------------
+// A file has been read, or not, and can be handed out.
+//==============================================================================
+void oraReadAhead::finished(file &f, const bool ok)
+{
+#ifdef READ_AHEAD_POSIX
+    if (f.fd >= 0) {
+        close(f.fd);
+        f.fd = -1;
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    f.done = true;
+    f.failed = !ok;
+    if (!ok) {
+        f.buffer.clear();
+    }
+    mChanged.notify_all();
+}
+
+//==============================================================================
+//                                                                     readAll()
+//------------------------------------------------------------------------------
+// The reader thread. Uses io_uring if it can, otherwise reads each file in
+// turn with pread(), still in the background.
+//==============================================================================
+void oraReadAhead::readAll()
+{
+#ifdef READ_AHEAD_URING
+    readAllUring();
+    if (mUsingUring) {
+        return;
+    }
+#endif
+
+    for (size_t x = 0; x < mFiles.size(); x++) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mChanged.wait(lock, [this, x] { return mStopping || wanted(x); });
+            if (mStopping) {
+                return;
+            }
+        }
+
+        file &f = mFiles[x];
+
+#ifdef READ_AHEAD_POSIX
+        f.fd = open(f.name.c_str(), O_RDONLY);
+        if (f.fd < 0 || !opened(f)) {
+            finished(f, false);
+            continue;
+        }
+
+        bool ok = true;
+        while (f.completed < f.size) {
+            size_t length = std::min<unsigned long long>(READ_AHEAD_CHUNK, f.size - f.completed);
+            ssize_t got = pread(f.fd, &f.buffer[f.completed], length, f.completed);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (got <= 0) {
+                ok = false;
+                break;
+            }
+
+            f.completed += got;
+        }
+
+        finished(f, ok);
+#else
+        std::ifstream in(f.name, std::ios::binary);
+        if (in.good()) {
+            in.seekg(0, std::ios::end);
+            f.size = in.tellg();
+            in.seekg(0);
+            f.buffer.resize(f.size);
+            in.read(&f.buffer[0], f.size);
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mBufferedBytes += f.size;
+            }
+        }
+        finished(f, in.good());
+#endif
+    }
+}
+
+#ifdef READ_AHEAD_URING
+
+//==============================================================================
+// Just enough of io_uring, straight from the system calls, to save needing
+// liburing. One submission queue and one completion queue, shared with the
+// kernel through mmap()ed rings.
+//==============================================================================
+struct uring {
+    int fd = -1;
+    void *sqRing = MAP_FAILED;
+    void *cqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned sqLocalTail = 0;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    bool setup(const unsigned entries);
+    io_uring_sqe *getSqe();
+    bool submit(const unsigned count, const unsigned waitFor);
+    ~uring();
+};
+
+//==============================================================================
+//                                                                uring::setup()
+//------------------------------------------------------------------------------
+// Creates the ring. Fails if the kernel doesn't have io_uring, or it has been
+// disabled, or blocked by seccomp etc.
+//==============================================================================
+bool uring::setup(const unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        return false;
+    }
+
+    if (singleMmap) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char *sq = static_cast<char *>(sqRing);
+    char *cq = static_cast<char *>(cqRing);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqLocalTail = *sqTail;
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+//==============================================================================
+//                                                               uring::getSqe()
+//------------------------------------------------------------------------------
+// The next free submission queue entry, cleared. We never have more in flight
+// than the ring holds, so there always is one.
+//==============================================================================
+io_uring_sqe *uring::getSqe()
+{
+    unsigned index = sqLocalTail & *sqMask;
+    io_uring_sqe *sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    sqLocalTail++;
+    return sqe;
+}
+
+//==============================================================================
+//                                                               uring::submit()
+//------------------------------------------------------------------------------
+// Tells the kernel about new entries, and waits for some completions.
+//==============================================================================
+bool uring::submit(const unsigned count, const unsigned waitFor)
+{
+    __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, fd, count, waitFor, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                                uring::~uring()
+//==============================================================================
+uring::~uring()
+{
+    if (sqes != MAP_FAILED) {
+        munmap(sqes, sqesSize);
+    }
+
+    if (cqRing != MAP_FAILED && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+
+    if (sqRing != MAP_FAILED) {
+        munmap(sqRing, sqRingSize);
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+//==============================================================================
+//                                                                readAllUring()
+//------------------------------------------------------------------------------
+// The io_uring reader. Keeps up to the queue depth of opens and reads in
+// flight. Reads for earlier files are queued before opens for later ones, so
+// the file being waited for gets done first. Older kernels without the open
+// or read operations get the plain system calls instead, for those bits.
+//==============================================================================
+void oraReadAhead::readAllUring()
+{
+    uring ring;
+    if (!ring.setup(mQueueDepth)) {
+        return;
+    }
+
+    mUsingUring = true;
+
+    // What each entry in flight is doing.
+    struct operation {
+        size_t fileIndex;
+        bool isOpen;
+        unsigned long long offset;
+        unsigned length;
+    };
+
+    vector<operation> operations(mQueueDepth);
+    vector<unsigned> freeSlots;
+    for (unsigned x = 0; x < mQueueDepth; x++) {
+        freeSlots.push_back(mQueueDepth - 1 - x);
+    }
+
+    size_t firstUndone = 0;
+    size_t nextOpen = 0;
+    unsigned inFlight = 0;
+    unsigned opening = 0;
+    bool stopping = false;
+
+    while (true) {
+        unsigned queued = 0;
+
+        // Reads for files already open, oldest first.
+        while (firstUndone < nextOpen && mFiles[firstUndone].done) {
+            firstUndone++;
+        }
+
+        for (size_t x = firstUndone; !stopping && x < nextOpen && inFlight < mQueueDepth; x++) {
+            file &f = mFiles[x];
+            while (f.open && !f.done && !f.failed && f.submitted < f.size && inFlight < mQueueDepth) {
+                unsigned slot = freeSlots.back();
+                freeSlots.pop_back();
+                unsigned length = std::min<unsigned long long>(READ_AHEAD_CHUNK, f.size - f.submitted);
+                operations[slot] = operation{x, false, f.submitted, length};
+
+                io_uring_sqe *sqe = ring.getSqe();
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = f.fd;
+                sqe->addr = reinterpret_cast<unsigned long long>(&f.buffer[f.submitted]);
+                sqe->len = length;
+                sqe->off = f.submitted;
+                sqe->user_data = slot;
+
+                f.submitted += length;
+                f.inFlight++;
+                inFlight++;
+                queued++;
+            }
+        }
+
+        // Then open another, if there's room. One at a time, a file only
+        // counts against READ_AHEAD_BYTES once it's open and its size known,
+        // so opening more at once could go well over.
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            stopping = mStopping;
+            if (!stopping && opening == 0 && nextOpen < mFiles.size() && inFlight < mQueueDepth &&
+                wanted(nextOpen)) {
+                unsigned slot = freeSlots.back();
+                freeSlots.pop_back();
+                operations[slot] = operation{nextOpen, true, 0, 0};
+
+                io_uring_sqe *sqe = ring.getSqe();
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<unsigned long long>(mFiles[nextOpen].name.c_str());
+                sqe->open_flags = O_RDONLY;
+                sqe->user_data = slot;
+
+                mFiles[nextOpen].opening = true;
+                nextOpen++;
+                inFlight++;
+                opening++;
+                queued++;
+            }
+        }
+
+        if (inFlight == 0) {
+            if (stopping || nextOpen >= mFiles.size()) {
+                break;
+            }
+
+            // Too much read ahead, wait for the parser to catch up.
+            std::unique_lock<std::mutex> lock(mMutex);
+            mChanged.wait(lock, [this, nextOpen] { return mStopping || wanted(nextOpen); });
+            continue;
+        }
+
+        if (!ring.submit(queued, 1)) {
+            // Something is badly wrong. Give up on everything not done.
+            for (size_t x = firstUndone; x < mFiles.size(); x++) {
+                if (!mFiles[x].done) {
+                    finished(mFiles[x], false);
+                }
+            }
+            return;
+        }
+
+        // Deal with whatever has completed.
+        unsigned head = *ring.cqHead;
+        unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            io_uring_cqe *cqe = &ring.cqes[head & *ring.cqMask];
+            unsigned slot = cqe->user_data;
+            int result = cqe->res;
+            operation op = operations[slot];
+            file &f = mFiles[op.fileIndex];
+            freeSlots.push_back(slot);
+            inFlight--;
+
+            if (op.isOpen) {
+                f.opening = false;
+                opening--;
+                if (result == -EINVAL) {
+                    // No IORING_OP_OPENAT before Linux 5.6.
+                    result = open(f.name.c_str(), O_RDONLY);
+                }
+
+                if (result < 0) {
+                    finished(f, false);
+                    continue;
+                }
+
+                f.fd = result;
+                if (!opened(f)) {
+                    finished(f, false);
+                } else if (f.size == 0) {
+                    finished(f, true);
+                }
+                continue;
+            }
+
+            f.inFlight--;
+            if (result == -EINVAL || (result >= 0 && static_cast<unsigned>(result) < op.length)) {
+                // No IORING_OP_READ before Linux 5.6, or a short read. Do the
+                // rest the old fashioned way.
+                unsigned done = result > 0 ? result : 0;
+                while (done < op.length) {
+                    ssize_t got = pread(f.fd, &f.buffer[op.offset + done], op.length - done, op.offset + done);
+                    if (got < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (got <= 0) {
+                        break;
+                    }
+                    done += got;
+                }
+                result = (done == op.length) ? static_cast<int>(done) : -EIO;
+            }
+
+            if (result < 0) {
+                f.failed = true;
+            } else {
+                f.completed += result;
+            }
+
+            if (f.inFlight == 0 && (f.failed || f.completed >= f.size)) {
+                finished(f, !f.failed);
+            }
+        }
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // Anything we didn't get round to, because we were stopped.
+    for (size_t x = 0; x < mFiles.size(); x++) {
+        if (!mFiles[x].done) {
+            finished(mFiles[x], false);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,388 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraReferenceParser.h"
+
+#include <stdexcept>
+
+using std::stoi;
+using std::pair;
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// Opens the trace file, and skips the heading lines, up to the first blank
+// line. We don't need anything from them.
+//==============================================================================
+oraReferenceParser::oraReferenceParser(const string &traceName) :
+    mIFS(traceName)
+{
+    mLineNumber = 0;
+    mExtracting = false;
+    mOverrun = false;
+
+    while (mIFS.good()) {
+        readLine();
+        if (mCurrentLine.empty()) {
+            break;
+        }
+    }
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraReferenceParser::~oraReferenceParser()
+{
+}
+
+//==============================================================================
+//                                                                       parse()
+//------------------------------------------------------------------------------
+// Finds and extracts all the deadlocks in the trace file and returns the
+// number found.
+//==============================================================================
+unsigned oraReferenceParser::parse()
+{
+    while (mIFS.good()) {
+        if (findAtStart("DEADLOCK DETECTED", false)) {
+            oraReferenceDeadlock dl;
+            dl.lineNumber = mLineNumber;
+
+            // The numbers are read with stoi(), which throws if they aren't
+            // numbers. That's a broken deadlock, not a broken run. One with a
+            // missing section is read into the next deadlock, and is broken
+            // too, though it may not look it. The next one is lost.
+            mExtracting = true;
+            mOverrun = false;
+            try {
+                dl.complete = extractDeadlock(dl) && !mOverrun;
+            } catch (const std::logic_error &) {
+                dl.complete = false;
+            }
+            mExtracting = false;
+
+            mDeadlocks.push_back(dl);
+        }
+    }
+
+    return mDeadlocks.size();
+}
+
+//==============================================================================
+//                                                                    readLine()
+//------------------------------------------------------------------------------
+// Reads the next line from the tracefile. Makes sure that line numbers
+// and previous lines are sorted out. Returns the new line read.
+//==============================================================================
+string oraReferenceParser::readLine()
+{
+    mPreviousLine = mCurrentLine;
+    getline(mIFS, mCurrentLine);
+
+    if (mIFS.good()) {
+        // Traces copied from Windows have "\r\n" line ends.
+        if (!mCurrentLine.empty() && mCurrentLine.back() == '\r') {
+            mCurrentLine.pop_back();
+        }
+
+        mLineNumber++;
+        if (mExtracting && mCurrentLine.compare(0, 17, "DEADLOCK DETECTED") == 0) {
+            mOverrun = true;
+        }
+        return mCurrentLine;
+    }
+
+    // Oops! EOF or error occurred.
+    return "";
+}
+
+//==============================================================================
+//                                                                 trimmedLine()
+//------------------------------------------------------------------------------
+// Returns the current line from the trace file, without leading whitespace.
+//==============================================================================
+string oraReferenceParser::trimmedLine() const
+{
+    auto pos = mCurrentLine.find_first_not_of(" \t");
+    return pos == string::npos ? "" : mCurrentLine.substr(pos);
+}
+
+//==============================================================================
+//                                                                 findAtStart()
+//------------------------------------------------------------------------------
+// Reads lines until one starts with some text, case sensitive. Returns false
+// at EOF, or at the end of a deadlock dump if stopAtEndOfDeadlock is true.
+//==============================================================================
+bool oraReferenceParser::findAtStart(const string &lookFor, const bool stopAtEndOfDeadlock)
+{
+    while (mIFS.good()) {
+        readLine();
+        if (mCurrentLine.compare(0, lookFor.size(), lookFor) == 0) {
+            return mIFS.good();
+        }
+
+        if (stopAtEndOfDeadlock && mCurrentLine == "END OF PROCESS STATE") {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+//==============================================================================
+//                                                               findNearStart()
+//------------------------------------------------------------------------------
+// As findAtStart(), but the text may be after some whitespace.
+//==============================================================================
+bool oraReferenceParser::findNearStart(const string &lookFor, const bool stopAtEndOfDeadlock)
+{
+    while (mIFS.good()) {
+        readLine();
+        if (trimmedLine().compare(0, lookFor.size(), lookFor) == 0) {
+            return mIFS.good();
+        }
+
+        if (stopAtEndOfDeadlock && mCurrentLine == "END OF PROCESS STATE") {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+//==============================================================================
+//                                                             extractDeadlock()
+//------------------------------------------------------------------------------
+// Extracts each section of one deadlock, in the order they are in the dump.
+// Stops at the first one that's missing.
+//==============================================================================
+bool oraReferenceParser::extractDeadlock(oraReferenceDeadlock &dl)
+{
+    return extractDeadlockGraph(dl) &&
+           extractRowsWaited(dl) &&
+           extractCurrentSQL(dl) &&
+           extractProcessState(dl) &&
+           extractWaitStack(dl);
+}
+
+//==============================================================================
+//                                                        extractDeadlockGraph()
+//------------------------------------------------------------------------------
+// The date and time, from the line before "DEADLOCK DETECTED", and the graph.
+//==============================================================================
+bool oraReferenceParser::extractDeadlockGraph(oraReferenceDeadlock &dl)
+{
+    // *** 2018-12-19 15:42:20.941....
+    string traceLine = mPreviousLine;
+    auto pos = traceLine.find(' ');
+    auto pos2 = traceLine.find(' ', pos + 1);
+    if (pos != string::npos && pos2 != string::npos) {
+        dl.date = traceLine.substr(pos + 1, pos2 - pos - 1);
+        dl.time = traceLine.substr(pos2 + 1, 8);
+    }
+
+    if (!findAtStart("Deadlock graph:") || !findAtStart("Resource Name")) {
+        return false;
+    }
+
+    /*
+    Resource Name          process session holds waits  process session holds waits
+    TX-0018001f-0025006a       985     272     X            821    1019           S
+    */
+    oraBlockerWaiter blocker(false), waiter(true);
+
+    traceLine = readLine();
+    while (mIFS.good()) {
+        // The resources end at a one-space line.
+        if (traceLine == " ") {
+            break;
+        }
+
+        string signature = traceLine.substr(0, 2) + '-';
+
+        blocker.setResourceName(traceLine.substr(0, traceLine.find(' ')));
+        blocker.setProcess(stoi(traceLine.substr(23, 7)));
+        blocker.setSession(stoi(traceLine.substr(31, 7)));
+        blocker.setHolds(traceLine.substr(39, 5));
+        blocker.setWaits(traceLine.substr(45, 5));
+        signature += blocker.holds() + blocker.waits();
+
+        waiter.setResourceName(blocker.resourceName());
+        waiter.setProcess(stoi(traceLine.substr(52, 7)));
+        waiter.setSession(stoi(traceLine.substr(60, 7)));
+        waiter.setHolds(traceLine.substr(68, 5));
+        waiter.setWaits(traceLine.substr(74, 5));
+        signature += '-' + waiter.holds() + waiter.waits();
+
+        blocker.setOtherSession(waiter.session());
+        waiter.setOtherSession(blocker.session());
+
+        bool seen = false;
+        for (auto s = dl.signatures.begin(); s != dl.signatures.end(); s++) {
+            seen = seen || (*s == signature);
+        }
+        if (!seen) {
+            dl.signatures.push_back(signature);
+        }
+
+        if (!dl.blockers.insert(pair<unsigned, oraBlockerWaiter>(blocker.session(), blocker)).second ||
+            !dl.waiters.insert(pair<unsigned, oraBlockerWaiter>(waiter.session(), waiter)).second) {
+            return false;
+        }
+
+        traceLine = readLine();
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                           extractRowsWaited()
+//------------------------------------------------------------------------------
+// The rows each waiter was waiting for, if any.
+//==============================================================================
+bool oraReferenceParser::extractRowsWaited(oraReferenceDeadlock &dl)
+{
+    if (!findAtStart("Rows waited on:")) {
+        return false;
+    }
+
+    /*
+    Rows waited on:
+      Session 272: obj - rowid = 004C5C56 - AATFxWAQAAOgakFAAA
+      (dictionary objn - 5004374, file - 1024, block - 243378437, slot - 0)
+      Session 97: no row
+    */
+    while (mIFS.good()) {
+        string traceLine = readLine();
+
+        // The rows waited on end at a one-space line.
+        if (traceLine == " ") {
+            break;
+        }
+
+        auto waiter = dl.waiters.find(stoi(traceLine.substr(9)));
+        if (waiter == dl.waiters.end()) {
+            return false;
+        }
+
+        if (traceLine.find("no row") != string::npos) {
+            waiter->second.setRowidWait("No row waited for");
+            continue;
+        }
+
+        if (traceLine.size() < 18) {
+            return false;
+        }
+        waiter->second.setRowidWait(traceLine.substr(traceLine.size() - 18));
+
+        traceLine = readLine();
+        waiter->second.setObjectId(stoi(traceLine.substr(traceLine.find("objn - ") + 7)));
+        waiter->second.setFile(stoi(traceLine.substr(traceLine.find("file - ") + 7)));
+        waiter->second.setBlock(std::stoul(traceLine.substr(traceLine.find("block - ") + 8)));
+        waiter->second.setSlot(stoi(traceLine.substr(traceLine.find("slot - ") + 7)));
+    }
+
+    return true;
+}
+
+//==============================================================================
+//                                                           extractCurrentSQL()
+//------------------------------------------------------------------------------
+// The SQL statement that was aborted. Up to a line of "=====", or "-----" if
+// a PL/SQL stack follows.
+//==============================================================================
+bool oraReferenceParser::extractCurrentSQL(oraReferenceDeadlock &dl)
+{
+    if (!findAtStart("----- Current SQL Statement")) {
+        return false;
+    }
+
+    string traceLine = readLine();
+    while (mIFS.good()) {
+        if (traceLine.compare(0, 5, "=====") == 0 ||
+            traceLine.compare(0, 5, "-----") == 0) {
+            return true;
+        }
+
+        dl.SQL += traceLine;
+        traceLine = readLine();
+    }
+
+    return false;
+}
+
+//==============================================================================
+//                                                         extractProcessState()
+//------------------------------------------------------------------------------
+// The reason this session deadlocked, from the line after "Current Wait Stack:"
+// in the process state.
+//==============================================================================
+bool oraReferenceParser::extractProcessState(oraReferenceDeadlock &dl)
+{
+    if (!findAtStart("PROCESS STATE") || !findNearStart("Current Wait Stack:")) {
+        return false;
+    }
+
+    readLine();
+    dl.deadlockWait = "W" + trimmedLine().substr(4);
+    return mIFS.good();
+}
+
+//==============================================================================
+//                                                            extractWaitStack()
+//------------------------------------------------------------------------------
+// The aborted session's wait history. The event name, and "total=" time, of
+// each wait.
+//==============================================================================
+bool oraReferenceParser::extractWaitStack(oraReferenceDeadlock &dl)
+{
+    if (!findNearStart("Session Wait History:")) {
+        return false;
+    }
+
+    string event;
+    while (mIFS.good()) {
+        string traceLine = readLine();
+
+        if (traceLine.compare(0, 11, "    -------") == 0) {
+            return true;
+        }
+
+        auto pos = traceLine.find(": waited for '");
+        if (pos != string::npos) {
+            pos += 14;
+            event = traceLine.substr(pos, traceLine.find('\'', pos) - pos);
+            continue;
+        }
+
+        pos = traceLine.find("total=");
+        if (pos != string::npos) {
+            dl.waitStack.push_back(std::make_pair(event, traceLine.substr(pos + 6)));
+        }
+    }
+
+    return false;
+}
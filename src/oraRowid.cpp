@@ -0,0 +1,235 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraRowid.h"
+#include "oraDeadlock.h"
+
+#include <algorithm>
+#include <array>
+
+// The length of an extended rowid, and where each part of it starts.
+#define ROWID_LENGTH 18
+#define ROWID_FILE 6
+#define ROWID_BLOCK 9
+#define ROWID_ROW 15
+
+// Oracle's base64 digits are A-Z, a-z, 0-9, + and /, in that order. Anything
+// else maps to 64, which no digit can be.
+static constexpr std::array<unsigned char, 256> base64Table()
+{
+    std::array<unsigned char, 256> table {};
+    for (unsigned x = 0; x < 256; x++) {
+        table[x] = 64;
+    }
+
+    for (unsigned x = 0; x < 26; x++) {
+        table['A' + x] = x;
+        table['a' + x] = 26 + x;
+    }
+
+    for (unsigned x = 0; x < 10; x++) {
+        table['0' + x] = 52 + x;
+    }
+
+    table['+'] = 62;
+    table['/'] = 63;
+    return table;
+}
+
+static constexpr std::array<unsigned char, 256> base64Digits = base64Table();
+
+//==============================================================================
+//                                                                base64Number()
+//------------------------------------------------------------------------------
+// Decodes length base64 digits, starting at from. False if any of them is not
+// a base64 digit, or the value doesn't fit.
+//==============================================================================
+static bool base64Number(const string &rowid, const unsigned from,
+                         const unsigned length, unsigned &value)
+{
+    unsigned long long result = 0;
+
+    for (unsigned x = from; x < from + length; x++) {
+        unsigned char digit = base64Digits[static_cast<unsigned char>(rowid[x])];
+        if (digit > 63) {
+            return false;
+        }
+
+        result = (result << 6) | digit;
+    }
+
+    if (result > 0xFFFFFFFFULL) {
+        return false;
+    }
+
+    value = static_cast<unsigned>(result);
+    return true;
+}
+
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraRowid::oraRowid()
+{
+    mDataObjectId = 0;
+    mFile = 0;
+    mBlock = 0;
+    mRow = 0;
+}
+
+//==============================================================================
+//                                                                      decode()
+//------------------------------------------------------------------------------
+// Splits an extended rowid into its data object id, file, block and row.
+// Returns false, leaving result alone, if it isn't one.
+//==============================================================================
+bool oraRowid::decode(const string &rowid, oraRowid &result)
+{
+    if (rowid.length() != ROWID_LENGTH) {
+        return false;
+    }
+
+    oraRowid temp;
+    if (!base64Number(rowid, 0, ROWID_FILE, temp.mDataObjectId) ||
+        !base64Number(rowid, ROWID_FILE, ROWID_BLOCK - ROWID_FILE, temp.mFile) ||
+        !base64Number(rowid, ROWID_BLOCK, ROWID_ROW - ROWID_BLOCK, temp.mBlock) ||
+        !base64Number(rowid, ROWID_ROW, ROWID_LENGTH - ROWID_ROW, temp.mRow)) {
+        return false;
+    }
+
+    result = temp;
+    return true;
+}
+
+
+//==============================================================================
+//                                                         oraHotBlocks::add()
+//------------------------------------------------------------------------------
+// Adds the rows waited on by one deadlock's waiters. Waiters who didn't want a
+// row, "no row", have no file or block and are left out.
+//==============================================================================
+void oraHotBlocks::add(const oraDeadlock &dl)
+{
+    set<std::pair<unsigned, unsigned>> seen;
+
+    for (unsigned x = 0; x < dl.rows(); x++) {
+        const oraBlockerWaiter *waiter = dl.waiterByIndex(x);
+        if (!waiter || (waiter->file() == 0 && waiter->block() == 0)) {
+            continue;
+        }
+
+        auto key = std::make_pair(waiter->file(), waiter->block());
+        blockCounts &b = mBlocks[key];
+        b.objectId = waiter->objectId();
+        b.dataObjectId = waiter->dataObjectId();
+        b.waiters++;
+        if (!waiter->waits().empty()) {
+            b.modes.insert(waiter->waits());
+        }
+
+        if (seen.insert(key).second) {
+            b.deadlocks++;
+        }
+    }
+}
+
+//==============================================================================
+//                                                       oraHotBlocks::merge()
+//------------------------------------------------------------------------------
+// Adds another set of blocks, from another trace file, into these.
+//==============================================================================
+void oraHotBlocks::merge(const oraHotBlocks &other)
+{
+    for (auto i = other.mBlocks.begin(); i != other.mBlocks.end(); i++) {
+        blockCounts &b = mBlocks[i->first];
+        b.objectId = i->second.objectId;
+        b.dataObjectId = i->second.dataObjectId;
+        b.deadlocks += i->second.deadlocks;
+        b.waiters += i->second.waiters;
+        b.modes.insert(i->second.modes.begin(), i->second.modes.end());
+    }
+}
+
+//==============================================================================
+//                                                     oraHotBlocks::summary()
+//------------------------------------------------------------------------------
+// Returns the blocks found in at least minDeadlocks deadlocks, the hottest
+// first. Ties come out in file and block order.
+//==============================================================================
+vector<oraHotBlocks::blockSummary> oraHotBlocks::summary(const unsigned long long minDeadlocks) const
+{
+    vector<blockSummary> result;
+
+    for (auto i = mBlocks.begin(); i != mBlocks.end(); i++) {
+        if (i->second.deadlocks < minDeadlocks) {
+            continue;
+        }
+
+        blockSummary s;
+        s.file = i->first.first;
+        s.block = i->first.second;
+        s.objectId = i->second.objectId;
+        s.dataObjectId = i->second.dataObjectId;
+        s.deadlocks = i->second.deadlocks;
+        s.waiters = i->second.waiters;
+        for (auto m = i->second.modes.begin(); m != i->second.modes.end(); m++) {
+            s.modes += (s.modes.empty() ? "" : " ") + *m;
+        }
+
+        result.push_back(s);
+    }
+
+    std::stable_sort(result.begin(), result.end(),
+                     [](const blockSummary &a, const blockSummary &b) { return a.deadlocks > b.deadlocks; });
+
+    return result;
+}
+
+//==============================================================================
+//                                                   oraHotBlocks::csvHeader()
+//------------------------------------------------------------------------------
+// Writes the heading line for toCSV().
+//==============================================================================
+void oraHotBlocks::csvHeader(ostream &out)
+{
+    out << "file,block,objectId,dataObjectId,deadlocks,waiters,modes\n";
+}
+
+//==============================================================================
+//                                                       oraHotBlocks::toCSV()
+//------------------------------------------------------------------------------
+// Writes the summary, one line per block. The modes are lock mode letters,
+// space separated, so need no quoting.
+//==============================================================================
+void oraHotBlocks::toCSV(ostream &out, const unsigned long long minDeadlocks) const
+{
+    auto blocks = summary(minDeadlocks);
+    for (auto b = blocks.begin(); b != blocks.end(); b++) {
+        out << b->file << ',' << b->block << ','
+            << b->objectId << ',' << b->dataObjectId << ','
+            << b->deadlocks << ',' << b->waiters << ','
+            << b->modes << '\n';
+    }
+}
@@ -0,0 +1,273 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraStats.h"
+
+#include <iomanip>
+#include <cstdio>
+#include <csignal>
+
+using std::fixed;
+using std::setprecision;
+
+// Only a lock free atomic is safe to set from a signal handler.
+static_assert(ATOMIC_BOOL_LOCK_FREE == 2, "std::atomic<bool> must be lock free");
+std::atomic<bool> progressRequested(false);
+
+//==============================================================================
+//                                                             progressHandler()
+//------------------------------------------------------------------------------
+// SIGUSR1 handler. Just raises the flag, the reader does the printing.
+//==============================================================================
+static void progressHandler(int)
+{
+    progressRequested.store(true);
+}
+
+//==============================================================================
+//                                                      installProgressHandler()
+//------------------------------------------------------------------------------
+// Arranges for a SIGUSR1 to print the progress of the current trace file.
+// There's no SIGUSR1 on Windows, so nothing happens there.
+//==============================================================================
+void installProgressHandler()
+{
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, progressHandler);
+#endif
+}
+
+//==============================================================================
+//                                                                  jsonString()
+//------------------------------------------------------------------------------
+// Returns the string quoted, and escaped, ready for a JSON document.
+//==============================================================================
+string jsonString(const string &s)
+{
+    string result;
+    result.reserve(s.size() + 2);
+    result += '"';
+
+    for (auto c : s) {
+        switch (c) {
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char hex[8];
+                    std::snprintf(hex, sizeof(hex), "\\u%04x", c);
+                    result += hex;
+                } else {
+                    result += c;
+                }
+        }
+    }
+
+    result += '"';
+    return result;
+}
+
+
+// Set by --stats.
+bool oraStats::mTiming = false;
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraStats::oraStats()
+{
+    mLines = 0;
+    mBytesRead = 0;
+    mDeadlocks = 0;
+    mParseErrors = 0;
+    mBytesWritten = 0;
+    mElapsed = 0.0;
+    mStopped = false;
+    mStarted = std::chrono::steady_clock::now();
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraStats::~oraStats()
+{
+    mPhases.clear();
+}
+
+//==============================================================================
+//                                                                    addPhase()
+//------------------------------------------------------------------------------
+// Adds the time taken, and memory allocated, by one call of a phase to the
+// running totals. The peak is the highest of any one call.
+//==============================================================================
+void oraStats::addPhase(const char *phase, const double seconds, const oraAllocUsage &alloc)
+{
+    auto i = mPhases.find(phase);
+    if (i == mPhases.end()) {
+        i = mPhases.emplace(phase, phaseStats()).first;
+    }
+
+    phaseStats &p = i->second;
+    p.seconds += seconds;
+    p.calls++;
+    p.allocations += alloc.allocations;
+    p.bytesAllocated += alloc.bytes;
+    if (alloc.peakBytes > p.peakBytes) {
+        p.peakBytes = alloc.peakBytes;
+    }
+}
+
+//==============================================================================
+//                                                                     elapsed()
+//------------------------------------------------------------------------------
+// Returns the wall time, in seconds, since we started. Or until we stopped.
+//==============================================================================
+double oraStats::elapsed()
+{
+    if (mStopped) {
+        return mElapsed;
+    }
+
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - mStarted;
+    return d.count();
+}
+
+//==============================================================================
+//                                                                        stop()
+//------------------------------------------------------------------------------
+// Freezes the elapsed time. Called when a trace file has been done with.
+//==============================================================================
+void oraStats::stop()
+{
+    if (!mStopped) {
+        mElapsed = elapsed();
+        mStopped = true;
+    }
+}
+
+//==============================================================================
+//                                                                 mbPerSecond()
+//------------------------------------------------------------------------------
+// How fast are we reading the trace file(s)?
+//==============================================================================
+double oraStats::mbPerSecond()
+{
+    double seconds = elapsed();
+    if (seconds <= 0.0) {
+        return 0.0;
+    }
+
+    return (mBytesRead / (1024.0 * 1024.0)) / seconds;
+}
+
+//==============================================================================
+//                                                                       merge()
+//------------------------------------------------------------------------------
+// Adds another set of stats, for a single trace file, into these, the totals.
+//==============================================================================
+void oraStats::merge(oraStats &other)
+{
+    for (auto i = other.mPhases.begin(); i != other.mPhases.end(); i++) {
+        phaseStats &p = mPhases[i->first];
+        p.seconds += i->second.seconds;
+        p.calls += i->second.calls;
+        p.allocations += i->second.allocations;
+        p.bytesAllocated += i->second.bytesAllocated;
+        if (i->second.peakBytes > p.peakBytes) {
+            p.peakBytes = i->second.peakBytes;
+        }
+    }
+
+    mLines += other.mLines;
+    mBytesRead += other.mBytesRead;
+    mDeadlocks += other.mDeadlocks;
+    mParseErrors += other.mParseErrors;
+    mBytesWritten += other.mBytesWritten;
+}
+
+//==============================================================================
+//                                                                    progress()
+//------------------------------------------------------------------------------
+// Prints a one line progress report. Called on receipt of a SIGUSR1.
+//==============================================================================
+void oraStats::progress(ostream &out, const string &name)
+{
+    // Leave the stream as we found it for whoever writes to it next.
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    out << "\tProgress: " << name << ": "
+        << mLines << " lines, "
+        << fixed << setprecision(2)
+        << mBytesRead / (1024.0 * 1024.0) << " MB read, "
+        << mDeadlocks << " deadlock(s), "
+        << mbPerSecond() << " MB/s" << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+//==============================================================================
+//                                                                      toJSON()
+//------------------------------------------------------------------------------
+// Writes these stats out as a JSON object. Each line is prefixed by indent.
+// The phases only have memory figures if allocations are being counted.
+//==============================================================================
+void oraStats::toJSON(ostream &out, const string &name, const string &indent)
+{
+    out << indent << "{\n"
+        << indent << "  \"name\": " << jsonString(name) << ",\n"
+        << std::setprecision(6) << fixed
+        << indent << "  \"seconds\": " << elapsed() << ",\n"
+        << indent << "  \"lines\": " << mLines << ",\n"
+        << indent << "  \"bytesRead\": " << mBytesRead << ",\n"
+        << indent << "  \"mbPerSecond\": " << mbPerSecond() << ",\n"
+        << indent << "  \"deadlocks\": " << mDeadlocks << ",\n"
+        << indent << "  \"parseErrors\": " << mParseErrors << ",\n"
+        << indent << "  \"bytesWritten\": " << mBytesWritten << ",\n"
+        << indent << "  \"phases\": {";
+
+    bool first = true;
+    for (auto i = mPhases.begin(); i != mPhases.end(); i++) {
+        out << (first ? "\n" : ",\n")
+            << indent << "    " << jsonString(i->first)
+            << ": { \"seconds\": " << i->second.seconds
+            << ", \"calls\": " << i->second.calls;
+
+        if (oraAllocStats::enabled()) {
+            out << ", \"allocations\": " << i->second.allocations
+                << ", \"bytesAllocated\": " << i->second.bytesAllocated
+                << ", \"peakBytes\": " << i->second.peakBytes;
+        }
+
+        out << " }";
+        first = false;
+    }
+
+    out << '\n' << indent << "  }\n"
+        << indent << "}";
+}
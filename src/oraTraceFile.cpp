@@ -30,9 +30,57 @@
 //==============================================================================
 oraTraceFile::oraTraceFile(const string traceFileName):
     mTraceName(traceFileName)
+{
+    construct();
+
+    mText = std::make_shared<oraTraceText>(traceFileName);
+    // Binary, so that the offsets we count match the ones that oraTraceText,
+    // and excerpt(), seek to, whatever the line endings.
+    mIFS = new ifstream(traceFileName, std::ios::binary);
+    ORA_PROBE1(file__open, mTraceName.c_str());
+    initialise();
+}
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// For a trace file that is already in memory. The name is only used for the
+// report, and messages. The buffer must outlive this oraTraceFile.
+//==============================================================================
+oraTraceFile::oraTraceFile(const string traceName, const char *buffer, const size_t length):
+    mTraceName(traceName)
+{
+    construct();
+
+    mText = std::make_shared<oraTraceText>(buffer, length);
+    mIFS = new oraMemoryStream(buffer, length);
+    ORA_PROBE1(file__open, mTraceName.c_str());
+    initialise();
+}
+
+//==============================================================================
+//                                                                   construct()
+//------------------------------------------------------------------------------
+// The common bits of the constructors.
+//==============================================================================
+void oraTraceFile::construct()
 {
     mIFS = nullptr;
     mLineNumber = 0;
+    mPreviousOffset = 0;
+    mCurrentOffset = 0;
+    mNextOffset = 0;
+    mResync = false;
+    mFilter = nullptr;
+    mLineNumbersKnown = true;
+    mStarted = false;
+    mKeepLooking = true;
+    mGlobalGraphs = false;
+    mGlobalGraph = false;
+    mVerbose = true;
+    mStartOffset = 0;
+    mDeadlockBudget = DEADLOCK_BYTE_BUDGET;
+    mCancelled = false;
     mPreviousLine.reserve(120);
     mCurrentLine.reserve(120);
     mInstanceName.reserve(20);
@@ -41,10 +89,6 @@ oraTraceFile::oraTraceFile(const string traceFileName):
     mOracleHome.reserve(120);
     mServerName.reserve(20);
     mDeadlocks.reserve(10);
-
-
-    mIFS = new ifstream(traceFileName);
-    initialise();
 }
 
 //==============================================================================
@@ -53,11 +97,22 @@ oraTraceFile::oraTraceFile(const string traceFileName):
 oraTraceFile::~oraTraceFile()
 {
     if (mIFS != nullptr) {
-        mIFS->close();
+        ORA_PROBE3(file__close, mTraceName.c_str(), mStats.lines(), mStats.bytesRead());
+        delete mIFS;
         mIFS = nullptr;
     }
 }
 
+//==============================================================================
+//                                                                      restOf()
+//------------------------------------------------------------------------------
+// Returns the line from position from onwards, or "" if it's not that long.
+//==============================================================================
+static string restOf(const string &line, const size_t from)
+{
+    return (from < line.size()) ? line.substr(from) : string();
+}
+
 //==============================================================================
 //                                                                  initialise()
 //------------------------------------------------------------------------------
@@ -67,6 +122,7 @@ void oraTraceFile::initialise()
 {
     // Read the trace file and extract some "stuff". On exit from here
     // We are sat having just read the first blank line in the trace file.
+    oraPhaseTimer timer(&mStats, "initialise");
 
     while (mIFS->good()) {
         readLine();
@@ -75,16 +131,16 @@ void oraTraceFile::initialise()
             break;
         }
 
-        if (mCurrentLine.substr(0, 10) == "Trace file") {
-            mOriginalPath = mCurrentLine.substr(11);
+        if (mCurrentLine.compare(0, 10, "Trace file") == 0) {
+            mOriginalPath = restOf(mCurrentLine, 11);
             continue;
         }
 
-        if (mCurrentLine.substr(0, 11) == "ORACLE_HOME") {
+        if (mCurrentLine.compare(0, 11, "ORACLE_HOME") == 0) {
             // This one is different in different systems
             // On some it is "ORACLE_HOME:<some spaces>/path/etc"
             // on others it is "ORACLE_HOME = /path/etc"
-            mOracleHome = mCurrentLine.substr(11);
+            mOracleHome = restOf(mCurrentLine, 11);
             // Ltrim leading spaces, colons, tabs, equals.
             auto pos = mOracleHome.find_first_not_of(": \t=");
             if (pos != string::npos ) {
@@ -93,18 +149,18 @@ void oraTraceFile::initialise()
             continue;
         }
 
-        if (mCurrentLine.substr(0, 11) == "System name") {
-            mSystemName = mCurrentLine.substr(13);
+        if (mCurrentLine.compare(0, 11, "System name") == 0) {
+            mSystemName = restOf(mCurrentLine, 13);
             continue;
         }
 
-        if (mCurrentLine.substr(0, 9) == "Node name") {
-            mServerName = mCurrentLine.substr(11);
+        if (mCurrentLine.compare(0, 9, "Node name") == 0) {
+            mServerName = restOf(mCurrentLine, 11);
             continue;
         }
 
-        if (mCurrentLine.substr(0, 13) == "Instance name") {
-            mInstanceName = mCurrentLine.substr(15);
+        if (mCurrentLine.compare(0, 13, "Instance name") == 0) {
+            mInstanceName = restOf(mCurrentLine, 15);
             continue;
         }
     }
@@ -119,27 +175,216 @@ void oraTraceFile::initialise()
 //==============================================================================
 unsigned oraTraceFile::findAllDeadlocks()
 {
+    oraPhaseTimer timer(&mStats, "findAllDeadlocks");
     unsigned deadlockCount = 0;
-    while (mIFS->good()) {
-        // Look for another deadlock.
-        if (findDeadlock()) {
-            cerr << "\tFound a deadlock at line " << mLineNumber << endl;
-            deadlockCount++;
-
-            // Create a new deadlock and get it to extract its own details.
-            oraDeadlock temp(this);
-            temp.extractDeadlock();
-            mDeadlocks.push_back(temp);
-
-            // Debug: Dumps out each deadlock at the end. Useful!
-            //cerr << "Deadlock: " << deadlockCount << '\n'
-            //     << temp << '\n' << std::endl;
-        }
+
+    oraDeadlock temp(this);
+    while (nextDeadlock(temp)) {
+        deadlockCount++;
+        mDeadlocks.push_back(std::move(temp));
+
+        // Debug: Dumps out each deadlock at the end. Useful!
+        //cerr << "Deadlock: " << deadlockCount << '\n'
+        //     << temp << '\n' << std::endl;
     }
 
     return deadlockCount;
 }
 
+//==============================================================================
+//                                                                nextDeadlock()
+//------------------------------------------------------------------------------
+// Finds and extracts the next wanted deadlock in the trace file, without
+// keeping it. Returns false when there are no more. This lets a caller stream
+// through a trace file, one deadlock at a time.
+//==============================================================================
+bool oraTraceFile::nextDeadlock(oraDeadlock &deadlock)
+{
+    // If we have been here before, or only want recent deadlocks, jump
+    // straight to them.
+    if (!mStarted) {
+        mStarted = true;
+        if (mStartOffset > mNextOffset) {
+            seekTo(mStartOffset);
+        }
+
+        if (mFilter && mFilter->hasSince()) {
+            skipToTime(mFilter->since());
+        }
+    }
+
+    while (mKeepLooking && mIFS->good()) {
+        // Look for another deadlock. Do we want it?
+        if (!findDeadlock() || !wantedDeadlock(mKeepLooking)) {
+            continue;
+        }
+
+        // Create a new deadlock and get it to extract its own details.
+        ORA_PROBE2(deadlock__start, mLineNumber, mCurrentOffset);
+        oraDeadlock temp(this);
+        bool ok = mGlobalGraph ? temp.extractGlobalGraph() : temp.extractDeadlock();
+        ORA_PROBE3(deadlock__end, mLineNumber, mNextOffset, ok);
+
+        // It's on its own now.
+        temp.mTraceFile = nullptr;
+
+        // The filter might not want it after all.
+        if (temp.rejected()) {
+            continue;
+        }
+
+        if (mVerbose) {
+            cerr << (temp.global() ? "\tFound a global deadlock at " : "\tFound a deadlock at ");
+            if (temp.lineNumber()) {
+                cerr << "line " << temp.lineNumber() << endl;
+            } else {
+                cerr << "byte offset " << temp.startOffset() << endl;
+            }
+        }
+        mStats.addDeadlock();
+        deadlock = std::move(temp);
+        return true;
+    }
+
+    return false;
+}
+
+
+//==============================================================================
+//                                                              wantedDeadlock()
+//------------------------------------------------------------------------------
+// We are sitting on a "DEADLOCK DETECTED" line. Do we want this deadlock? The
+// timestamp is on the previous line. If we are past the end of the time
+// window, there's no point looking any further, so keepLooking is cleared.
+//==============================================================================
+bool oraTraceFile::wantedDeadlock(bool &keepLooking)
+{
+    if (!mFilter || !mFilter->hasTimeWindow()) {
+        return true;
+    }
+
+    // *** 2018-12-19 15:42:20.941
+    long long when;
+    if (mPreviousLine.compare(0, 4, "*** ") != 0 ||
+        !oraFilter::parseTimestamp(mPreviousLine.data() + 4, mPreviousLine.size() - 4, when)) {
+        // No timestamp, can't tell, so assume we want it.
+        return true;
+    }
+
+    if (mFilter->tooLate(when)) {
+        keepLooking = false;
+        return false;
+    }
+
+    return !mFilter->tooEarly(when);
+}
+
+//==============================================================================
+//                                                               findTimestamp()
+//------------------------------------------------------------------------------
+// Looks for the first "*** YYYY-MM-DD HH:MM:SS" line starting at, or after,
+// a byte offset. The offset is probably in the middle of a line, so the rest
+// of that one is skipped. Gives up after a while as dumps can be big, and we
+// are only trying to narrow down where to start reading. Returns the offset
+// of the line found, and its time.
+//==============================================================================
+bool oraTraceFile::findTimestamp(const unsigned long long from, unsigned long long &where, long long &when)
+{
+    const unsigned long long scanLimit = 4 * 1024 * 1024;
+
+    string temp;
+    unsigned long long offset = from;
+    mIFS->clear();
+
+    // Skip the partial line, unless we are at the start of one.
+    if (from > 0) {
+        mIFS->seekg(from - 1);
+        if (!getline(*mIFS, temp)) {
+            return false;
+        }
+        offset = from + temp.size();
+    } else {
+        mIFS->seekg(0);
+    }
+
+    while (offset - from < scanLimit && getline(*mIFS, temp)) {
+        if (temp.compare(0, 4, "*** ") == 0 &&
+            oraFilter::parseTimestamp(temp.data() + 4, temp.size() - 4, when)) {
+            where = offset;
+            return true;
+        }
+
+        offset += temp.size() + 1;
+    }
+
+    return false;
+}
+
+//==============================================================================
+//                                                                  skipToTime()
+//------------------------------------------------------------------------------
+// Binary search of the trace file's timestamps, to get to somewhere just
+// before the first deadlock at or after a given time. Trace files are written
+// in time order, so anything before a timestamp that is too early is also too
+// early. The search stops when it has narrowed things down to a small range,
+// the normal reading, and filtering, does the rest.
+//
+// Once we have jumped, we don't know the line numbers any more, so deadlocks
+// are reported by byte offset instead.
+//==============================================================================
+void oraTraceFile::skipToTime(const long long since)
+{
+    oraPhaseTimer timer(&mStats, "skipToTime");
+    const unsigned long long closeEnough = 64 * 1024;
+
+    // Where are we now, and how big is the file?
+    unsigned long long low = mNextOffset;
+    mIFS->clear();
+    mIFS->seekg(0, std::ios::end);
+    unsigned long long high = mIFS->tellg();
+
+    while (high > low && high - low > closeEnough) {
+        unsigned long long middle = low + (high - low) / 2;
+        unsigned long long where;
+        long long when;
+
+        if (findTimestamp(middle, where, when) && when < since) {
+            // Everything before here is too early.
+            low = where;
+        } else {
+            // Either too late, or no idea - try nearer the start.
+            high = middle;
+        }
+    }
+
+    // Carry on reading from the low point.
+    seekTo(low);
+}
+
+//==============================================================================
+//                                                                      seekTo()
+//------------------------------------------------------------------------------
+// Carries on reading from a given byte offset, which must be the start of a
+// line. Once we have jumped, we don't know the line numbers any more.
+//==============================================================================
+void oraTraceFile::seekTo(const unsigned long long offset)
+{
+    mIFS->clear();
+    mIFS->seekg(offset);
+
+    if (offset != mNextOffset) {
+        if (mVerbose) {
+            cerr << "\tSkipped to byte offset " << offset << endl;
+        }
+        mLineNumbersKnown = false;
+        mNextOffset = offset;
+        mCurrentOffset = offset;
+        mPreviousOffset = offset;
+        mCurrentLine.clear();
+        mPreviousLine.clear();
+        mLastTimestamp.clear();
+    }
+}
 
 //==============================================================================
 //                                                                    deadLock()
@@ -148,7 +393,7 @@ unsigned oraTraceFile::findAllDeadlocks()
 //==============================================================================
 oraDeadlock *oraTraceFile::deadLock(const unsigned index)
 {
-    if (index > mDeadlocks.size() - 1) {
+    if (index >= mDeadlocks.size()) {
         // Oops! Out of range.
         return nullptr;
     }
@@ -156,25 +401,82 @@ oraDeadlock *oraTraceFile::deadLock(const unsigned index)
     return &(mDeadlocks.at(index));
 }
 
+//==============================================================================
+//                                                                     excerpt()
+//------------------------------------------------------------------------------
+// Returns the raw text of the trace file between two byte offsets. This uses
+// its own stream, so can be called while, or after, the file is parsed.
+//==============================================================================
+string oraTraceFile::excerpt(const unsigned long long startOffset, const unsigned long long endOffset)
+{
+    return mText->excerpt(startOffset, endOffset);
+}
+
+//==============================================================================
+//                                                                     excerpt()
+//------------------------------------------------------------------------------
+// Returns the raw text of the trace file for one deadlock, from the timestamp
+// line just before "DEADLOCK DETECTED" to the last line we extracted.
+//==============================================================================
+string oraTraceFile::excerpt(const oraDeadlock *dl)
+{
+    return excerpt(dl->startOffset(), dl->endOffset());
+}
+
 //==============================================================================
 //                                                                    readLine()
 //------------------------------------------------------------------------------
 // Reads the next line from the tracefile. Makes sure that line numbers
-// and previous lines are sorted out. Returns the new line read.
+// and previous lines are sorted out. Returns the new line read. If we have
+// been cancelled, it's as if we hit EOF, so every loop reading lines ends.
+// The previous line is swapped out, not copied, getline() overwrites it.
 //==============================================================================
-string oraTraceFile::readLine()
+const string &oraTraceFile::readLine()
 {
-    mPreviousLine = mCurrentLine;
+    static const string noLine;
+
+    mPreviousLine.swap(mCurrentLine);
+    if (mCancelled.load(std::memory_order_relaxed)) {
+        mIFS->setstate(std::ios::failbit);
+        mCurrentLine.clear();
+        return noLine;
+    }
+
     getline(*mIFS, mCurrentLine);
 
     if (mIFS->good()) {
+        // Keep track of where we are in the file. We have just read a '\n',
+        // or we would not be good(). A trace copied from a Windows box may
+        // have "\r\n" instead, the '\r' is counted here, then dropped.
         mLineNumber++;
+        mPreviousOffset = mCurrentOffset;
+        mCurrentOffset = mNextOffset;
+        mNextOffset += mCurrentLine.size() + 1;
+        mStats.addLine(mCurrentLine.size() + 1);
+
+        if (!mCurrentLine.empty() && mCurrentLine.back() == '\r') {
+            mCurrentLine.pop_back();
+        }
+
+        // "*** SESSION ID:" and friends don't count, only dates.
+        if (mCurrentLine.size() > 14 && mCurrentLine[4] >= '0' && mCurrentLine[4] <= '9' &&
+            mCurrentLine.compare(0, 4, "*** ") == 0) {
+            mLastTimestamp = mCurrentLine;
+        }
+
+        // Has someone sent us a SIGUSR1? Only one reader gets to answer,
+        // the plain load keeps this cheap when nobody has.
+        if (progressRequested.load(std::memory_order_relaxed) &&
+            progressRequested.exchange(false)) {
+            mStats.progress(cerr, mTraceName);
+        }
+
         //std::cerr << mLineNumber << ": [" << mCurrentLine << ']' << endl;
         return mCurrentLine;
     };
 
     // Oops! EOF or error occurred.
-    return "";
+    return noLine;
 }
 
 //==============================================================================
@@ -192,7 +494,7 @@ bool oraTraceFile::findAtStart(const string lookFor, const bool stopAtEndOfDeadl
 
     while (mIFS->good()) {
         readLine();
-        if (mCurrentLine.substr(0, lookSize) == lookFor ) {
+        if (mCurrentLine.compare(0, lookSize, lookFor) == 0) {
             return true;
         }
 
@@ -208,66 +510,51 @@ bool oraTraceFile::findAtStart(const string lookFor, const bool stopAtEndOfDeadl
 }
 
 //==============================================================================
-//                                                               findNearStart()
+//                                                                findDeadlock()
 //------------------------------------------------------------------------------
-// Looks for some text, case sensitive, at the start of the current
-// line from the trace file but with may be prefixed by whitespace.
-// If not found, this will keep reading lines until
-// it is found or we hit an error or EOF. Returns true if found.
-// Returns false if not found, but the end of a deadlock dump is found first if
-// stopAtEndOfDeadlock is true.
+// Helper to find the start of each deadlock in the tracefile. Sets  the flag to
+// false as we could be still in the middle of a deadlock dump. We need to
+// ignore the end of this deadlock, to find the next one. If the previous
+// deadlock ran into this one, we are already there.
+//
+// LMD trace files, on RAC, have global wait-for-graphs instead. We only look
+// for those if asked to.
 //==============================================================================
-bool oraTraceFile::findNearStart(const string lookFor, const bool stopAtEndOfDeadlock)
+bool oraTraceFile::findDeadlock()
 {
-    auto lookSize = lookFor.length();
-
-    while (mIFS->good()) {
-        readLine();
-        if (trimmedLine().substr(0, lookSize) == lookFor ) {
-            return true;
+    if (!mResync) {
+        if (!mGlobalGraphs) {
+            return findAtStart("DEADLOCK DETECTED", false);
         }
 
-        if (stopAtEndOfDeadlock) {
-            if (mCurrentLine == "END OF PROCESS STATE") {
-                return false;
+        while (mIFS->good()) {
+            readLine();
+            if (mCurrentLine.compare(0, 17, "DEADLOCK DETECTED") == 0 ||
+                mCurrentLine.compare(0, 26, "Global Wait-For-Graph(WFG)") == 0) {
+                break;
             }
         }
-    }
 
-    // Return error or EOF.
-    return mIFS->good();
-}
-
-//==============================================================================
-//                                                                findDeadlock()
-//------------------------------------------------------------------------------
-// Helper to find the start of each deadlock in the tracefile. Sets  the flag to
-// false as we could be still in the middle of a deadlock dump. We need to
-// ignore the end of this deadlock, to find the next one.
-//==============================================================================
-bool oraTraceFile::findDeadlock()
-{
-    return findAtStart("DEADLOCK DETECTED", false);
-}
+        if (!mIFS->good()) {
+            return false;
+        }
+    }
 
-//==============================================================================
-//                                                           findDeadlockGraph()
-//------------------------------------------------------------------------------
-// Helper to find the start of each deadlock graph in the tracefile.
-//==============================================================================
-bool oraTraceFile::findDeadlockGraph()
-{
-    return findAtStart("Deadlock graph:");
+    mResync = false;
+    mGlobalGraph = (mCurrentLine.compare(0, 26, "Global Wait-For-Graph(WFG)") == 0);
+    return true;
 }
 
 //==============================================================================
 //                                                                 trimmedLine()
 //------------------------------------------------------------------------------
 // Returns the current line from the trace file, without leading whitespace.
+// A blank line comes back empty.
 //==============================================================================
 string oraTraceFile::trimmedLine()
 {
-    return mCurrentLine.substr(mCurrentLine.find_first_not_of(" \t"));
+    auto pos = mCurrentLine.find_first_not_of(" \t");
+    return (pos == string::npos) ? string() : mCurrentLine.substr(pos);
 }
 
 //==============================================================================
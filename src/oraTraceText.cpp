@@ -0,0 +1,93 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraTraceText.h"
+
+#include <algorithm>
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraTraceText::oraTraceText(const string traceName):
+    mTraceName(traceName)
+{
+    mBuffer = nullptr;
+    mBufferLength = 0;
+}
+
+//==============================================================================
+//                                                                   Constructor
+//------------------------------------------------------------------------------
+// For a trace file already in memory.
+//==============================================================================
+oraTraceText::oraTraceText(const char *buffer, const size_t length)
+{
+    mBuffer = buffer;
+    mBufferLength = length;
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraTraceText::~oraTraceText()
+{
+    //dtor
+}
+
+//==============================================================================
+//                                                                     excerpt()
+//------------------------------------------------------------------------------
+// Returns the text between two byte offsets. Cut short if the trace file is.
+//==============================================================================
+string oraTraceText::excerpt(const unsigned long long startOffset,
+                             const unsigned long long endOffset) const
+{
+    if (endOffset <= startOffset) {
+        return "";
+    }
+
+    // In memory is easy, and needs no locking.
+    if (mBuffer) {
+        if (startOffset >= mBufferLength) {
+            return "";
+        }
+
+        size_t length = std::min<unsigned long long>(endOffset, mBufferLength) - startOffset;
+        return string(mBuffer + startOffset, length);
+    }
+
+    string result(endOffset - startOffset, '\0');
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mIFS.is_open()) {
+        mIFS.open(mTraceName, std::ios::binary);
+    }
+
+    mIFS.clear();
+    mIFS.seekg(startOffset);
+    mIFS.read(&result[0], result.size());
+    result.resize(mIFS.gcount());
+
+    return result;
+}
@@ -0,0 +1,364 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraWaitEvent.h"
+
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+using std::strncmp;
+
+using std::unordered_map;
+using std::mutex;
+using std::lock_guard;
+
+// The interned event names. Event zero is "no event". Protected by a mutex
+// as we could be parsing more than one trace file at once.
+static vector<string> eventNames = { "" };
+static unordered_map<string, unsigned> eventIds;
+static mutex eventMutex;
+
+// The units a wait time can be in, smallest first. Bit x of a wait's mUnits
+// is set if durationUnits[x] was used.
+static const struct {
+    const char *name;
+    size_t length;
+    unsigned long long micros;
+} durationUnits[] = {
+    { "usec", 4, 1ULL },
+    { "msec", 4, 1000ULL },
+    { "sec", 3, 1000000ULL },
+    { "min", 3, 60000000ULL },
+    { "hr", 2, 3600000000ULL },
+    { "hour", 4, 3600000000ULL }
+};
+
+static const int durationUnitCount = sizeof(durationUnits) / sizeof(durationUnits[0]);
+
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraWaitEvent::oraWaitEvent(const unsigned eventId) :
+    mEventId(eventId)
+{
+    mUnits = 0;
+    mDecimals = 0;
+    mMicros = 0;
+    mP1 = 0;
+    mP2 = 0;
+    mP3 = 0;
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraWaitEvent::~oraWaitEvent()
+{
+    //dtor
+}
+
+//==============================================================================
+//                                                                 internEvent()
+//------------------------------------------------------------------------------
+// Returns the id for an event name, adding it to the table if it's new.
+//==============================================================================
+unsigned oraWaitEvent::internEvent(const string &name)
+{
+    lock_guard<mutex> lock(eventMutex);
+
+    auto i = eventIds.find(name);
+    if (i != eventIds.end()) {
+        return i->second;
+    }
+
+    unsigned id = eventNames.size();
+    eventNames.push_back(name);
+    eventIds[name] = id;
+    return id;
+}
+
+//==============================================================================
+//                                                                   eventName()
+//------------------------------------------------------------------------------
+// Returns the name of an interned event.
+//==============================================================================
+string oraWaitEvent::eventName(const unsigned eventId)
+{
+    lock_guard<mutex> lock(eventMutex);
+
+    if (eventId < eventNames.size()) {
+        return eventNames[eventId];
+    }
+
+    return "";
+}
+
+//==============================================================================
+//                                                               parseDuration()
+//------------------------------------------------------------------------------
+// Converts a wait time from the trace into microseconds. These look like:
+//
+// "0.000040 sec", "2.930929 sec", "11 min 53 sec", "1 hr 2 min 3 sec"
+//
+// And, in some versions, "usec" and "msec". Stops at a comma or the end of
+// the text. Returns false if nothing sensible was found. If asked, says which
+// units were used, as bits, and how many decimal places the last number had.
+//==============================================================================
+bool oraWaitEvent::parseDuration(const string &text, unsigned long long &micros,
+                                 unsigned char *units, unsigned char *decimals)
+{
+    const char *p = text.c_str();
+    double total = 0.0;
+    bool gotOne = false;
+    unsigned char unitsSeen = 0;
+    unsigned char places = 0;
+
+    while (*p && *p != ',') {
+        char *end;
+        double value = std::strtod(p, &end);
+        if (end == p) {
+            break;
+        }
+
+        const char *point = static_cast<const char *>(memchr(p, '.', end - p));
+        places = point ? std::min<long>(end - point - 1, 9) : 0;
+
+        // Skip to the units.
+        p = end;
+        while (*p == ' ') {
+            p++;
+        }
+
+        int unit = 0;
+        while (unit < durationUnitCount &&
+               strncmp(p, durationUnits[unit].name, durationUnits[unit].length)) {
+            unit++;
+        }
+
+        if (unit == durationUnitCount) {
+            break;
+        }
+
+        total += value * durationUnits[unit].micros;
+        unitsSeen |= 1 << unit;
+        gotOne = true;
+
+        // Skip the units and any spaces.
+        while (*p && *p != ' ' && *p != ',') {
+            p++;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+    }
+
+    micros = static_cast<unsigned long long>(total + 0.5);
+    if (units) {
+        *units = unitsSeen;
+    }
+    if (decimals) {
+        *decimals = places;
+    }
+    return gotOne;
+}
+
+//==============================================================================
+//                                                                 setDuration()
+//------------------------------------------------------------------------------
+// Sets the time waited from the trace's text for it, remembering how it was
+// written. Returns false, and the time is zero, if it makes no sense.
+//==============================================================================
+bool oraWaitEvent::setDuration(const string &text)
+{
+    return parseDuration(text, mMicros, &mUnits, &mDecimals);
+}
+
+//==============================================================================
+//                                                             parseParameters()
+//------------------------------------------------------------------------------
+// Extracts the P1, P2 and P3 values from a line such as:
+//
+// "driver id=0x54435000, #bytes=0x1, =0x0"
+//
+// The values are hex, with 0x, or decimal. Returns how many were found.
+//==============================================================================
+unsigned oraWaitEvent::parseParameters(const string &text, unsigned long long params[3])
+{
+    unsigned found = 0;
+    string::size_type pos = 0;
+
+    while (found < 3) {
+        pos = text.find('=', pos);
+        if (pos == string::npos) {
+            break;
+        }
+
+        pos++;
+        params[found++] = std::strtoull(text.c_str() + pos, nullptr, 0);
+    }
+
+    return found;
+}
+
+//==============================================================================
+//                                                              formatDuration()
+//------------------------------------------------------------------------------
+// Formats microseconds the way Oracle does in the trace, more or less.
+//==============================================================================
+string oraWaitEvent::formatDuration(const unsigned long long micros)
+{
+    char buffer[64];
+
+    if (micros < 60000000ULL) {
+        std::snprintf(buffer, sizeof(buffer), "%.6f sec", micros / 1e6);
+        return buffer;
+    }
+
+    unsigned long long seconds = (micros + 500000) / 1000000;
+    unsigned long long hours = seconds / 3600;
+    unsigned long long minutes = (seconds % 3600) / 60;
+    seconds %= 60;
+
+    if (hours) {
+        std::snprintf(buffer, sizeof(buffer), "%llu hr %llu min %llu sec", hours, minutes, seconds);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%llu min %llu sec", minutes, seconds);
+    }
+
+    return buffer;
+}
+
+//==============================================================================
+//                                                                        text()
+//------------------------------------------------------------------------------
+// Renders the wait as text for the report, "Waited for 'event' for n sec(s)".
+//==============================================================================
+string oraWaitEvent::text() const
+{
+    return "Waited for '" + eventName() + "' for " + durationText() + "(s)";
+}
+
+//==============================================================================
+//                                                                durationText()
+//------------------------------------------------------------------------------
+// The time waited, in the units the trace used, "2.5 min", "11 min 53 sec".
+// All but the smallest unit are whole numbers. If we don't know the units,
+// it's formatted the usual way.
+//==============================================================================
+string oraWaitEvent::durationText() const
+{
+    if (!mUnits) {
+        return formatDuration(mMicros);
+    }
+
+    string result;
+    char buffer[64];
+    unsigned long long left = mMicros;
+
+    for (int unit = durationUnitCount - 1; unit >= 0; unit--) {
+        if (!(mUnits & (1 << unit))) {
+            continue;
+        }
+
+        const unsigned long long scale = durationUnits[unit].micros;
+        if (mUnits & ((1 << unit) - 1)) {
+            std::snprintf(buffer, sizeof(buffer), "%llu %s", left / scale, durationUnits[unit].name);
+            left %= scale;
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "%.*f %s", mDecimals,
+                          static_cast<double>(left) / scale, durationUnits[unit].name);
+        }
+
+        result += (result.empty() ? "" : " ") + string(buffer);
+    }
+
+    return result;
+}
+
+//==============================================================================
+//                                                                   Operator <<
+//------------------------------------------------------------------------------
+// Used to dump out an oraWaitEvent to a stream, for debugging/reporting.
+//==============================================================================
+ostream& operator<<(ostream &out, const oraWaitEvent &we)
+{
+    out << we.text()
+        << " (p1=" << we.mP1 << ", p2=" << we.mP2 << ", p3=" << we.mP3 << ')';
+
+    return out;
+}
+
+
+//==============================================================================
+//                                                          oraWaitStats::add()
+//------------------------------------------------------------------------------
+// Adds a whole wait stack to the statistics.
+//==============================================================================
+void oraWaitStats::add(const vector<oraWaitEvent> &waits)
+{
+    for (auto i = waits.begin(); i != waits.end(); i++) {
+        add(*i);
+    }
+}
+
+//==============================================================================
+//                                                      oraWaitStats::summary()
+//------------------------------------------------------------------------------
+// Returns count, total, median, 95th percentile and maximum wait for each
+// event, busiest (by total time waited) first.
+//==============================================================================
+vector<oraWaitStats::eventSummary> oraWaitStats::summary()
+{
+    vector<eventSummary> result;
+    result.reserve(mDurations.size());
+
+    for (auto i = mDurations.begin(); i != mDurations.end(); i++) {
+        vector<unsigned long long> &d = i->second;
+        std::sort(d.begin(), d.end());
+
+        eventSummary s;
+        s.eventId = i->first;
+        s.count = d.size();
+        s.totalMicros = 0;
+        for (auto x : d) {
+            s.totalMicros += x;
+        }
+
+        // Nearest rank percentiles.
+        s.p50Micros = d[(d.size() * 50 + 99) / 100 - 1];
+        s.p95Micros = d[(d.size() * 95 + 99) / 100 - 1];
+        s.maxMicros = d.back();
+        result.push_back(s);
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const eventSummary &a, const eventSummary &b) { return a.totalMicros > b.totalMicros; });
+
+    return result;
+}
@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Norman Dunbar
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "oraWatchdog.h"
+
+//==============================================================================
+//                                                                   Constructor
+//==============================================================================
+oraWatchdog::oraWatchdog()
+{
+    mNextId = 1;
+    mStopping = false;
+    mThread = std::thread(&oraWatchdog::run, this);
+}
+
+//==============================================================================
+//                                                                    Destructor
+//==============================================================================
+oraWatchdog::~oraWatchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+
+    mChanged.notify_one();
+    mThread.join();
+}
+
+//==============================================================================
+//                                                                       watch()
+//------------------------------------------------------------------------------
+// Starts watching a trace file, which is cancelled if it's still being
+// watched after this many seconds. Returns the id to pass to unwatch().
+//==============================================================================
+unsigned long oraWatchdog::watch(oraTraceFile *traceFile, const double seconds)
+{
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(seconds));
+
+    unsigned long id;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        id = mNextId++;
+        mWatched[id] = watched{traceFile, deadline};
+    }
+
+    mChanged.notify_one();
+    return id;
+}
+
+//==============================================================================
+//                                                                     unwatch()
+//------------------------------------------------------------------------------
+// Stops watching a trace file. It might have been cancelled already.
+//==============================================================================
+void oraWatchdog::unwatch(const unsigned long id)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWatched.erase(id);
+}
+
+//==============================================================================
+//                                                                         run()
+//------------------------------------------------------------------------------
+// The watchdog thread. Sleeps until the next deadline, or until something is
+// watched, then cancels anything that has run out of time.
+//==============================================================================
+void oraWatchdog::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (!mStopping) {
+        auto now = std::chrono::steady_clock::now();
+        timePoint next = timePoint::max();
+
+        for (auto w = mWatched.begin(); w != mWatched.end(); ) {
+            if (w->second.deadline <= now) {
+                w->second.traceFile->cancel();
+                w = mWatched.erase(w);
+                continue;
+            }
+
+            if (w->second.deadline < next) {
+                next = w->second.deadline;
+            }
+            w++;
+        }
+
+        if (next == timePoint::max()) {
+            mChanged.wait(lock);
+        } else {
+            mChanged.wait_until(lock, next);
+        }
+    }
+}